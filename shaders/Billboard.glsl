@@ -0,0 +1,20 @@
+//Camera facing quad shared by the billboard and particle vertex shaders, every instance is drawn as 6 vertices
+
+const vec2 VERTEX_OFFSETS[6] = vec2[](
+    vec2(-1.0, -1.0),
+    vec2(-1.0, 1.0),
+    vec2(1.0, -1.0),
+    vec2(1.0, -1.0),
+    vec2(-1.0, 1.0),
+    vec2(1.0, 1.0)
+);
+
+vec4 billboardClipPosition(vec3 center, vec2 dimensions, vec2 vertexOffset, mat4 viewMat, mat4 projMat) {
+    vec3 cameraRightWorldDir = {viewMat[0][0], viewMat[1][0], viewMat[2][0]};
+    vec3 cameraUpWorldDir = {viewMat[0][1], viewMat[1][1], viewMat[2][1]};
+
+    vec3 vertexPosWorld = center + ((vertexOffset.x * dimensions.x) * cameraRightWorldDir)
+                                 + ((vertexOffset.y * dimensions.y) * cameraUpWorldDir);
+
+    return projMat * viewMat * vec4(vertexPosWorld, 1.0);
+}
\ No newline at end of file
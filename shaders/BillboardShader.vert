@@ -1,34 +1,30 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "Billboard.glsl"
 
 layout(location = 0) out vec2 fragVertexOffset;
+layout(location = 1) flat out vec4 fragColor;
 
-layout(push_constant) uniform Push {
-    vec4 billboardColor;
-    vec2 billboardDimensions;
-    vec3 billboardPosition;
-} push;
+//Must match BillboardRenderSystem::Instance
+struct Billboard {
+    vec4 position;
+    vec4 color; //w is intensity
+    vec4 dimensions; //zw are unused
+};
 
-layout(binding = 0) uniform UniformBufferObject {
+layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 projMat;
     mat4 viewMat;
 } ubo;
 
-const vec2 VERTEX_OFFSETS[6] = vec2[](
-    vec2(-1.0, -1.0),
-    vec2(-1.0, 1.0),
-    vec2(1.0, -1.0),
-    vec2(1.0, -1.0),
-    vec2(-1.0, 1.0),
-    vec2(1.0, 1.0)
-);
+layout(std430, set = 0, binding = 1) readonly buffer Billboards {
+    Billboard billboards[];
+};
 
 void main() {
+    Billboard billboard = billboards[gl_InstanceIndex];
     fragVertexOffset = VERTEX_OFFSETS[gl_VertexIndex];
-    vec3 cameraRightWorldDir = {ubo.viewMat[0][0], ubo.viewMat[1][0], ubo.viewMat[2][0]};
-    vec3 cameraUpWorldDir = {ubo.viewMat[0][1], ubo.viewMat[1][1], ubo.viewMat[2][1]};
-
-    vec3 vertexPosWorld = push.billboardPosition + ((fragVertexOffset.x * push.billboardDimensions.x) * cameraRightWorldDir)
-                                            + ((fragVertexOffset.y * push.billboardDimensions.y) * cameraUpWorldDir);
-
-    gl_Position = ubo.projMat * ubo.viewMat * vec4(vertexPosWorld, 1.0);
+    fragColor = billboard.color;
+    gl_Position = billboardClipPosition(billboard.position.xyz, billboard.dimensions.xy, fragVertexOffset, ubo.viewMat, ubo.projMat);
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+#version 450
+
+//Must match DefaultRenderSystem, ClusterLights.comp and SimpleShader.frag
+#define MAX_LIGHTS_PER_CLUSTER 127
+
+layout(location = 0) in vec2 fragUv;
+
+layout (location = 0) out vec4 outColor;
+
+struct PointLight {
+    vec4 position; //w is the radius
+    vec4 color; //w is intensity
+};
+
+struct Cluster {
+    uint lightCount;
+    uint lightIndices[MAX_LIGHTS_PER_CLUSTER];
+};
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 projMat;
+    mat4 viewMat;
+    mat4 inverseProjMat;
+    vec4 ambientLightColor;
+    uvec4 clusterGrid; //xyz is the cluster count per axis, w is the light count
+    vec4 clusterDepth; //x is near, y is far, z is the z slice count over log(far / near)
+    mat4 inverseViewMat;
+} ubo;
+
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Clusters {
+    Cluster clusters[];
+};
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedoInput;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normalInput;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput depthInput;
+
+uint findCluster(vec3 viewPos) {
+    uvec2 tile = uvec2(clamp(fragUv * vec2(ubo.clusterGrid.xy), vec2(0.0), vec2(ubo.clusterGrid.xy - 1u)));
+    float slice = log(max(viewPos.z, ubo.clusterDepth.x) / ubo.clusterDepth.x) * ubo.clusterDepth.z;
+    uint z = min(uint(slice), ubo.clusterGrid.z - 1u);
+    return tile.x + ubo.clusterGrid.x * (tile.y + ubo.clusterGrid.y * z);
+}
+
+void main() {
+    float depth = subpassLoad(depthInput).r;
+    //Nothing was drawn here, keep the clear color
+    if (depth >= 1.0) discard;
+
+    vec4 albedo = subpassLoad(albedoInput);
+    vec4 normal = subpassLoad(normalInput);
+    //Written by an unlit material
+    if (normal.a > 0.5) {
+        outColor = albedo;
+        return;
+    }
+
+    vec4 viewPos = ubo.inverseProjMat * vec4(fragUv * 2.0 - 1.0, depth, 1.0);
+    viewPos /= viewPos.w;
+    vec3 worldPos = (ubo.inverseViewMat * viewPos).xyz;
+    vec3 normalWorld = normalize(normal.xyz * 2.0 - 1.0);
+
+    vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+    uint clusterIndex = findCluster(viewPos.xyz);
+    uint lightCount = clusters[clusterIndex].lightCount;
+    for (uint i = 0u; i < lightCount; i++) {
+        PointLight light = lights[clusters[clusterIndex].lightIndices[i]];
+        vec3 directionToLight = light.position.xyz - worldPos;
+        float distanceSquared = dot(directionToLight, directionToLight);
+        //Inverse square falloff windowed to reach exactly zero at the light's radius
+        float window = clamp(1.0 - pow(distanceSquared / (light.position.w * light.position.w), 2.0), 0.0, 1.0);
+        float attenuation = window * window / max(distanceSquared, 0.0001);
+        vec3 lightColor = light.color.xyz * light.color.w;
+        diffuseLight += attenuation * lightColor * max(dot(normalWorld, normalize(directionToLight)), 0);
+    }
+
+    outColor = vec4(diffuseLight * albedo.rgb, albedo.a);
+}
\ No newline at end of file
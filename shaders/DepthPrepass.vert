@@ -0,0 +1,30 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+    uint objectIndex;
+} push;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 projMat;
+    mat4 viewMat;
+} ubo;
+
+//Written by TransformBatch, indexed by the object's index in the render system
+struct ObjectTransform {
+    mat4 modelMat;
+    mat4 normalMat;
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer Transforms {
+    ObjectTransform transforms[];
+};
+
+//Must compute exactly the same depth as SimpleShader.vert for the main pass' equal depth test
+invariant gl_Position;
+
+void main() {
+    vec4 vertexWorldPos = transforms[push.objectIndex].modelMat * vec4(position, 1.0);
+    gl_Position = ubo.projMat * ubo.viewMat * vertexWorldPos;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#version 450
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragWorldPos;
+layout(location = 2) in vec3 fragNormalWorld;
+layout(location = 3) in vec2 fragUv;
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+
+//Picked per material, see ShaderVariantKey. The light count limit doesn't apply, lighting is done per pixel afterwards.
+layout(constant_id = 0) const bool LIGHTING = true;
+layout(constant_id = 1) const bool TEXTURED = true;
+
+layout(set = 1, binding = 1) uniform sampler2D texSampler;
+
+void main() {
+    outAlbedo = TEXTURED ? texture(texSampler, fragUv) : vec4(fragColor, 1.0);
+    //Packed into [0, 1] for the unorm attachment, alpha tells the lighting pass to leave unlit pixels as they are
+    outNormal = vec4(normalize(fragNormalWorld) * 0.5 + 0.5, LIGHTING ? 0.0 : 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+//Must match ParticleRenderSystem
+
+struct Particle {
+    vec4 position; //w is the age in seconds
+    vec4 velocity; //w is the lifetime in seconds
+    vec4 color; //w is intensity
+    vec4 acceleration; //w is the size
+};
+
+//Doubles as the indirect draw and dispatch arguments
+layout(std430, set = 0, binding = 2) buffer State {
+    uint vertexCount;
+    uint instanceCount; //Particles written to the destination buffer this frame
+    uint firstVertex;
+    uint firstInstance;
+    uint simulateGroupCountX;
+    uint simulateGroupCountY;
+    uint simulateGroupCountZ;
+    uint aliveCount; //Particles in the source buffer
+} state;
\ No newline at end of file
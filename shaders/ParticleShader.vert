@@ -0,0 +1,35 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "Billboard.glsl"
+
+layout(location = 0) out vec2 fragVertexOffset;
+layout(location = 1) flat out vec4 fragColor;
+
+//Must match Particle.glsl
+struct Particle {
+    vec4 position; //w is the age in seconds
+    vec4 velocity; //w is the lifetime in seconds
+    vec4 color; //w is intensity
+    vec4 acceleration; //w is the size
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Particles {
+    Particle particles[];
+};
+
+layout(set = 1, binding = 0) uniform UniformBufferObject {
+    mat4 projMat;
+    mat4 viewMat;
+} ubo;
+
+void main() {
+    Particle particle = particles[gl_InstanceIndex];
+    fragVertexOffset = VERTEX_OFFSETS[gl_VertexIndex];
+    //Particles are blended additively, so fading the intensity fades them out
+    float fade = 1.0 - particle.position.w / particle.velocity.w;
+    fragColor = vec4(particle.color.xyz, particle.color.w * fade);
+    gl_Position = billboardClipPosition(
+        particle.position.xyz, vec2(particle.acceleration.w), fragVertexOffset, ubo.viewMat, ubo.projMat
+    );
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #version 450
 
+//Must match DefaultRenderSystem, ClusterLights.comp and DeferredLighting.frag
+#define MAX_LIGHTS_PER_CLUSTER 127
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragWorldPos;
 layout(location = 2) in vec3 fragNormalWorld;
@@ -7,34 +10,72 @@ layout(location = 3) in vec2 fragUv;
 
 layout (location = 0) out vec4 outColor;
 
-layout(push_constant) uniform Push {
-    mat4 modelMat;
-    mat4 normalMat;
-} push;
+//Picked per material, see ShaderVariantKey
+layout(constant_id = 0) const bool LIGHTING = true;
+layout(constant_id = 1) const bool TEXTURED = true;
+layout(constant_id = 2) const uint MAX_LIGHTS = 0xffffffffu;
 
 struct PointLight {
-    vec4 position;
-    vec4 color;
+    vec4 position; //w is the radius
+    vec4 color; //w is intensity
+};
+
+struct Cluster {
+    uint lightCount;
+    uint lightIndices[MAX_LIGHTS_PER_CLUSTER];
 };
 
 layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 projMat;
     mat4 viewMat;
+    mat4 inverseProjMat;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterGrid; //xyz is the cluster count per axis, w is the light count
+    vec4 clusterDepth; //x is near, y is far, z is the z slice count over log(far / near)
+    mat4 inverseViewMat;
 } ubo;
 
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Clusters {
+    Cluster clusters[];
+};
+
 layout(set = 1, binding = 1) uniform sampler2D texSampler;
 
+uint findCluster() {
+    vec4 viewPos = ubo.viewMat * vec4(fragWorldPos, 1.0);
+    vec4 clipPos = ubo.projMat * viewPos;
+    uvec2 tile = uvec2(clamp((clipPos.xy / clipPos.w * 0.5 + 0.5) * vec2(ubo.clusterGrid.xy), vec2(0.0), vec2(ubo.clusterGrid.xy - 1u)));
+    float slice = log(max(viewPos.z, ubo.clusterDepth.x) / ubo.clusterDepth.x) * ubo.clusterDepth.z;
+    uint z = min(uint(slice), ubo.clusterGrid.z - 1u);
+    return tile.x + ubo.clusterGrid.x * (tile.y + ubo.clusterGrid.y * z);
+}
+
 void main() {
+    vec4 baseColor = TEXTURED ? texture(texSampler, fragUv) : vec4(fragColor, 1.0);
+    if (!LIGHTING) {
+        outColor = baseColor;
+        return;
+    }
+
     vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
     vec3 normalWorld = normalize(fragNormalWorld);
-    for (int i = 0; i < ubo.numLights; i++) {
-        vec3 directionToLight = ubo.pointLights[i].position.xyz - fragWorldPos;
-        float attenuation = 1.0 / dot(directionToLight, directionToLight); //distance squared
-        vec3 lightColor = ubo.pointLights[i].color.xyz * ubo.pointLights[i].color.w;
+
+    uint clusterIndex = findCluster();
+    uint lightCount = min(clusters[clusterIndex].lightCount, MAX_LIGHTS);
+    for (uint i = 0u; i < lightCount; i++) {
+        PointLight light = lights[clusters[clusterIndex].lightIndices[i]];
+        vec3 directionToLight = light.position.xyz - fragWorldPos;
+        float distanceSquared = dot(directionToLight, directionToLight);
+        //Inverse square falloff windowed to reach exactly zero at the light's radius
+        float window = clamp(1.0 - pow(distanceSquared / (light.position.w * light.position.w), 2.0), 0.0, 1.0);
+        float attenuation = window * window / max(distanceSquared, 0.0001);
+        vec3 lightColor = light.color.xyz * light.color.w;
         diffuseLight += attenuation * lightColor * max(dot(normalWorld, normalize(directionToLight)), 0);
     }
-    outColor = texture(texSampler, fragUv);
+
+    outColor = vec4(diffuseLight * baseColor.rgb, baseColor.a);
 }
\ No newline at end of file
@@ -10,29 +10,37 @@ layout(location = 1) out vec3 fragWorldPos;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUv;
 
+//Must compute exactly the same depth as DepthPrepass.vert for the main pass' equal depth test
+invariant gl_Position;
+
 layout(push_constant) uniform Push {
-    mat4 modelMat;
-    mat4 normalMat;
+    uint objectIndex;
 } push;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 projMat;
     mat4 viewMat;
+    mat4 inverseProjMat;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterGrid;
+    vec4 clusterDepth;
+    mat4 inverseViewMat;
 } ubo;
 
-layout(set = 1, binding = 1) uniform sampler2D texSampler;
+//Written by TransformBatch, indexed by the object's index in the render system
+struct ObjectTransform {
+    mat4 modelMat;
+    mat4 normalMat;
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer Transforms {
+    ObjectTransform transforms[];
+};
 
 void main() {
-    vec4 vertexWorldPos = push.modelMat * vec4(position, 1.0);
-    vec3 normalWorld = normalize(mat3(push.normalMat) * normal);
+    ObjectTransform transform = transforms[push.objectIndex];
+    vec4 vertexWorldPos = transform.modelMat * vec4(position, 1.0);
+    vec3 normalWorld = normalize(mat3(transform.normalMat) * normal);
 
     gl_Position = ubo.projMat * ubo.viewMat * vertexWorldPos;
 
@@ -0,0 +1,309 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace rkrai {
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float fatMargin) : fatMargin(fatMargin) {}
+
+BoundingVolumeHierarchy::ProxyId BoundingVolumeHierarchy::allocateNode() {
+    if (freeList == NULL_PROXY) {
+        nodes.emplace_back();
+        nodes.back().height = 0;
+        return static_cast<ProxyId>(nodes.size() - 1);
+    }
+    ProxyId nodeId = freeList;
+    freeList = nodes[nodeId].parent;
+    nodes[nodeId] = Node{};
+    nodes[nodeId].height = 0;
+    return nodeId;
+}
+
+void BoundingVolumeHierarchy::freeNode(ProxyId nodeId) {
+    nodes[nodeId].parent = freeList;
+    nodes[nodeId].height = -1;
+    freeList = nodeId;
+}
+
+BoundingVolumeHierarchy::ProxyId BoundingVolumeHierarchy::createProxy(const AABB& bounds, uint32_t userData) {
+    ProxyId proxyId = allocateNode();
+    const glm::vec3 margin{fatMargin};
+    nodes[proxyId].bounds = {bounds.min - margin, bounds.max + margin};
+    nodes[proxyId].userData = userData;
+    insertLeaf(proxyId);
+    proxyCount++;
+    return proxyId;
+}
+
+void BoundingVolumeHierarchy::destroyProxy(ProxyId proxyId) {
+    assert(proxyId >= 0 && static_cast<size_t>(proxyId) < nodes.size() && nodes[proxyId].isLeaf() && "Invalid proxy id!");
+    removeLeaf(proxyId);
+    freeNode(proxyId);
+    proxyCount--;
+}
+
+bool BoundingVolumeHierarchy::moveProxy(ProxyId proxyId, const AABB& bounds) {
+    assert(proxyId >= 0 && static_cast<size_t>(proxyId) < nodes.size() && nodes[proxyId].isLeaf() && "Invalid proxy id!");
+    if (nodes[proxyId].bounds.contains(bounds)) return false;
+
+    removeLeaf(proxyId);
+    const glm::vec3 margin{fatMargin};
+    nodes[proxyId].bounds = {bounds.min - margin, bounds.max + margin};
+    insertLeaf(proxyId);
+    return true;
+}
+
+// Descends towards the sibling that minimizes the total surface area of the tree,
+// using the branch and bound cost from Box2D's b2DynamicTree.
+void BoundingVolumeHierarchy::insertLeaf(ProxyId leaf) {
+    if (root == NULL_PROXY) {
+        root = leaf;
+        nodes[root].parent = NULL_PROXY;
+        return;
+    }
+
+    const AABB leafBounds = nodes[leaf].bounds;
+    ProxyId index = root;
+    while (!nodes[index].isLeaf()) {
+        ProxyId left = nodes[index].left;
+        ProxyId right = nodes[index].right;
+
+        float area = nodes[index].bounds.getSurfaceArea();
+        float combinedArea = AABB::merge(nodes[index].bounds, leafBounds).getSurfaceArea();
+
+        //Cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+        //Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](ProxyId child) {
+            float newArea = AABB::merge(leafBounds, nodes[child].bounds).getSurfaceArea();
+            if (nodes[child].isLeaf()) return newArea + inheritanceCost;
+            return newArea - nodes[child].bounds.getSurfaceArea() + inheritanceCost;
+        };
+        float leftCost = descendCost(left);
+        float rightCost = descendCost(right);
+
+        if (cost < leftCost && cost < rightCost) break;
+        index = leftCost < rightCost ? left : right;
+    }
+
+    ProxyId sibling = index;
+    ProxyId oldParent = nodes[sibling].parent;
+    ProxyId newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = AABB::merge(leafBounds, nodes[sibling].bounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_PROXY) {
+        root = newParent;
+    } else if (nodes[oldParent].left == sibling) {
+        nodes[oldParent].left = newParent;
+    } else {
+        nodes[oldParent].right = newParent;
+    }
+    refitAncestors(nodes[leaf].parent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(ProxyId leaf) {
+    if (leaf == root) {
+        root = NULL_PROXY;
+        return;
+    }
+
+    ProxyId parent = nodes[leaf].parent;
+    ProxyId grandParent = nodes[parent].parent;
+    ProxyId sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    if (grandParent == NULL_PROXY) {
+        root = sibling;
+        nodes[sibling].parent = NULL_PROXY;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].left == parent) {
+        nodes[grandParent].left = sibling;
+    } else {
+        nodes[grandParent].right = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    refitAncestors(grandParent);
+}
+
+void BoundingVolumeHierarchy::refitAncestors(ProxyId nodeId) {
+    while (nodeId != NULL_PROXY) {
+        nodeId = balance(nodeId);
+
+        ProxyId left = nodes[nodeId].left;
+        ProxyId right = nodes[nodeId].right;
+        nodes[nodeId].height = 1 + std::max(nodes[left].height, nodes[right].height);
+        nodes[nodeId].bounds = AABB::merge(nodes[left].bounds, nodes[right].bounds);
+
+        nodeId = nodes[nodeId].parent;
+    }
+}
+
+// Performs a left or right rotation if the subtree rooted at a is imbalanced,
+// returning the new root of that subtree.
+BoundingVolumeHierarchy::ProxyId BoundingVolumeHierarchy::balance(ProxyId a) {
+    if (nodes[a].isLeaf() || nodes[a].height < 2) return a;
+
+    ProxyId b = nodes[a].left;
+    ProxyId c = nodes[a].right;
+    int32_t heightDifference = nodes[c].height - nodes[b].height;
+    if (heightDifference >= -1 && heightDifference <= 1) return a;
+
+    //Promote the taller child (c) and hand its shorter grandchild down to a
+    auto rotate = [&](ProxyId& aShortSlot, ProxyId& aTallSlot, ProxyId tall) {
+        ProxyId f = nodes[tall].left;
+        ProxyId g = nodes[tall].right;
+        ProxyId other = aShortSlot;
+
+        nodes[tall].left = a;
+        nodes[tall].parent = nodes[a].parent;
+        nodes[a].parent = tall;
+
+        ProxyId tallParent = nodes[tall].parent;
+        if (tallParent == NULL_PROXY) {
+            root = tall;
+        } else if (nodes[tallParent].left == a) {
+            nodes[tallParent].left = tall;
+        } else {
+            nodes[tallParent].right = tall;
+        }
+
+        ProxyId keep = nodes[f].height > nodes[g].height ? f : g;
+        ProxyId give = keep == f ? g : f;
+        nodes[tall].right = keep;
+        aTallSlot = give;
+        nodes[give].parent = a;
+        nodes[a].bounds = AABB::merge(nodes[other].bounds, nodes[give].bounds);
+        nodes[a].height = 1 + std::max(nodes[other].height, nodes[give].height);
+        nodes[tall].bounds = AABB::merge(nodes[a].bounds, nodes[keep].bounds);
+        nodes[tall].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+        return tall;
+    };
+
+    if (heightDifference > 1) {
+        return rotate(nodes[a].left, nodes[a].right, c);
+    }
+    return rotate(nodes[a].right, nodes[a].left, b);
+}
+
+void BoundingVolumeHierarchy::collectLeaves(ProxyId nodeId, std::vector<ProxyId>& results) const {
+    std::vector<ProxyId> stack{nodeId};
+    while (!stack.empty()) {
+        ProxyId index = stack.back();
+        stack.pop_back();
+        if (nodes[index].isLeaf()) {
+            results.push_back(index);
+        } else {
+            stack.push_back(nodes[index].left);
+            stack.push_back(nodes[index].right);
+        }
+    }
+}
+
+// Subtrees fully inside the frustum are taken whole without testing any of their children.
+void BoundingVolumeHierarchy::queryFrustum(const Frustum& frustum, std::vector<ProxyId>& results) const {
+    if (root == NULL_PROXY) return;
+
+    std::vector<ProxyId> stack{root};
+    while (!stack.empty()) {
+        ProxyId index = stack.back();
+        stack.pop_back();
+
+        Frustum::Containment containment = frustum.classify(nodes[index].bounds);
+        if (containment == Frustum::Containment::eOutside) continue;
+
+        if (containment == Frustum::Containment::eInside) {
+            collectLeaves(index, results);
+        } else if (nodes[index].isLeaf()) {
+            results.push_back(index);
+        } else {
+            stack.push_back(nodes[index].left);
+            stack.push_back(nodes[index].right);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::querySphere(const Sphere& sphere, std::vector<ProxyId>& results) const {
+    if (root == NULL_PROXY) return;
+
+    std::vector<ProxyId> stack{root};
+    while (!stack.empty()) {
+        ProxyId index = stack.back();
+        stack.pop_back();
+        if (!sphere.overlaps(nodes[index].bounds)) continue;
+
+        if (nodes[index].isLeaf()) {
+            results.push_back(index);
+        } else {
+            stack.push_back(nodes[index].left);
+            stack.push_back(nodes[index].right);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::queryAABB(const AABB& bounds, std::vector<ProxyId>& results) const {
+    if (root == NULL_PROXY) return;
+
+    std::vector<ProxyId> stack{root};
+    while (!stack.empty()) {
+        ProxyId index = stack.back();
+        stack.pop_back();
+        if (!bounds.overlaps(nodes[index].bounds)) continue;
+
+        if (nodes[index].isLeaf()) {
+            results.push_back(index);
+        } else {
+            stack.push_back(nodes[index].left);
+            stack.push_back(nodes[index].right);
+        }
+    }
+}
+
+std::optional<BoundingVolumeHierarchy::RayHit> BoundingVolumeHierarchy::raycast(
+    const Ray& ray, float maxDistance, const std::function<std::optional<float>(ProxyId)>& hitTest) const {
+    if (root == NULL_PROXY) return std::nullopt;
+    std::optional<float> rootEntry = ray.intersect(nodes[root].bounds, maxDistance);
+    if (!rootEntry) return std::nullopt;
+
+    std::optional<RayHit> closestHit;
+    float closestDistance = maxDistance;
+    std::vector<std::pair<ProxyId, float>> stack{{root, *rootEntry}};
+    while (!stack.empty()) {
+        auto [index, entry] = stack.back();
+        stack.pop_back();
+        if (entry > closestDistance) continue;
+
+        if (nodes[index].isLeaf()) {
+            std::optional<float> distance = hitTest(index);
+            if (distance && *distance <= closestDistance) {
+                closestDistance = *distance;
+                closestHit = RayHit{index, *distance};
+            }
+            continue;
+        }
+
+        std::optional<float> leftEntry = ray.intersect(nodes[nodes[index].left].bounds, closestDistance);
+        std::optional<float> rightEntry = ray.intersect(nodes[nodes[index].right].bounds, closestDistance);
+        //Push the farther child first so the nearer one is visited next
+        if (leftEntry && rightEntry && *leftEntry < *rightEntry) {
+            stack.emplace_back(nodes[index].right, *rightEntry);
+            stack.emplace_back(nodes[index].left, *leftEntry);
+        } else {
+            if (leftEntry) stack.emplace_back(nodes[index].left, *leftEntry);
+            if (rightEntry) stack.emplace_back(nodes[index].right, *rightEntry);
+        }
+    }
+    return closestHit;
+}
+}
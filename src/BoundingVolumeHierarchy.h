@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace rkrai {
+//A dynamic AABB tree. Leaves store slightly enlarged ("fat") bounds so that small movements
+//don't require the tree to be restructured, and the tree is kept balanced with AVL style rotations.
+class BoundingVolumeHierarchy {
+    public:
+    using ProxyId = int32_t;
+    static constexpr ProxyId NULL_PROXY = -1;
+
+    struct RayHit {
+        ProxyId proxyId;
+        float distance;
+    };
+
+    BoundingVolumeHierarchy(float fatMargin = 0.1f);
+    BoundingVolumeHierarchy(const BoundingVolumeHierarchy&) = delete;
+    void operator=(const BoundingVolumeHierarchy&) = delete;
+    BoundingVolumeHierarchy(BoundingVolumeHierarchy&&) = default;
+    BoundingVolumeHierarchy& operator=(BoundingVolumeHierarchy&&) = default;
+
+    ProxyId createProxy(const AABB& bounds, uint32_t userData);
+    void destroyProxy(ProxyId proxyId);
+    //Only reinserts the proxy if its new bounds escaped its fat bounds, returns true if it did
+    bool moveProxy(ProxyId proxyId, const AABB& bounds);
+
+    uint32_t getUserData(ProxyId proxyId) const { return nodes[proxyId].userData; }
+    const AABB& getFatBounds(ProxyId proxyId) const { return nodes[proxyId].bounds; }
+    size_t getProxyCount() const { return proxyCount; }
+    int getHeight() const { return root == NULL_PROXY ? 0 : nodes[root].height; }
+
+    void queryFrustum(const Frustum& frustum, std::vector<ProxyId>& results) const;
+    void querySphere(const Sphere& sphere, std::vector<ProxyId>& results) const;
+    void queryAABB(const AABB& bounds, std::vector<ProxyId>& results) const;
+    //Visits subtrees nearest first and lets hitTest refine a candidate to an exact distance
+    //(or reject it), so that anything further away than the current closest hit is skipped.
+    std::optional<RayHit> raycast(
+        const Ray& ray, float maxDistance, const std::function<std::optional<float>(ProxyId)>& hitTest) const;
+
+    private:
+    struct Node {
+        AABB bounds;
+        ProxyId parent = NULL_PROXY; //Doubles as the next pointer while the node is in the free list
+        ProxyId left = NULL_PROXY;
+        ProxyId right = NULL_PROXY;
+        int32_t height = -1; //Leaves have a height of 0, free nodes -1
+        uint32_t userData = 0;
+
+        bool isLeaf() const { return left == NULL_PROXY; }
+    };
+
+    float fatMargin;
+    std::vector<Node> nodes;
+    ProxyId root = NULL_PROXY;
+    ProxyId freeList = NULL_PROXY;
+    size_t proxyCount = 0;
+
+    ProxyId allocateNode();
+    void freeNode(ProxyId nodeId);
+    void insertLeaf(ProxyId leaf);
+    void removeLeaf(ProxyId leaf);
+    void refitAncestors(ProxyId nodeId);
+    ProxyId balance(ProxyId nodeId);
+    void collectLeaves(ProxyId nodeId, std::vector<ProxyId>& results) const;
+};
+}
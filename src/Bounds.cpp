@@ -0,0 +1,82 @@
+#include "Bounds.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <algorithm>
+
+namespace rkrai {
+// Transforming all eight corners is wasteful, instead the extents are carried through
+// the absolute value of the rotation/scale part of the matrix (Arvo's method).
+AABB AABB::transformed(const glm::mat4& matrix) const {
+    const glm::vec3 center{matrix * glm::vec4{getCenter(), 1.0f}};
+    const glm::vec3 extents = getExtents();
+    const glm::vec3 newExtents{
+        glm::abs(matrix[0][0]) * extents.x + glm::abs(matrix[1][0]) * extents.y + glm::abs(matrix[2][0]) * extents.z,
+        glm::abs(matrix[0][1]) * extents.x + glm::abs(matrix[1][1]) * extents.y + glm::abs(matrix[2][1]) * extents.z,
+        glm::abs(matrix[0][2]) * extents.x + glm::abs(matrix[1][2]) * extents.y + glm::abs(matrix[2][2]) * extents.z
+    };
+    return {center - newExtents, center + newExtents};
+}
+
+bool Sphere::overlaps(const AABB& box) const {
+    glm::vec3 closestPoint = glm::clamp(center, box.min, box.max);
+    glm::vec3 offset = closestPoint - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+std::optional<float> Ray::intersect(const AABB& box, float maxDistance) const {
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    const glm::vec3 t1 = (box.min - origin) * inverseDirection;
+    const glm::vec3 t2 = (box.max - origin) * inverseDirection;
+    const glm::vec3 tMin = glm::min(t1, t2);
+    const glm::vec3 tMax = glm::max(t1, t2);
+
+    float entry = std::max({tMin.x, tMin.y, tMin.z, 0.0f});
+    float exit = std::min({tMax.x, tMax.y, tMax.z, maxDistance});
+    if (entry > exit) return std::nullopt;
+    return entry;
+}
+
+// Rows of the combined matrix give the clip planes directly (Gribb & Hartmann).
+// Since vulkan clips z to [0, w] rather than [-w, w], the near plane is just the third row.
+Frustum Frustum::fromMatrix(const glm::mat4& projView) {
+    auto row = [&](int i) { return glm::vec4{projView[0][i], projView[1][i], projView[2][i], projView[3][i]}; };
+
+    Frustum frustum{};
+    frustum.planes = {
+        row(3) + row(0), //left
+        row(3) - row(0), //right
+        row(3) + row(1), //top
+        row(3) - row(1), //bottom
+        row(2),          //near
+        row(3) - row(2)  //far
+    };
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3{plane});
+    }
+    return frustum;
+}
+
+Frustum::Containment Frustum::classify(const AABB& box) const {
+    const glm::vec3 center = box.getCenter();
+    const glm::vec3 extents = box.getExtents();
+
+    Containment result = Containment::eInside;
+    for (const auto& plane : planes) {
+        const glm::vec3 normal{plane};
+        float distance = glm::dot(normal, center) + plane.w;
+        float radius = glm::dot(extents, glm::abs(normal));
+        if (distance + radius < 0.0f) return Containment::eOutside;
+        if (distance - radius < 0.0f) result = Containment::eIntersecting;
+    }
+    return result;
+}
+
+bool Frustum::intersects(const Sphere& sphere) const {
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3{plane}, sphere.center) + plane.w < -sphere.radius) return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <array>
+#include <limits>
+#include <optional>
+
+namespace rkrai {
+struct AABB {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    static AABB fromPoint(glm::vec3 point) { return {point, point}; }
+
+    bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 getCenter() const { return 0.5f * (min + max); }
+    glm::vec3 getExtents() const { return 0.5f * (max - min); }
+    float getSurfaceArea() const {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    void expand(glm::vec3 point) { min = glm::min(min, point); max = glm::max(max, point); }
+    void expand(const AABB& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+    bool contains(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+    bool overlaps(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    AABB transformed(const glm::mat4& matrix) const;
+    static AABB merge(const AABB& a, const AABB& b) { return {glm::min(a.min, b.min), glm::max(a.max, b.max)}; }
+};
+
+struct Sphere {
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+
+    bool overlaps(const AABB& box) const;
+};
+
+struct Ray {
+    glm::vec3 origin{0.0f};
+    glm::vec3 direction{0.0f, 0.0f, 1.0f};
+
+    //Returns the distance along the ray at which it enters the box, if it hits it at all
+    std::optional<float> intersect(const AABB& box, float maxDistance = std::numeric_limits<float>::max()) const;
+};
+
+class Frustum {
+    public:
+    enum class Containment { eOutside, eIntersecting, eInside };
+
+    //Extracts the six clip planes from a projection * view matrix using vulkan's [0, 1] depth range
+    static Frustum fromMatrix(const glm::mat4& projView);
+
+    Containment classify(const AABB& box) const;
+    bool intersects(const AABB& box) const { return classify(box) != Containment::eOutside; }
+    bool intersects(const Sphere& sphere) const;
+
+    private:
+    //Planes are stored as (normal, distance) with normals facing into the frustum
+    std::array<glm::vec4, 6> planes;
+};
+}
@@ -15,6 +15,8 @@ void Camera::setOrthographicProjection(float left, float right, float top, float
     projectionMatrix[3][0] = -(left + right) / (right - left);
     projectionMatrix[3][1] = -(top + bottom) / (bottom - top);
     projectionMatrix[3][2] = -near / (far - near);
+    nearPlane = near;
+    farPlane = far;
 }
  
 void Camera::setPerspectiveProjection(float fovY, float aspect, float near, float far) {
@@ -25,6 +27,8 @@ void Camera::setPerspectiveProjection(float fovY, float aspect, float near, floa
     projectionMatrix[2][2] = far / (far - near);
     projectionMatrix[2][3] = 1;
     projectionMatrix[3][2] = -(far * near) / (far - near); 
+    nearPlane = near;
+    farPlane = far;
 }
 
 //By multiplying the inverse of the camera's translation with the transpose of the camera's
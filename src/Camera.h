@@ -16,9 +16,13 @@ class Camera {
 
     const glm::mat4& getProjection() const { return projectionMatrix; }
     const glm::mat4& getView() const { return viewMatrix; }
+    float getNear() const { return nearPlane; }
+    float getFar() const { return farPlane; }
     
     private:
     glm::mat4 projectionMatrix{1.0f};
     glm::mat4 viewMatrix{1.0f};
+    float nearPlane = 0.1f;
+    float farPlane = 1000.0f;
 };
 }
\ No newline at end of file
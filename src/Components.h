@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Model.h"
+#include "SceneGraph.h"
+#include "Texture.h"
+#include "TransformComponent.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rkrai {
+//Places the entity in the scene graph, which holds its transform
+struct SceneNodeComponent {
+    SceneGraph::NodeId node = SceneGraph::NO_NODE;
+};
+
+//Drawn by the DefaultRenderSystem, the model and texture are shared by every entity using them
+struct MeshComponent {
+    std::shared_ptr<Model> model;
+    std::shared_ptr<Texture> texture; //Optional
+};
+
+struct BillboardComponent {
+    glm::vec4 color{1.0f}; //w is intensity
+    glm::vec2 dimensions{0.1f};
+};
+
+struct PointLightComponent {
+    glm::vec4 color{1.0f}; //w is intensity
+    float radius = 10.0f; //Distance at which the light has faded out completely
+};
+
+//Spawns particles at the entity's position that are simulated and drawn entirely on the gpu
+struct ParticleEmitterComponent {
+    glm::vec4 color{1.0f}; //w is intensity
+    glm::vec3 velocity{0.0f, -1.0f, 0.0f}; //Initial velocity of every particle
+    float velocitySpread = 0.5f; //Largest random offset added to each axis of the initial velocity
+    glm::vec3 acceleration{0.0f, 1.0f, 0.0f};
+    float emissionRate = 1000.0f; //Particles per second
+    float lifetime = 2.0f; //Seconds
+    float size = 0.01f;
+    float emissionRemainder = 0.0f; //Fraction of a particle still owed, carried over to the next frame
+};
+
+//Lets simple meshes be drawn with a cheaper shader variant. Meshes without one are lit by every light of their
+//cluster, and whether a texture is sampled follows from the mesh having one.
+struct MaterialComponent {
+    bool lit = true;
+    //Upper bound on the lights shading each fragment, only honored by forward shading
+    uint32_t maxLights = UINT32_MAX;
+};
+
+//Low poly, closed stand-in for a model that the software occlusion culler rasterizes on the cpu
+struct OccluderComponent {
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+};
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "ComputePipeline.h"
+#include "GraphicsPipeline.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <cassert>
+
+namespace rkrai {
+ComputePipeline::ComputePipeline(GraphicsDevice& graphicsDevice, const std::string& compFilepath, vk::PipelineLayout pipelineLayout)
+    : graphicsDevice(graphicsDevice) {
+    createComputePipeline(compFilepath, pipelineLayout);
+}
+
+void ComputePipeline::createComputePipeline(const std::string& compFilepath, vk::PipelineLayout pipelineLayout) {
+    assert(pipelineLayout && "Cannot create compute pipeline: no pipelineLayout provided!");
+
+    std::vector<char> compCode = GraphicsPipeline::readFile(compFilepath);
+    compShaderModule = createShaderModule(compCode);
+
+    vk::ComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.stage = vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eCompute, *compShaderModule, "main"};
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    computePipeline = graphicsDevice.getDevice().createComputePipelineUnique(graphicsDevice.getPipelineCache(), pipelineInfo).value;
+}
+
+vk::UniqueShaderModule ComputePipeline::createShaderModule(const std::vector<char>& code) {
+    return graphicsDevice.getDevice().createShaderModuleUnique({
+        {}, code.size(), reinterpret_cast<const uint32_t*>(code.data())
+    });
+}
+
+void ComputePipeline::bind(vk::CommandBuffer commandBuffer) {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *computePipeline);
+}
+}
\ No newline at end of file
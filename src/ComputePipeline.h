@@ -0,0 +1,30 @@
+#pragma once
+
+#include "GraphicsDevice.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <string>
+#include <vector>
+
+namespace rkrai {
+class ComputePipeline {
+public:
+    ComputePipeline(GraphicsDevice& graphicsDevice, const std::string& compFilepath, vk::PipelineLayout pipelineLayout);
+    ComputePipeline(const ComputePipeline&) = delete;
+    void operator=(const ComputePipeline&) = delete;
+    ComputePipeline(ComputePipeline&&) = default;
+    ComputePipeline& operator=(ComputePipeline&&) = delete;
+
+    void bind(vk::CommandBuffer commandBuffer);
+
+private:
+    void createComputePipeline(const std::string& compFilepath, vk::PipelineLayout pipelineLayout);
+
+    vk::UniqueShaderModule createShaderModule(const std::vector<char>& code);
+
+    GraphicsDevice& graphicsDevice;
+    vk::UniquePipeline computePipeline;
+    vk::UniqueShaderModule compShaderModule;
+};
+}
\ No newline at end of file
@@ -38,6 +38,26 @@ void GraphicsBuffer::mapData(const void* data) {
     graphicsDevice.getDevice().unmapMemory(*bufferMemory);
 }
 
+void GraphicsBuffer::writeData(const void* data, vk::DeviceSize dataSize, vk::DeviceSize offset) {
+    void* pointer = graphicsDevice.getDevice().mapMemory(*bufferMemory, offset, dataSize);
+    memcpy(pointer, data, dataSize);
+    graphicsDevice.getDevice().unmapMemory(*bufferMemory);
+}
+
+void GraphicsBuffer::readData(void* data, vk::DeviceSize dataSize, vk::DeviceSize offset) {
+    void* pointer = graphicsDevice.getDevice().mapMemory(*bufferMemory, offset, dataSize);
+    memcpy(data, pointer, dataSize);
+    graphicsDevice.getDevice().unmapMemory(*bufferMemory);
+}
+
+void* GraphicsBuffer::map(vk::DeviceSize dataSize, vk::DeviceSize offset) {
+    return graphicsDevice.getDevice().mapMemory(*bufferMemory, offset, dataSize);
+}
+
+void GraphicsBuffer::unmap() {
+    graphicsDevice.getDevice().unmapMemory(*bufferMemory);
+}
+
 void GraphicsBuffer::copyToImage(vk::Image image, uint32_t width, uint32_t height) {
     vk::BufferImageCopy region{
         0, 0, 0,
@@ -18,6 +18,11 @@ class GraphicsBuffer {
 
     void copyFrom(const GraphicsBuffer& srcBuffer);
     void mapData(const void* data);
+    void writeData(const void* data, vk::DeviceSize dataSize, vk::DeviceSize offset = 0);
+    void readData(void* data, vk::DeviceSize dataSize, vk::DeviceSize offset = 0);
+    //For writing data in place instead of copying it in, the memory has to be host coherent
+    void* map(vk::DeviceSize dataSize = VK_WHOLE_SIZE, vk::DeviceSize offset = 0);
+    void unmap();
     void copyToImage(vk::Image image, uint32_t width, uint32_t height);
 
     vk::DeviceSize getSize() { return size; }
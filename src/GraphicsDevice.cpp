@@ -4,7 +4,11 @@
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <vector>
 #include <string.h>
@@ -14,7 +18,16 @@
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
 namespace rkrai {
-GraphicsDevice::GraphicsDevice(Window& window) : window(window) {
+GraphicsDevice::GraphicsDevice(Window& window) : window(&window) {
+    init();
+}
+
+GraphicsDevice::GraphicsDevice() {
+    init();
+}
+
+//Headless devices never touch GLFW
+void GraphicsDevice::init() {
     vk::DynamicLoader dl;
     VULKAN_HPP_DEFAULT_DISPATCHER.init(dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr"));
     VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
@@ -22,15 +35,26 @@ GraphicsDevice::GraphicsDevice(Window& window) : window(window) {
     if (validationLayersEnabled) {
         debugMessenger = instance->createDebugUtilsMessengerEXTUnique(getDebugMessengerCreateInfo());
     }
-    createSurface();
+    if (!isHeadless()) {
+        createSurface();
+    }
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    createFrameFences();
+    createPipelineCache();
+}
+
+GraphicsDevice::~GraphicsDevice() {
+    device->waitIdle();
+    retiredObjects.clear();
+    savePipelineCache();
 }
 
 void GraphicsDevice::createInstance() {
     if (validationLayersEnabled && !checkValidationLayerSupport()) {
-        throw std::runtime_error("Requested validations layers not supported.");
+        std::cerr << "Validation layers aren't available, running without them\n";
+        validationLayersEnabled = false;
     }
 
     vk::ApplicationInfo appInfo{
@@ -52,10 +76,12 @@ void GraphicsDevice::createInstance() {
 }
 
 std::vector<const char*> GraphicsDevice::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+    if (!isHeadless()) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (validationLayersEnabled) {
         extensions.push_back("VK_EXT_debug_utils");
@@ -67,7 +93,7 @@ bool GraphicsDevice::checkValidationLayerSupport() {
     for (const auto& validationLayer : validationLayers) {
         bool foundLayer = false;
         for (const auto& availableLayer : vk::enumerateInstanceLayerProperties()) {
-            if (strcmp(availableLayer.layerName, validationLayer)) {
+            if (strcmp(availableLayer.layerName, validationLayer) == 0) {
                 foundLayer = true;
                 break;
             }
@@ -99,7 +125,7 @@ vk::DebugUtilsMessengerCreateInfoEXT GraphicsDevice::getDebugMessengerCreateInfo
 
 void GraphicsDevice::createSurface() {
     VkSurfaceKHR nativeSurface;
-    window.createWindowSurface(*instance, &nativeSurface);
+    window->createWindowSurface(*instance, &nativeSurface);
     vk::UniqueSurfaceKHR uniqueSurface{vk::UniqueSurfaceKHR{nativeSurface, *instance}};
     surface.swap(uniqueSurface);
 }
@@ -123,28 +149,33 @@ void GraphicsDevice::pickPhysicalDevice() {
     }
 }
 
+//Headless, a graphics queue is all that's needed. Cpu implementations are only picked if there's nothing else.
 int GraphicsDevice::rateDeviceSuitability(vk::PhysicalDevice device) {
     vk::PhysicalDeviceProperties deviceProperties = device.getProperties();
-    vk::PhysicalDeviceFeatures deviceFeatures = device.getFeatures();
     QueueFamilyIndices queueFamilyIndices = findQueueFamilyIndices(device);
 
     int score = 0;
-    if (!deviceFeatures.geometryShader || !deviceFeatures.samplerAnisotropy
-    || !queueFamilyIndices.isComplete() || !hasRequiredDeviceExtensions(device)) return 0;
+    if (isHeadless()) {
+        if (!queueFamilyIndices.graphicsFamily) return 0;
+    } else {
+        if (!queueFamilyIndices.isComplete() || !hasDeviceExtensions(device, requiredDeviceExtensions)) return 0;
 
-    SwapChainSupportDetails swapChainSupport = getSwapChainSupportDetails(device);
-    if (swapChainSupport.surfaceFormats.empty() || swapChainSupport.presentModes.empty()) return 0;
+        SwapChainSupportDetails swapChainSupport = getSwapChainSupportDetails(device);
+        if (swapChainSupport.surfaceFormats.empty() || swapChainSupport.presentModes.empty()) return 0;
+    }
 
     if (deviceProperties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
         score += 1000;
+    } else if (deviceProperties.deviceType != vk::PhysicalDeviceType::eCpu) {
+        score += 500;
     }
     score += deviceProperties.limits.maxImageDimension2D;
     return score;
 }
 
-bool GraphicsDevice::hasRequiredDeviceExtensions(vk::PhysicalDevice device) {
+bool GraphicsDevice::hasDeviceExtensions(vk::PhysicalDevice device, const std::vector<const char*>& extensions) {
     std::vector<vk::ExtensionProperties> availableExtensions = device.enumerateDeviceExtensionProperties();
-    std::set<std::string> requiredExtensions(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -161,11 +192,11 @@ QueueFamilyIndices GraphicsDevice::findQueueFamilyIndices(vk::PhysicalDevice dev
             queueFamilyIndices.graphicsFamily = i;
         }
 
-        if (device.getSurfaceSupportKHR(i, *surface)) {
+        if (!isHeadless() && device.getSurfaceSupportKHR(i, *surface)) {
             queueFamilyIndices.presentFamily = i;
         }
         
-        if (queueFamilyIndices.isComplete()) break;
+        if (queueFamilyIndices.isComplete() || (isHeadless() && queueFamilyIndices.graphicsFamily)) break;
     }
     return queueFamilyIndices;
 }
@@ -174,22 +205,45 @@ void GraphicsDevice::createLogicalDevice() {
     QueueFamilyIndices queueFamilyIndices = findQueueFamilyIndices(physicalDevice);
 
     std::vector<vk::DeviceQueueCreateInfo> queueInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {
-        queueFamilyIndices.graphicsFamily.value(),
-        queueFamilyIndices.presentFamily.value()
-    };
+    std::set<uint32_t> uniqueQueueFamilies = {queueFamilyIndices.graphicsFamily.value()};
+    if (queueFamilyIndices.presentFamily) {
+        uniqueQueueFamilies.insert(queueFamilyIndices.presentFamily.value());
+    }
 
     std::array<float, 1> queuePriorities = {1.0f};
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         queueInfos.push_back({{}, queueFamily, queuePriorities});
     }
 
+    samplerAnisotropySupported = physicalDevice.getFeatures().samplerAnisotropy;
     vk::PhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.setSamplerAnisotropy(VK_TRUE);
+    deviceFeatures.setSamplerAnisotropy(samplerAnisotropySupported);
     vk::DeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.setQueueCreateInfos(queueInfos);
     deviceCreateInfo.setPEnabledFeatures(&deviceFeatures);
-    deviceCreateInfo.setPEnabledExtensionNames(requiredDeviceExtensions);
+
+    //Optional, frame pacing falls back to frames in flight without it. The features can only be queried once the
+    //extensions are known to exist.
+    std::vector<const char*> enabledExtensions;
+    if (!isHeadless()) {
+        enabledExtensions = requiredDeviceExtensions;
+    }
+    vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    if (!isHeadless() && hasDeviceExtensions(physicalDevice, presentWaitExtensions)) {
+        auto features = physicalDevice.getFeatures2<
+            vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR>();
+        presentWaitSupported = features.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId
+            && features.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    }
+    if (presentWaitSupported) {
+        enabledExtensions.insert(enabledExtensions.end(), presentWaitExtensions.begin(), presentWaitExtensions.end());
+        presentIdFeatures.setPresentId(VK_TRUE);
+        presentWaitFeatures.setPresentWait(VK_TRUE);
+        presentWaitFeatures.setPNext(&presentIdFeatures);
+        deviceCreateInfo.setPNext(&presentWaitFeatures);
+    }
+    deviceCreateInfo.setPEnabledExtensionNames(enabledExtensions);
 
     if (validationLayersEnabled) {
         deviceCreateInfo.enabledLayerCount = validationLayers.size();
@@ -200,7 +254,9 @@ void GraphicsDevice::createLogicalDevice() {
 
     device = physicalDevice.createDeviceUnique(deviceCreateInfo);
     graphicsQueue = device->getQueue(queueFamilyIndices.graphicsFamily.value(), 0);
-    presentQueue = device->getQueue(queueFamilyIndices.presentFamily.value(), 0);
+    if (queueFamilyIndices.presentFamily) {
+        presentQueue = device->getQueue(queueFamilyIndices.presentFamily.value(), 0);
+    }
     VULKAN_HPP_DEFAULT_DISPATCHER.init(*device);
 }
 
@@ -214,16 +270,22 @@ SwapChainSupportDetails GraphicsDevice::getSwapChainSupportDetails(vk::PhysicalD
 
 vk::Format GraphicsDevice::findSupportedFormat(const std::vector<vk::Format>& candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features) {
     for (vk::Format format : candidates) {
-        vk::FormatProperties props = physicalDevice.getFormatProperties(format);
-        if (tiling == vk::ImageTiling::eLinear && (props.linearTilingFeatures & features) == features) {
-            return format;
-        } else if (tiling == vk::ImageTiling::eOptimal && (props.optimalTilingFeatures & features) == features) {
-            return format;
-        }
+        if (hasFormatFeatures(format, tiling, features)) return format;
     }
     throw std::runtime_error("Failed to find supported format!");
 }
 
+bool GraphicsDevice::hasFormatFeatures(vk::Format format, vk::ImageTiling tiling, vk::FormatFeatureFlags features) {
+    vk::FormatProperties props = physicalDevice.getFormatProperties(format);
+    vk::FormatFeatureFlags supported = tiling == vk::ImageTiling::eLinear ? props.linearTilingFeatures : props.optimalTilingFeatures;
+    return (supported & features) == features;
+}
+
+uint32_t GraphicsDevice::getGraphicsTimestampValidBits() {
+    std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
+    return queueFamilies[getQueueFamilyIndices().graphicsFamily.value()].timestampValidBits;
+}
+
 void GraphicsDevice::createCommandPool() {
     commandPool = device->createCommandPoolUnique({
         vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
@@ -231,6 +293,94 @@ void GraphicsDevice::createCommandPool() {
     });
 }
 
+//Signaled, so that waiting for a frame index that was never submitted returns right away
+void GraphicsDevice::createFrameFences() {
+    frameFences.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    frameNumbers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, 0);
+    for (auto& fence : frameFences) {
+        fence = device->createFenceUnique({vk::FenceCreateFlagBits::eSignaled});
+    }
+}
+
+void GraphicsDevice::submitFrame(int frameIndex, const vk::SubmitInfo& submitInfo) {
+    device->resetFences(*frameFences[frameIndex]);
+    graphicsQueue.submit(submitInfo, *frameFences[frameIndex]);
+    std::lock_guard lock(retireMutex);
+    frameNumbers[frameIndex] = ++submittedFrameCount;
+}
+
+//Frames finish in the order they were submitted, so every frame up to the waited one has finished as well.
+//The released objects are destroyed after unlocking, so that destroying them never holds up threads retiring others.
+void GraphicsDevice::waitForFrame(int frameIndex) {
+    device->waitForFences(*frameFences[frameIndex], VK_TRUE, UINT64_MAX);
+    std::vector<RetiredObject> releasedObjects;
+    std::lock_guard lock(retireMutex);
+    finishedFrameCount = std::max(finishedFrameCount, frameNumbers[frameIndex]);
+    auto released = std::stable_partition(retiredObjects.begin(), retiredObjects.end(), [&](const RetiredObject& retired) {
+        return retired.lastUsedFrame > finishedFrameCount;
+    });
+    releasedObjects.assign(std::make_move_iterator(released), std::make_move_iterator(retiredObjects.end()));
+    retiredObjects.erase(released, retiredObjects.end());
+}
+
+uint64_t GraphicsDevice::getFrameNumber() {
+    std::lock_guard lock(retireMutex);
+    return submittedFrameCount + 1;
+}
+
+//Starts out with whatever the last run left on disk, as long as it was written by the same driver for the same device
+void GraphicsDevice::createPipelineCache() {
+    std::vector<char> cacheData;
+    std::ifstream file{PIPELINE_CACHE_PATH, std::ios::binary};
+    if (file.is_open()) {
+        cacheData.resize(std::filesystem::file_size(PIPELINE_CACHE_PATH));
+        file.read(cacheData.data(), cacheData.size());
+        if (!file.good() || !isPipelineCacheCompatible(cacheData)) {
+            cacheData.clear();
+        }
+    }
+
+    vk::PipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.initialDataSize = cacheData.size();
+    cacheInfo.pInitialData = cacheData.data();
+    pipelineCache = device->createPipelineCacheUnique(cacheInfo);
+}
+
+//Drivers are supposed to reject foreign caches themselves, but not all of them do it gracefully
+bool GraphicsDevice::isPipelineCacheCompatible(const std::vector<char>& cacheData) {
+    VkPipelineCacheHeaderVersionOne header{};
+    if (cacheData.size() < sizeof(header)) return false;
+    memcpy(&header, cacheData.data(), sizeof(header));
+
+    vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    return header.headerSize >= sizeof(header)
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+//Written to a temporary file first so that a crash halfway through can't leave a truncated cache behind
+void GraphicsDevice::savePipelineCache() {
+    if (!pipelineCache) return;
+    std::vector<uint8_t> cacheData = device->getPipelineCacheData(*pipelineCache);
+
+    std::string temporaryPath = std::string{PIPELINE_CACHE_PATH} + ".tmp";
+    std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(cacheData.data()), cacheData.size());
+    file.close();
+    if (!file.good()) {
+        std::cerr << "Failed to write pipeline cache to " << temporaryPath << '\n';
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, PIPELINE_CACHE_PATH, error);
+    if (error) {
+        std::cerr << "Failed to replace pipeline cache: " << error.message() << '\n';
+    }
+}
+
 uint32_t GraphicsDevice::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
     vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
 
@@ -241,4 +391,15 @@ uint32_t GraphicsDevice::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyF
     }
     throw std::runtime_error("Failed to find suitable memory type!");
 }
+
+bool GraphicsDevice::hasMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
+    vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return true;
+        }
+    }
+    return false;
+}
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #define VULKAN_HPP_NO_NODISCARD_WARNINGS
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <optional>
 #include <utility>
@@ -28,27 +31,76 @@ struct QueueFamilyIndices {
 class GraphicsDevice {
     public:
     GraphicsDevice(Window& window);
+    //Headless, without a surface to present to. Any device with a graphics queue will do, cpu implementations included.
+    GraphicsDevice();
+    //Writes the pipeline cache back to disk
+    ~GraphicsDevice();
     GraphicsDevice(const GraphicsDevice&) = delete;
     void operator=(const GraphicsDevice&) = delete;
 
     vk::Format findSupportedFormat(const std::vector<vk::Format>& candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
+    bool hasFormatFeatures(vk::Format format, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
     uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+    bool hasMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
     vk::Device getDevice() { return *device; }
+    bool isHeadless() const { return window == nullptr; }
     vk::SurfaceKHR getSurface() { return *surface; }
     QueueFamilyIndices getQueueFamilyIndices() { return findQueueFamilyIndices(physicalDevice); }
     SwapChainSupportDetails getSwapChainSupportDetails() { return getSwapChainSupportDetails(physicalDevice); }
     vk::CommandPool getCommandPool() { return *commandPool; }
+    //Shared by every pipeline and persisted across runs, safe to use from several threads at once
+    vk::PipelineCache getPipelineCache() { return *pipelineCache; }
     vk::Queue getGraphicsQueue() { return graphicsQueue; }
     vk::Queue getPresentQueue() { return presentQueue; }
     vk::PhysicalDeviceProperties getDeviceProperties() { return physicalDevice.getProperties(); }
+    //Bits of timestamps written on the graphics queue that are meaningful, 0 if it can't write timestamps
+    uint32_t getGraphicsTimestampValidBits();
+    //VK_KHR_present_id and VK_KHR_present_wait, which are enabled whenever the device has them
+    bool supportsPresentWait() const { return presentWaitSupported; }
+    //Enabled whenever the device has it, which not every cpu implementation does
+    bool supportsSamplerAnisotropy() const { return samplerAnisotropySupported; }
+
+    //Frames are numbered from one in the order they are submitted, each frame index has a fence that signals once the
+    //frame submitted with it last has finished. Only the render thread submits and waits for frames.
+    void submitFrame(int frameIndex, const vk::SubmitInfo& submitInfo);
+    //Returns once the frame last submitted with this index has finished, and destroys whatever was retired until then
+    void waitForFrame(int frameIndex);
+    vk::Fence getFrameFence(int frameIndex) { return *frameFences[frameIndex]; }
+    //The number of the frame being recorded, which is the next one to be submitted
+    uint64_t getFrameNumber();
+
+    //Deferred destruction for buffers, images, views, descriptor sets, pipelines and anything else the gpu may still
+    //be using, which would otherwise need the device to be idle before it could be destroyed. The object is destroyed
+    //once the frame it was last used in has finished, right away if it already has. Can be called from any thread.
+    template <typename T>
+    void retire(T object, uint64_t lastUsedFrame) {
+        std::shared_ptr<void> retired = std::make_shared<T>(std::move(object));
+        std::lock_guard lock(retireMutex);
+        if (lastUsedFrame <= finishedFrameCount) return;
+        retiredObjects.push_back({lastUsedFrame, std::move(retired)});
+    }
+    //For objects that any frame recorded so far could have used
+    template <typename T>
+    void retire(T object) {
+        retire(std::move(object), getFrameNumber());
+    }
 
     private:
+    struct RetiredObject {
+        uint64_t lastUsedFrame;
+        std::shared_ptr<void> object;
+    };
+
     const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char*> requiredDeviceExtensions = {"VK_KHR_swapchain"};
-    const bool validationLayersEnabled = true;
+    const std::vector<const char*> presentWaitExtensions = {"VK_KHR_present_id", "VK_KHR_present_wait"};
+    //Only a debugging aid, devices without the layers installed (like headless build machines) run without them
+    bool validationLayersEnabled = true;
+    static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
     
-    Window& window;
+    //nullptr when headless
+    Window* window = nullptr;
     vk::UniqueInstance instance;
     vk::UniqueDevice device;
     vk::UniqueDebugUtilsMessengerEXT debugMessenger;
@@ -57,7 +109,20 @@ class GraphicsDevice {
     vk::Queue graphicsQueue;
     vk::Queue presentQueue;
     vk::UniqueCommandPool commandPool;
-
+    vk::UniquePipelineCache pipelineCache;
+    bool presentWaitSupported = false;
+    bool samplerAnisotropySupported = false;
+
+    std::vector<vk::UniqueFence> frameFences;
+    //The number of the frame each frame index was last submitted with
+    std::vector<uint64_t> frameNumbers;
+    //Guards the frame counts as well, so that retiring from other threads sees them consistently
+    std::mutex retireMutex;
+    uint64_t submittedFrameCount = 0;
+    uint64_t finishedFrameCount = 0;
+    std::vector<RetiredObject> retiredObjects;
+
+    void init();
     void createInstance();
     std::vector<const char*> getRequiredExtensions();
 
@@ -69,7 +134,7 @@ class GraphicsDevice {
 
     void pickPhysicalDevice();
     int rateDeviceSuitability(vk::PhysicalDevice device);
-    bool hasRequiredDeviceExtensions(vk::PhysicalDevice device);
+    bool hasDeviceExtensions(vk::PhysicalDevice device, const std::vector<const char*>& extensions);
     QueueFamilyIndices findQueueFamilyIndices(vk::PhysicalDevice device);
 
     void createLogicalDevice();
@@ -77,6 +142,10 @@ class GraphicsDevice {
     SwapChainSupportDetails getSwapChainSupportDetails(vk::PhysicalDevice device);
 
     void createCommandPool();
+    void createFrameFences();
+    void createPipelineCache();
+    bool isPipelineCacheCompatible(const std::vector<char>& cacheData);
+    void savePipelineCache();
 
     VkCommandBuffer beginSingleTimeCommand();
     void endSingleTimeCommand(vk::CommandBuffer commandBuffer);
@@ -11,16 +11,20 @@
 
 namespace rkrai {
 PipelineConfigInfo::PipelineConfigInfo(const PipelineConfigInfo& other) 
-    : viewportInfo(other.viewportInfo), inputAssemblyInfo(other.inputAssemblyInfo),
+    : bindingDescriptions(other.bindingDescriptions), attributeDescriptions(other.attributeDescriptions),
+    viewportInfo(other.viewportInfo), inputAssemblyInfo(other.inputAssemblyInfo),
     rasterizationInfo(other.rasterizationInfo), multisampleInfo(other.multisampleInfo),
     colorBlendAttachment(other.colorBlendAttachment), colorBlendInfo(other.colorBlendInfo),
     depthStencilInfo(other.depthStencilInfo), dynamicStateEnables(other.dynamicStateEnables),
     dynamicStateInfo(other.dynamicStateInfo), pipelineLayout(other.pipelineLayout),
-    renderPass(other.renderPass), subpass(other.subpass) {
+    renderPass(other.renderPass), subpass(other.subpass), colorAttachmentCount(other.colorAttachmentCount),
+    specializationEntries(other.specializationEntries), specializationData(other.specializationData) {
     colorBlendInfo.pAttachments = &colorBlendAttachment;
     dynamicStateInfo.pDynamicStates = dynamicStateEnables.data();
 }
 PipelineConfigInfo& PipelineConfigInfo::operator=(const PipelineConfigInfo& other) {
+    bindingDescriptions = other.bindingDescriptions;
+    attributeDescriptions = other.attributeDescriptions;
     viewportInfo = other.viewportInfo;
     inputAssemblyInfo = other.inputAssemblyInfo;
     rasterizationInfo = other.rasterizationInfo;
@@ -33,12 +37,32 @@ PipelineConfigInfo& PipelineConfigInfo::operator=(const PipelineConfigInfo& othe
     pipelineLayout = other.pipelineLayout;
     renderPass = other.renderPass;
     subpass = other.subpass;
+    colorAttachmentCount = other.colorAttachmentCount;
+    specializationEntries = other.specializationEntries;
+    specializationData = other.specializationData;
 
     colorBlendInfo.pAttachments = &colorBlendAttachment;
     dynamicStateInfo.pDynamicStates = dynamicStateEnables.data();
     return *this;
 }
 
+void PipelineConfigInfo::setSpecializationConstant(uint32_t constantId, uint32_t value) {
+    for (const auto& entry : specializationEntries) {
+        if (entry.constantID == constantId) {
+            specializationData[entry.offset / sizeof(uint32_t)] = value;
+            return;
+        }
+    }
+    specializationEntries.push_back({constantId, static_cast<uint32_t>(specializationData.size() * sizeof(uint32_t)), sizeof(uint32_t)});
+    specializationData.push_back(value);
+}
+
+void ShaderVariantKey::apply(PipelineConfigInfo& configInfo) const {
+    configInfo.setSpecializationConstant(LIGHTING_CONSTANT_ID, lighting ? VK_TRUE : VK_FALSE);
+    configInfo.setSpecializationConstant(TEXTURED_CONSTANT_ID, textured ? VK_TRUE : VK_FALSE);
+    configInfo.setSpecializationConstant(MAX_LIGHTS_CONSTANT_ID, maxLights);
+}
+
 GraphicsPipeline::GraphicsPipeline(
     GraphicsDevice &graphicsDevice, 
     const std::string& vertFilepath, 
@@ -71,18 +95,31 @@ void GraphicsPipeline::createGraphicsPipeline(
     assert(configInfo.renderPass && "Cannot create graphics pipeline: no renderPass provided!");
     
     std::vector<char> vertCode = readFile(vertFilepath);
-    std::vector<char> fragCode = readFile(fragFilepath);
-
     vertShaderModule = createShaderModule(vertCode);
-    fragShaderModule = createShaderModule(fragCode);
 
-    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages{
-        vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eVertex, *vertShaderModule, "main"},
-        vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eFragment, *fragShaderModule, "main"}
+    const vk::SpecializationInfo specializationInfo{
+        static_cast<uint32_t>(configInfo.specializationEntries.size()), configInfo.specializationEntries.data(),
+        configInfo.specializationData.size() * sizeof(uint32_t), configInfo.specializationData.data()
+    };
+    const vk::SpecializationInfo* pSpecializationInfo = configInfo.specializationEntries.empty() ? nullptr : &specializationInfo;
+
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages{
+        vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eVertex, *vertShaderModule, "main", pSpecializationInfo}
     };
+    if (!fragFilepath.empty()) {
+        std::vector<char> fragCode = readFile(fragFilepath);
+        fragShaderModule = createShaderModule(fragCode);
+        shaderStages.push_back(
+            vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eFragment, *fragShaderModule, "main", pSpecializationInfo}
+        );
+    }
     
     vk::PipelineVertexInputStateCreateInfo vertexInputInfo{{}, configInfo.bindingDescriptions, configInfo.attributeDescriptions};
 
+    std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments(configInfo.colorAttachmentCount, configInfo.colorBlendAttachment);
+    vk::PipelineColorBlendStateCreateInfo colorBlendInfo = configInfo.colorBlendInfo;
+    colorBlendInfo.setAttachments(colorBlendAttachments);
+
     vk::GraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.setStages(shaderStages);
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -90,7 +127,7 @@ void GraphicsPipeline::createGraphicsPipeline(
     pipelineInfo.pViewportState = &configInfo.viewportInfo;
     pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
     pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
-    pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+    pipelineInfo.pColorBlendState = &colorBlendInfo;
     pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
     pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
 
@@ -101,7 +138,7 @@ void GraphicsPipeline::createGraphicsPipeline(
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    graphicsPipeline = graphicsDevice.getDevice().createGraphicsPipelineUnique({}, pipelineInfo).value;
+    graphicsPipeline = graphicsDevice.getDevice().createGraphicsPipelineUnique(graphicsDevice.getPipelineCache(), pipelineInfo).value;
 }
 
 vk::UniqueShaderModule GraphicsPipeline::createShaderModule(const std::vector<char>& code) {
@@ -4,6 +4,9 @@
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <utility>
@@ -24,13 +27,47 @@ struct PipelineConfigInfo {
     vk::PipelineLayout pipelineLayout = nullptr;
     vk::RenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    //Every color attachment of the subpass gets colorBlendAttachment's blend state
+    uint32_t colorAttachmentCount = 1;
+    //Shared by every stage, constants a stage doesn't declare are ignored by it
+    std::vector<vk::SpecializationMapEntry> specializationEntries;
+    std::vector<uint32_t> specializationData;
 
     PipelineConfigInfo() = default;
     PipelineConfigInfo(const PipelineConfigInfo& other);
     PipelineConfigInfo& operator=(const PipelineConfigInfo& other);
+
+    //Bools are 32 bits wide as specialization constants too
+    void setSpecializationConstant(uint32_t constantId, uint32_t value);
+};
+
+//Selects a variant of a shader through specialization constants. The driver compiles the disabled features out,
+//so simple materials don't pay for branches or texture reads they never need.
+struct ShaderVariantKey {
+    //Constant ids the shaders declare the features with
+    static constexpr uint32_t LIGHTING_CONSTANT_ID = 0;
+    static constexpr uint32_t TEXTURED_CONSTANT_ID = 1;
+    static constexpr uint32_t MAX_LIGHTS_CONSTANT_ID = 2;
+
+    //Unlit variants output the base color as is
+    bool lighting = true;
+    //Untextured variants use the vertex color instead of sampling set 1
+    bool textured = true;
+    //Upper bound on the lights shading a fragment, on top of the cluster's own limit
+    uint32_t maxLights = UINT32_MAX;
+
+    void apply(PipelineConfigInfo& configInfo) const;
+    bool operator==(const ShaderVariantKey& other) const = default;
+
+    struct Hash {
+        size_t operator()(const ShaderVariantKey& key) const {
+            return std::hash<uint64_t>{}((static_cast<uint64_t>(key.maxLights) << 2) | (key.lighting ? 2u : 0u) | (key.textured ? 1u : 0u));
+        }
+    };
 };
 class GraphicsPipeline {
 public:
+    //An empty fragFilepath creates a pipeline without a fragment shader, for depth only passes
     GraphicsPipeline(
         GraphicsDevice &graphicsDevice, 
         const std::string& vertFilepath, 
@@ -44,10 +81,9 @@ public:
     void bind(vk::CommandBuffer commandBuffer);
     
     static PipelineConfigInfo getDefaultPipelineConfigInfo();
-
-private:
     static std::vector<char> readFile(const std::string& filepath);
 
+private:
     void createGraphicsPipeline(
         const std::string& vertFilepath,
         const std::string& fragFilepath,
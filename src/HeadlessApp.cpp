@@ -0,0 +1,87 @@
+#include "HeadlessApp.h"
+#include "Camera.h"
+#include "Components.h"
+#include "Model.h"
+#include "RenderingSystems/DefaultRenderSystem.h"
+#include "Texture.h"
+
+#include <glm/glm.hpp>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+HeadlessApp::HeadlessApp(std::string outputPath) : outputPath(std::move(outputPath)) {
+    world->observeRemoval<rkrai::SceneNodeComponent>([this](rkrai::Entity, rkrai::SceneNodeComponent& sceneNode) {
+        sceneGraph->destroyNode(sceneNode.node);
+    });
+    loadEntities();
+}
+
+void HeadlessApp::run() {
+    renderer.setJobSystem(jobSystem);
+    renderer.setPipelineCompiler(pipelineCompiler);
+
+    auto camera = std::make_shared<rkrai::Camera>();
+    camera->setPerspectiveProjection(50.0f, renderer.getAspectRatio(), 0.1f, 1000.0f);
+    camera->setViewYXZ(glm::vec3{0.0f}, glm::vec3{0.0f});
+    auto defaultRenderSystem = std::make_shared<rkrai::DefaultRenderSystem>(
+        graphicsDevice, *pipelineCompiler, renderer.getSwapChainRenderPass(), camera, world, sceneGraph, renderer.getShadingPath(), renderer.getGBufferSetLayout()
+    );
+    renderer.addRenderSystem(defaultRenderSystem);
+    //Frames drawn without their pipelines would come out empty, there's nobody watching who'd mind the wait
+    pipelineCompiler->waitAll();
+
+    //Only the latest frame is kept, the readback's pixels are gone once the function returns
+    renderer.setReadbackFunction([this](const rkrai::FrameReadback& readback) {
+        assert(readback.format == rkrai::OffscreenTarget::IMAGE_FORMAT && "Readback isn't in the format the image is written in");
+        const auto* pixels = static_cast<const uint8_t*>(readback.pixels);
+        imageExtent = readback.extent;
+        imagePixels.assign(pixels, pixels + size_t{readback.extent.width} * readback.extent.height * 4);
+    });
+    for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+        jobSystem->runMainThreadJobs();
+        sceneGraph->update();
+        renderer.drawFrame();
+    }
+    renderer.finishFrames();
+    writeImage();
+    std::cout << "Wrote frame " << FRAME_COUNT << " to " << outputPath << '\n';
+
+    pipelineCompiler->waitAll();
+    vkDeviceWaitIdle(graphicsDevice.getDevice());
+}
+
+//The offscreen target's format is already sRGB encoded, so only the alpha channel is dropped
+void HeadlessApp::writeImage() const {
+    if (imagePixels.empty()) {
+        throw std::runtime_error("No frame was read back");
+    }
+    std::ofstream file{outputPath, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error("Failed to open " + outputPath);
+    }
+    file << "P6\n" << imageExtent.width << ' ' << imageExtent.height << "\n255\n";
+    for (size_t pixel = 0; pixel < imagePixels.size(); pixel += 4) {
+        file.write(reinterpret_cast<const char*>(&imagePixels[pixel]), 3);
+    }
+}
+
+void HeadlessApp::loadEntities() {
+    auto model = std::make_shared<rkrai::Model>(graphicsDevice, "models/viking_room.obj");
+    auto texture = std::make_shared<rkrai::Texture>(graphicsDevice, "textures/viking_room.png");
+    world->createEntity(
+        rkrai::SceneNodeComponent{sceneGraph->createNode({
+            .translation = {0.0f, 0.0f, 2.5f},
+            .scale = {1.0f, 1.0f, 1.0f},
+            .rotation = {glm::radians(90.0f), 0.0f, 0.0f}
+        })},
+        rkrai::MeshComponent{model, texture}
+    );
+
+    world->createEntity(
+        rkrai::SceneNodeComponent{sceneGraph->createNode({.translation = {0.0f, -1.0f, 1.0f}})},
+        rkrai::PointLightComponent{.color = glm::vec4{1.0f, 1.0f, 1.0f, 1.0f}}
+    );
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GraphicsDevice.h"
+#include "JobSystem.h"
+#include "OffscreenTarget.h"
+#include "PipelineCompiler.h"
+#include "Renderer.h"
+#include "SceneGraph.h"
+#include "World.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Draws the test scene without a window, for machines without a display. The last frame is read back and written
+//to disk as a binary PPM.
+class HeadlessApp {
+public:
+    static constexpr uint32_t WIDTH = 800;
+    static constexpr uint32_t HEIGHT = 600;
+    //Enough for every frame in flight to have been drawn a couple of times before the last one is kept
+    static constexpr uint32_t FRAME_COUNT = 8;
+
+    explicit HeadlessApp(std::string outputPath);
+
+    HeadlessApp(const HeadlessApp&) = delete;
+    void operator=(const HeadlessApp&) = delete;
+
+    void run();
+
+private:
+    void loadEntities();
+    void writeImage() const;
+
+    std::string outputPath;
+    vk::Extent2D imageExtent{0, 0};
+    std::vector<uint8_t> imagePixels;
+
+    std::shared_ptr<rkrai::JobSystem> jobSystem = std::make_shared<rkrai::JobSystem>();
+    rkrai::GraphicsDevice graphicsDevice{};
+    rkrai::Renderer renderer{graphicsDevice, vk::Extent2D{WIDTH, HEIGHT}};
+    std::shared_ptr<rkrai::PipelineCompiler> pipelineCompiler = std::make_shared<rkrai::PipelineCompiler>(graphicsDevice, jobSystem);
+
+    std::shared_ptr<rkrai::SceneGraph> sceneGraph = std::make_shared<rkrai::SceneGraph>();
+    std::shared_ptr<rkrai::World> world = std::make_shared<rkrai::World>();
+};
\ No newline at end of file
@@ -7,13 +7,18 @@
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_structs.hpp>
 #include <vulkan/vulkan_handles.hpp>
+#include <cassert>
 
 namespace rkrai {
 Image::Image(
-    GraphicsDevice& device, vk::ImageType imageType, vk::Extent3D imageExtent, vk::Format imageFormat, vk::ImageUsageFlags imageUsage) 
-    : graphicsDevice(device), imageType(imageType), imageExtent(imageExtent), imageFormat(imageFormat), imageUsage(imageUsage) {
+    GraphicsDevice& device, vk::ImageType imageType, vk::Extent3D imageExtent, vk::Format imageFormat, vk::ImageUsageFlags imageUsage,
+    uint32_t mipLevels, bool allocateMemory) 
+    : graphicsDevice(device), imageType(imageType), imageExtent(imageExtent), imageFormat(imageFormat), imageUsage(imageUsage),
+    mipLevels(mipLevels) {
     createImage();
-    allocateImageMemory();
+    if (allocateMemory) {
+        allocateImageMemory();
+    }
 }
 
 void Image::loadData(std::byte* data, vk::DeviceSize size) {
@@ -32,7 +37,7 @@ void Image::loadData(std::byte* data, vk::DeviceSize size) {
 
 void Image::createImage() {
     vk::ImageCreateInfo imageInfo{
-        {}, imageType, imageFormat, imageExtent, 1, 1,
+        {}, imageType, imageFormat, imageExtent, mipLevels, 1,
         vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, imageUsage, vk::SharingMode::eExclusive
     };
 
@@ -41,18 +46,35 @@ void Image::createImage() {
 
 void Image::allocateImageMemory() {
     vk::MemoryRequirements memRequiremnts = graphicsDevice.getDevice().getImageMemoryRequirements(*image);
-    uint32_t memType = graphicsDevice.findMemoryType(memRequiremnts.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    vk::MemoryPropertyFlags memProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    //Transient attachments never leave tile memory on tilers, so they only get backing if the driver needs it
+    if (imageUsage & vk::ImageUsageFlagBits::eTransientAttachment) {
+        vk::MemoryPropertyFlags lazyProperties = memProperties | vk::MemoryPropertyFlagBits::eLazilyAllocated;
+        if (graphicsDevice.hasMemoryType(memRequiremnts.memoryTypeBits, lazyProperties)) {
+            memProperties = lazyProperties;
+        }
+    }
+    uint32_t memType = graphicsDevice.findMemoryType(memRequiremnts.memoryTypeBits, memProperties);
 
     imageMemory = graphicsDevice.getDevice().allocateMemoryUnique({memRequiremnts.size, memType});
 
     graphicsDevice.getDevice().bindImageMemory(*image, *imageMemory, 0);
 }
 
+vk::MemoryRequirements Image::getMemoryRequirements() {
+    return graphicsDevice.getDevice().getImageMemoryRequirements(*image);
+}
+
+void Image::bindMemory(vk::DeviceMemory memory, vk::DeviceSize offset) {
+    assert(!imageMemory && "Image already owns its memory!");
+    graphicsDevice.getDevice().bindImageMemory(*image, memory, offset);
+}
+
 void Image::transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
     vk::ImageMemoryBarrier barrier{
         vk::AccessFlagBits::eNone, vk::AccessFlagBits::eNone,
         oldLayout, newLayout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image,
-        vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+        vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1}
     };
 
     vk::PipelineStageFlagBits sourceStage;
@@ -70,6 +92,12 @@ void Image::transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout new
 
         sourceStage = vk::PipelineStageFlagBits::eTransfer;
         destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+    } else if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eGeneral) {
+        barrier.srcAccessMask = vk::AccessFlagBits::eNone;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+        sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
+        destinationStage = vk::PipelineStageFlagBits::eComputeShader;
     } else {
         throw std::invalid_argument("unsupported layout transition!");
     }
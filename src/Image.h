@@ -10,12 +10,15 @@
 namespace rkrai {
 class Image {
     public:
+    //Without allocateMemory the image is left unbound, bindMemory has to be called before it's used
     Image(
         GraphicsDevice& device,
         vk::ImageType imageType,
         vk::Extent3D imageExtent,
         vk::Format imageFormat,
-        vk::ImageUsageFlags imageUsage
+        vk::ImageUsageFlags imageUsage,
+        uint32_t mipLevels = 1,
+        bool allocateMemory = true
     );
     Image(const Image&) = delete;
     void operator=(const Image&) = delete;
@@ -23,8 +26,15 @@ class Image {
     Image& operator=(Image&&) = delete;
 
     void loadData(std::byte* data, vk::DeviceSize size);
+    void transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+    vk::MemoryRequirements getMemoryRequirements();
+    //Binds memory owned by someone else, which lets images that are never used at the same time alias each other
+    void bindMemory(vk::DeviceMemory memory, vk::DeviceSize offset);
 
     vk::Image getImage() { return *image; }
+    vk::Extent3D getExtent() const { return imageExtent; }
+    vk::Format getFormat() const { return imageFormat; }
+    uint32_t getMipLevels() const { return mipLevels; }
 
     private:
     GraphicsDevice& graphicsDevice;
@@ -36,10 +46,10 @@ class Image {
     vk::Extent3D imageExtent;
     vk::Format imageFormat;
     vk::ImageUsageFlags imageUsage;
+    uint32_t mipLevels;
 
     void createImage();
     void allocateImageMemory();
-    void transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
 
     friend class ImageView;
 };
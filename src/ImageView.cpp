@@ -3,15 +3,15 @@
 #include <vulkan/vulkan_structs.hpp>
 
 namespace rkrai {
-ImageView::ImageView(Image& image, vk::ImageAspectFlags aspectFlags)
-: image(image), aspectFlags(aspectFlags) {
+ImageView::ImageView(Image& image, vk::ImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t levelCount)
+: image(image), aspectFlags(aspectFlags), baseMipLevel(baseMipLevel), levelCount(levelCount) {
     createImageView();
 }
 
 void ImageView::createImageView() {
     imageView = image.graphicsDevice.getDevice().createImageViewUnique({
         {}, image.getImage(), vk::ImageViewType::e2D, image.imageFormat, {},
-        vk::ImageSubresourceRange{aspectFlags, 0, 1, 0, 1}
+        vk::ImageSubresourceRange{aspectFlags, baseMipLevel, levelCount, 0, 1}
     });
 }
 }
\ No newline at end of file
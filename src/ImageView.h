@@ -8,7 +8,7 @@
 namespace rkrai {
 class ImageView {
     public:
-    ImageView(Image& image, vk::ImageAspectFlags aspectFlags);
+    ImageView(Image& image, vk::ImageAspectFlags aspectFlags, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
     ImageView(const ImageView&) = delete;
     void operator=(const ImageView&) = delete;
     ImageView(ImageView&&) = default;
@@ -21,6 +21,8 @@ class ImageView {
 
     vk::UniqueImageView imageView;
     vk::ImageAspectFlags aspectFlags;
+    uint32_t baseMipLevel;
+    uint32_t levelCount;
 
     void createImageView();
 };
@@ -0,0 +1,220 @@
+#include "JobSystem.h"
+
+#include <cassert>
+
+namespace rkrai {
+namespace {
+thread_local const JobSystem* currentJobSystem = nullptr;
+thread_local uint32_t currentWorkerIndex = 0;
+}
+
+bool JobSystem::JobHandle::isDone() const {
+    return job == nullptr || job->done.load(std::memory_order_acquire);
+}
+
+JobSystem::JobSystem(uint32_t threadCount) : mainThreadId(std::this_thread::get_id()) {
+    for (uint32_t i = 0; i < threadCount + 1; i++) {
+        workQueues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+uint32_t JobSystem::getCurrentWorkerIndex() const {
+    if (currentJobSystem == this) return currentWorkerIndex;
+    return static_cast<uint32_t>(threads.size());
+}
+
+JobSystem::JobHandle JobSystem::schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies, const char* name) {
+    return createJob(std::move(function), dependencies, name, false);
+}
+
+JobSystem::JobHandle JobSystem::scheduleOnMainThread(
+    std::function<void()> function, const std::vector<JobHandle>& dependencies, const char* name) {
+    return createJob(std::move(function), dependencies, name, true);
+}
+
+JobSystem::JobHandle JobSystem::createJob(
+    std::function<void()> function, const std::vector<JobHandle>& dependencies, const char* name, bool mainThreadOnly) {
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->name = name;
+    job->mainThreadOnly = mainThreadOnly;
+
+    for (const auto& dependency : dependencies) {
+        if (dependency.job == nullptr) continue;
+        std::lock_guard<std::mutex> lock(dependency.job->continuationMutex);
+        if (dependency.job->done) continue;
+        job->pendingDependencies++;
+        dependency.job->continuations.push_back(job);
+    }
+    if (--job->pendingDependencies == 0) enqueue(job);
+    return JobHandle{job};
+}
+
+void JobSystem::enqueue(std::shared_ptr<Job> job) {
+    if (job->mainThreadOnly) {
+        mainThreadJobCount++;
+        {
+            std::lock_guard<std::mutex> lock(mainThreadQueue.mutex);
+            mainThreadQueue.jobs.push_back(std::move(job));
+        }
+        //Only the main thread can take it, so everyone has to be woken to be sure it is
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wakeCondition.notify_all();
+        return;
+    }
+
+    //Counted before it's visible so that the count can never drop below zero
+    queuedJobCount++;
+    {
+        WorkQueue& queue = *workQueues[getCurrentWorkerIndex()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeCondition.notify_one();
+}
+
+//Own queue first (newest job, which is likely still in cache), then main thread jobs, then the oldest job of another worker
+std::shared_ptr<JobSystem::Job> JobSystem::findJob(uint32_t workerIndex) {
+    auto pop = [](WorkQueue& queue, bool back) -> std::shared_ptr<Job> {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return nullptr;
+        std::shared_ptr<Job> job;
+        if (back) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        return job;
+    };
+
+    if (auto job = pop(*workQueues[workerIndex], true)) {
+        queuedJobCount--;
+        return job;
+    }
+    if (mainThreadJobCount > 0 && isMainThread()) {
+        if (auto job = pop(mainThreadQueue, false)) {
+            mainThreadJobCount--;
+            return job;
+        }
+    }
+    const uint32_t queueCount = static_cast<uint32_t>(workQueues.size());
+    for (uint32_t offset = 1; offset < queueCount; offset++) {
+        if (auto job = pop(*workQueues[(workerIndex + offset) % queueCount], false)) {
+            queuedJobCount--;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(const std::shared_ptr<Job>& job, uint32_t workerIndex) {
+    if (profilingHooks.jobBegin) profilingHooks.jobBegin(job->name, workerIndex);
+    auto startTime = std::chrono::steady_clock::now();
+    job->function();
+    if (profilingHooks.jobEnd) profilingHooks.jobEnd(job->name, workerIndex, std::chrono::steady_clock::now() - startTime);
+    job->function = nullptr;
+
+    std::vector<std::shared_ptr<Job>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->continuationMutex);
+        job->done.store(true, std::memory_order_release);
+        continuations.swap(job->continuations);
+    }
+    //Pairs with the fence in wait, either this sees the waiter or the waiter sees the job done before it sleeps
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waitingThreadCount.load(std::memory_order_relaxed) > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wakeCondition.notify_all();
+    }
+    for (auto& continuation : continuations) {
+        if (--continuation->pendingDependencies == 0) enqueue(std::move(continuation));
+    }
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex) {
+    currentJobSystem = this;
+    currentWorkerIndex = workerIndex;
+    while (true) {
+        if (auto job = findJob(workerIndex)) {
+            execute(job, workerIndex);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeCondition.wait(lock, [&] { return stopping || queuedJobCount > 0; });
+        if (stopping) return;
+    }
+}
+
+void JobSystem::wait(const JobHandle& handle) {
+    if (handle.job == nullptr) return;
+    const uint32_t workerIndex = getCurrentWorkerIndex();
+    const bool mainThread = isMainThread();
+    while (!handle.isDone()) {
+        if (auto job = findJob(workerIndex)) {
+            execute(job, workerIndex);
+            continue;
+        }
+        waitingThreadCount++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeCondition.wait(lock, [&] {
+                return handle.isDone() || queuedJobCount > 0 || (mainThread && mainThreadJobCount > 0);
+            });
+        }
+        waitingThreadCount--;
+    }
+}
+
+void JobSystem::runMainThreadJobs() {
+    assert(isMainThread() && "Main thread jobs can only be run from the main thread!");
+    const uint32_t workerIndex = getCurrentWorkerIndex();
+    while (mainThreadJobCount > 0) {
+        std::shared_ptr<Job> job;
+        {
+            std::lock_guard<std::mutex> lock(mainThreadQueue.mutex);
+            if (mainThreadQueue.jobs.empty()) return;
+            job = std::move(mainThreadQueue.jobs.front());
+            mainThreadQueue.jobs.pop_front();
+        }
+        mainThreadJobCount--;
+        execute(job, workerIndex);
+    }
+}
+
+void JobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& function, uint32_t grainSize, const char* name) {
+    if (count == 0) return;
+    const uint32_t jobCount = (count + grainSize - 1) / grainSize;
+    if (jobCount == 1 || threads.empty()) {
+        const uint32_t workerIndex = getCurrentWorkerIndex();
+        for (uint32_t index = 0; index < count; index++) function(index, workerIndex);
+        return;
+    }
+
+    std::vector<JobHandle> handles;
+    handles.reserve(jobCount);
+    for (uint32_t begin = 0; begin < count; begin += grainSize) {
+        const uint32_t end = std::min(count, begin + grainSize);
+        handles.push_back(schedule([this, &function, begin, end] {
+            const uint32_t workerIndex = getCurrentWorkerIndex();
+            for (uint32_t index = begin; index < end; index++) function(index, workerIndex);
+        }, {}, name));
+    }
+    for (const auto& handle : handles) wait(handle);
+}
+}
\ No newline at end of file
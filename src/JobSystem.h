@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rkrai {
+//Work stealing task scheduler. Every worker owns a deque it pushes to and pops from at the back,
+//idle workers steal from the front of the others. Jobs can depend on other jobs, in which case they
+//are only queued once all of their dependencies have finished. Jobs that touch glfw (or anything else
+//bound to the main thread) can be scheduled with main thread affinity, and only ever run from
+//runMainThreadJobs or while the main thread waits.
+class JobSystem {
+    struct Job;
+
+    public:
+    class JobHandle {
+        public:
+        JobHandle() = default;
+        bool isValid() const { return job != nullptr; }
+        bool isDone() const;
+
+        private:
+        JobHandle(std::shared_ptr<Job> job) : job(std::move(job)) {}
+        std::shared_ptr<Job> job;
+
+        friend class JobSystem;
+    };
+
+    //Called on the thread that runs the job, right before and after it runs
+    struct ProfilingHooks {
+        std::function<void(const char* jobName, uint32_t workerIndex)> jobBegin;
+        std::function<void(const char* jobName, uint32_t workerIndex, std::chrono::nanoseconds duration)> jobEnd;
+    };
+
+    //Must be constructed on the main thread
+    JobSystem(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    void operator=(const JobSystem&) = delete;
+
+    JobHandle schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies = {}, const char* name = "Job");
+    JobHandle scheduleOnMainThread(std::function<void()> function, const std::vector<JobHandle>& dependencies = {}, const char* name = "Job");
+    //Runs other jobs while waiting, so it's safe to wait from inside a job
+    void wait(const JobHandle& handle);
+    //Only callable from the main thread, runs every main thread job that is ready
+    void runMainThreadJobs();
+
+    //Runs function(index, workerIndex) for every index in [0, count) in jobs of grainSize indices and waits for all of them
+    void parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& function, uint32_t grainSize = 1, const char* name = "ParallelFor");
+
+    //Number of distinct worker indices, the main thread always gets the last one
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(threads.size()) + 1; }
+    uint32_t getCurrentWorkerIndex() const;
+    bool isMainThread() const { return std::this_thread::get_id() == mainThreadId; }
+    void setProfilingHooks(ProfilingHooks hooks) { profilingHooks = std::move(hooks); }
+
+    private:
+    struct Job {
+        std::function<void()> function;
+        const char* name;
+        bool mainThreadOnly;
+        //Starts at one so that the job can't be queued while its dependencies are still being registered
+        std::atomic<uint32_t> pendingDependencies{1};
+        std::atomic<bool> done{false};
+        std::mutex continuationMutex;
+        std::vector<std::shared_ptr<Job>> continuations;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Job>> jobs;
+    };
+
+    JobHandle createJob(std::function<void()> function, const std::vector<JobHandle>& dependencies, const char* name, bool mainThreadOnly);
+    void enqueue(std::shared_ptr<Job> job);
+    std::shared_ptr<Job> findJob(uint32_t workerIndex);
+    void execute(const std::shared_ptr<Job>& job, uint32_t workerIndex);
+    void workerLoop(uint32_t workerIndex);
+
+    std::thread::id mainThreadId;
+    std::vector<std::thread> threads;
+    //One queue per worker plus one for the main thread (and any thread outside the system)
+    std::vector<std::unique_ptr<WorkQueue>> workQueues;
+    WorkQueue mainThreadQueue;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<uint32_t> queuedJobCount{0};
+    std::atomic<uint32_t> mainThreadJobCount{0};
+    std::atomic<uint32_t> waitingThreadCount{0};
+    bool stopping = false;
+
+    ProfilingHooks profilingHooks;
+};
+}
\ No newline at end of file
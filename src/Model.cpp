@@ -42,6 +42,11 @@ void Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
     assert(vertexCount >= 3 && "Number of vertices must be greater than or equal to 3!");
     VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
 
+    boundingBox = AABB{};
+    for (const auto& vertex : vertices) {
+        boundingBox.expand(vertex.position);
+    }
+
     GraphicsBuffer stagingBuffer(
         graphicsDevice,
         bufferSize,
@@ -101,6 +106,14 @@ void Model::draw(vk::CommandBuffer commandBuffer) {
     }
 }
 
+void Model::drawIndirect(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::DeviceSize offset) {
+    if (hasIndexBuffer) {
+        commandBuffer.drawIndexedIndirect(buffer, offset, 1, sizeof(vk::DrawIndexedIndirectCommand));
+    } else {
+        commandBuffer.drawIndirect(buffer, offset, 1, sizeof(vk::DrawIndirectCommand));
+    }
+}
+
 std::vector<vk::VertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
     return {{0, sizeof(Vertex), vk::VertexInputRate::eVertex}};
 }
@@ -114,6 +127,10 @@ std::vector<vk::VertexInputAttributeDescription> Model::Vertex::getAttributeDesc
     };
 }
 
+std::vector<vk::VertexInputAttributeDescription> Model::Vertex::getPositionAttributeDescriptions() {
+    return {{0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position)}};
+}
+
 void Model::Data::loadModel(const std::string& filepath) {
     tinyobj::ObjReader reader;
     if (!reader.ParseFromFile(filepath)) {
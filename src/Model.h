@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Bounds.h"
 #include "GraphicsDevice.h"
 #include "GraphicsBuffer.h"
 
@@ -23,6 +24,8 @@ class Model {
 
         static std::vector<vk::VertexInputBindingDescription> getBindingDescriptions();
         static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
+        //Just the position, for depth only pipelines that share the vertex buffers
+        static std::vector<vk::VertexInputAttributeDescription> getPositionAttributeDescriptions();
 
         bool operator==(const Vertex& other) const {
             return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
@@ -42,6 +45,11 @@ class Model {
 
     void bind(vk::CommandBuffer commandBuffer);
     void draw(vk::CommandBuffer commandBuffer);
+    //The command at offset must use the VkDrawIndexedIndirectCommand layout if the model is indexed
+    void drawIndirect(vk::CommandBuffer commandBuffer, vk::Buffer buffer, vk::DeviceSize offset);
+
+    const AABB& getBoundingBox() const { return boundingBox; }
+    uint32_t getElementCount() const { return hasIndexBuffer ? indexCount : vertexCount; }
 
     private:
     GraphicsDevice& graphicsDevice;
@@ -53,6 +61,8 @@ class Model {
     std::optional<GraphicsBuffer> indexBuffer;
     uint32_t indexCount;
 
+    AABB boundingBox{};
+
     void createVertexBuffers(const std::vector<Vertex>& vertices);
     void createIndexBuffer(const std::vector<uint32_t>& indices);
 };
@@ -1,36 +1,42 @@
 #include "MovementController.h"
 
+#include <glm/gtc/constants.hpp>
+
 namespace rkrai {
-void MovementController::moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject) {
-    glm::vec3 rotate{0.0f};
-    if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.0f;
-    if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) rotate.y -= 1.0f;
-    if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.0f;
-    if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.0f;
+MovementController::Input MovementController::readInput(GLFWwindow* window) const {
+    Input input{};
+    if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) input.look.y += 1.0f;
+    if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) input.look.y -= 1.0f;
+    if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) input.look.x += 1.0f;
+    if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) input.look.x -= 1.0f;
+
+    if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) input.move.z += 1.0f;
+    if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) input.move.z -= 1.0f;
+    if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) input.move.x += 1.0f;
+    if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) input.move.x -= 1.0f;
+    if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) input.move.y += 1.0f;
+    if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) input.move.y -= 1.0f;
+    return input;
+}
 
+void MovementController::moveInPlaneXZ(const Input& input, float dt, TransformComponent& transform) const {
+    const glm::vec3 rotate = input.look;
     if (rotate.x != 0.0f || rotate.y != 0.0f || rotate.z != 0.0f) {
-        gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+        transform.rotation += lookSpeed * dt * glm::normalize(rotate);
     }
 
     //limit pitch between +/- 85 degrees
-    gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-    gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+    transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+    transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>());
 
-    float yaw = gameObject.transform.rotation.y;
+    float yaw = transform.rotation.y;
     const glm::vec3 forwardDir{sin(yaw), 0.0f, cos(yaw)};
     const glm::vec3 rightDir{forwardDir.z, 0.0f, -forwardDir.x};
     const glm::vec3 upDir{0.0f, -1.0f, 0.0f};
 
-    glm::vec3 moveDir{0.0f};
-    if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) moveDir += forwardDir;
-    if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= forwardDir;
-    if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) moveDir += rightDir;
-    if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) moveDir -= rightDir;
-    if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) moveDir += upDir;
-    if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
-    
+    const glm::vec3 moveDir = input.move.x * rightDir + input.move.y * upDir + input.move.z * forwardDir;
     if (moveDir.x != 0.0f || moveDir.y != 0.0f || moveDir.z != 0.0f) {
-        gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+        transform.translation += moveSpeed * dt * glm::normalize(moveDir);
     }
 }
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "GameObject.h"
+#include "TransformComponent.h"
 #include "Window.h"
 
 namespace rkrai {
@@ -19,7 +19,16 @@ class MovementController {
         int lookDown = GLFW_KEY_DOWN;
     };
 
-    void moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject);
+    //Which way the keys point, each axis in [-1, 1]. Glfw can only be queried on the main thread, so a simulation
+    //running elsewhere is handed input read there.
+    struct Input {
+        glm::vec3 look{0.0f}; //x is pitch, y is yaw
+        glm::vec3 move{0.0f}; //x is right, y is up, z is forward
+    };
+
+    Input readInput(GLFWwindow* window) const;
+    void moveInPlaneXZ(const Input& input, float dt, TransformComponent& transform) const;
+    void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform) const { moveInPlaneXZ(readInput(window), dt, transform); }
 
     KeyMappings keys{};
     float moveSpeed = 3.0f;
@@ -0,0 +1,334 @@
+#include "OcclusionCuller.h"
+#include "SwapChain.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace rkrai {
+struct CullObject {
+    glm::vec4 boundsMin{0.0f};
+    glm::vec4 boundsMax{0.0f};
+    uint32_t objectIndex = 0;
+    uint32_t padding[3]{};
+};
+
+struct CullPushConstantData {
+    glm::mat4 projView{1.0f};
+    glm::vec2 pyramidSize{0.0f};
+    uint32_t objectCount = 0;
+    uint32_t phase = 0;
+    uint32_t mipCount = 0;
+};
+
+struct ReducePushConstantData {
+    glm::ivec2 srcSize{0};
+    glm::ivec2 dstSize{0};
+};
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+static constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+static constexpr uint32_t INITIAL_CAPACITY = 256;
+
+OcclusionCuller::OcclusionCuller(GraphicsDevice& device)
+    : graphicsDevice(device),
+    objectBuffers(device, sizeof(CullObject), vk::BufferUsageFlagBits::eStorageBuffer),
+    earlyDrawBuffers(device, sizeof(DrawCommand), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer),
+    lateDrawBuffers(device, sizeof(DrawCommand), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer) {
+    pyramidBindersOutdated.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, true);
+    createSampler();
+    createResourceBinders();
+    createPipelineLayouts();
+    createPipelines();
+    ensureCapacity(INITIAL_CAPACITY);
+}
+
+void OcclusionCuller::createSampler() {
+    pyramidSampler = graphicsDevice.getDevice().createSamplerUnique(vk::SamplerCreateInfo{
+        {}, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest,
+        vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+        0.0f, VK_FALSE, 1.0f, VK_FALSE, vk::CompareOp::eAlways, 0.0f, VK_LOD_CLAMP_NONE, vk::BorderColor::eFloatOpaqueWhite, VK_FALSE
+    });
+}
+
+void OcclusionCuller::createResourceBinders() {
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        cullBinders.emplace_back(
+            graphicsDevice,
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eStorageBuffer, 1},
+                {1, vk::DescriptorType::eStorageBuffer, 1},
+                {2, vk::DescriptorType::eStorageBuffer, 1},
+                {3, vk::DescriptorType::eStorageBuffer, 1},
+                {4, vk::DescriptorType::eCombinedImageSampler, 1},
+                {5, vk::DescriptorType::eStorageBuffer, 1}
+            }
+        );
+        depthReduceBinders.emplace_back(
+            graphicsDevice,
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eCombinedImageSampler, 1},
+                {1, vk::DescriptorType::eStorageImage, 1}
+            }
+        );
+    }
+}
+
+void OcclusionCuller::createPipelineLayouts() {
+    vk::PushConstantRange cullPushConstantRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullPushConstantData)};
+    vk::DescriptorSetLayout cullSetLayout = cullBinders[0].getSetLayout();
+    cullPipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, cullSetLayout, cullPushConstantRange});
+
+    vk::PushConstantRange reducePushConstantRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(ReducePushConstantData)};
+    vk::DescriptorSetLayout reduceSetLayout = depthReduceBinders[0].getSetLayout();
+    reducePipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, reduceSetLayout, reducePushConstantRange});
+}
+
+void OcclusionCuller::createPipelines() {
+    cullPipeline.emplace(graphicsDevice, "shaders/OcclusionCull.comp.spv", *cullPipelineLayout);
+    reducePipeline.emplace(graphicsDevice, "shaders/DepthPyramid.comp.spv", *reducePipelineLayout);
+}
+
+//The per frame buffers all grow together, the visibility buffer is shared by every frame and replaced along with them
+void OcclusionCuller::ensureCapacity(uint32_t requiredCapacity) {
+    if (!objectBuffers.ensureCapacity(requiredCapacity)) return;
+    earlyDrawBuffers.ensureCapacity(requiredCapacity);
+    lateDrawBuffers.ensureCapacity(requiredCapacity);
+
+    while (statsBuffers.size() < SwapChain::MAX_FRAMES_IN_FLIGHT) {
+        statsBuffers.emplace_back(
+            graphicsDevice,
+            sizeof(uint32_t),
+            vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+        uint32_t zero = 0;
+        statsBuffers.back().writeData(&zero, sizeof(uint32_t));
+    }
+
+    //Filled by the next frame that culls, everything starts out as visible so that it draws everything in the early phase
+    if (visibilityBuffer) graphicsDevice.retire(std::move(*visibilityBuffer));
+    visibilityBuffer.reset();
+    visibilityBuffer.emplace(
+        graphicsDevice,
+        objectBuffers.getCapacity() * sizeof(uint32_t),
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+    visibilityBufferFilled = false;
+}
+
+//Only called once the frame's fence has signaled, so the set can be rewritten in place
+void OcclusionCuller::updateCullBinder(int currentFrameIndex) {
+    ResourceBinder& cullBinder = cullBinders[currentFrameIndex];
+    cullBinder.setBuffer(0, &objectBuffers[currentFrameIndex]);
+    cullBinder.setBuffer(1, &earlyDrawBuffers[currentFrameIndex]);
+    cullBinder.setBuffer(2, &lateDrawBuffers[currentFrameIndex]);
+    cullBinder.setBuffer(3, &*visibilityBuffer);
+    cullBinder.setBuffer(5, &statsBuffers[currentFrameIndex]);
+    if (depthPyramidView) {
+        cullBinder.setImage(4, depthPyramidView->getImageView(), *pyramidSampler, vk::ImageLayout::eGeneral);
+    }
+    objectBuffers.setUpToDate(currentFrameIndex);
+    earlyDrawBuffers.setUpToDate(currentFrameIndex);
+    lateDrawBuffers.setUpToDate(currentFrameIndex);
+    pyramidBindersOutdated[currentFrameIndex] = false;
+}
+
+void OcclusionCuller::resize(vk::Extent2D depthExtent) {
+    if (depthExtent == pyramidExtent) return;
+    createDepthPyramid(depthExtent);
+    pyramidBindersOutdated.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, true);
+}
+
+//Level 0 of the pyramid matches the depth attachment, every level after that halves it,
+//each texel storing the farthest depth of the texels it covers.
+void OcclusionCuller::createDepthPyramid(vk::Extent2D depthExtent) {
+    pyramidExtent = depthExtent;
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(depthExtent.width, depthExtent.height)))) + 1;
+
+    //Frames in flight may still be building or sampling the old pyramid
+    if (depthPyramid) {
+        graphicsDevice.retire(std::move(pyramidReduceBinders));
+        graphicsDevice.retire(std::move(depthPyramidMipViews));
+        graphicsDevice.retire(std::move(*depthPyramidView));
+        graphicsDevice.retire(std::move(*depthPyramid));
+    }
+    pyramidReduceBinders.clear();
+    depthPyramidMipViews.clear();
+    depthPyramidView.reset();
+    depthPyramid.reset();
+
+    depthPyramid.emplace(
+        graphicsDevice,
+        vk::ImageType::e2D,
+        vk::Extent3D{depthExtent.width, depthExtent.height, 1},
+        vk::Format::eR32Sfloat,
+        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+        mipLevels
+    );
+    pyramidLayoutInitialized = false;
+    depthPyramidView.emplace(*depthPyramid, vk::ImageAspectFlagBits::eColor);
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        depthPyramidMipViews.emplace_back(*depthPyramid, vk::ImageAspectFlagBits::eColor, level, 1);
+    }
+
+    for (uint32_t level = 1; level < mipLevels; level++) {
+        pyramidReduceBinders.emplace_back(
+            graphicsDevice,
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eCombinedImageSampler, 1},
+                {1, vk::DescriptorType::eStorageImage, 1}
+            }
+        );
+        pyramidReduceBinders.back().setImage(
+            0, depthPyramidMipViews[level - 1].getImageView(), *pyramidSampler, vk::ImageLayout::eGeneral
+        );
+        pyramidReduceBinders.back().setImage(1, depthPyramidMipViews[level].getImageView(), {}, vk::ImageLayout::eGeneral);
+    }
+}
+
+void OcclusionCuller::beginFrame(int currentFrameIndex, const std::vector<Object>& objects, uint32_t totalObjectCount) {
+    //This frame's fence has already been waited on, so the stats from the last use of this slot are complete
+    statsBuffers[currentFrameIndex].readData(&rejectedObjectCount, sizeof(uint32_t));
+    uint32_t zero = 0;
+    statsBuffers[currentFrameIndex].writeData(&zero, sizeof(uint32_t));
+
+    ensureCapacity(std::max(static_cast<uint32_t>(objects.size()), totalObjectCount));
+    //The draw buffers are always replaced along with the object buffers
+    if (objectBuffers.isOutdated(currentFrameIndex) || pyramidBindersOutdated[currentFrameIndex]) updateCullBinder(currentFrameIndex);
+
+    std::vector<CullObject> cullObjects;
+    std::vector<DrawCommand> drawCommands;
+    cullObjects.reserve(objects.size());
+    drawCommands.reserve(objects.size());
+    for (const auto& object : objects) {
+        cullObjects.push_back({
+            .boundsMin = glm::vec4{object.bounds.min, 0.0f},
+            .boundsMax = glm::vec4{object.bounds.max, 0.0f},
+            .objectIndex = object.objectIndex
+        });
+        drawCommands.push_back({object.elementCount, 1, 0, 0, 0});
+    }
+
+    objectCount = static_cast<uint32_t>(objects.size());
+    if (objectCount == 0) return;
+    objectBuffers[currentFrameIndex].writeData(cullObjects.data(), cullObjects.size() * sizeof(CullObject));
+    earlyDrawBuffers[currentFrameIndex].writeData(drawCommands.data(), drawCommands.size() * sizeof(DrawCommand));
+    lateDrawBuffers[currentFrameIndex].writeData(drawCommands.data(), drawCommands.size() * sizeof(DrawCommand));
+}
+
+void OcclusionCuller::cullEarly(vk::CommandBuffer commandBuffer, int currentFrameIndex, const glm::mat4& projView) {
+    assert(depthPyramid && "OcclusionCuller::resize must be called before culling!");
+    this->projView = projView;
+    //Its contents are undefined until the first pyramid is built, just like a stale pyramid they only cost the early
+    //phase some objects that the late phase then draws
+    if (!pyramidLayoutInitialized) {
+        vk::ImageMemoryBarrier barrier{
+            {}, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+            depthPyramid->getImage(), {vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, 1}
+        };
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barrier
+        );
+        pyramidLayoutInitialized = true;
+    }
+    if (!visibilityBufferFilled) {
+        commandBuffer.fillBuffer(visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 1);
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+            vk::MemoryBarrier{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite},
+            {}, {}
+        );
+        visibilityBufferFilled = true;
+    }
+    if (objectCount == 0) return;
+
+    //Visibility was last written by the previous frame's late phase
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite},
+        {}, {}
+    );
+    dispatchCull(commandBuffer, currentFrameIndex, Phase::eEarly);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead},
+        {}, {}
+    );
+}
+
+void OcclusionCuller::buildDepthPyramid(
+    vk::CommandBuffer commandBuffer, int currentFrameIndex, vk::ImageView depthImageView, vk::Extent2D renderExtent) {
+    assert(renderExtent.width <= pyramidExtent.width && renderExtent.height <= pyramidExtent.height && "Render extent exceeds the depth attachment!");
+    //The depth attachment and the pyramid can both have been recreated since this frame's set was last used
+    depthReduceBinders[currentFrameIndex].setImage(
+        0, depthImageView, *pyramidSampler, vk::ImageLayout::eDepthStencilReadOnlyOptimal
+    );
+    depthReduceBinders[currentFrameIndex].setImage(1, depthPyramidMipViews[0].getImageView(), {}, vk::ImageLayout::eGeneral);
+
+    //The previous frame's late phase may still be reading the pyramid
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderWrite},
+        {}, {}
+    );
+    reducePipeline->bind(commandBuffer);
+
+    //The first reduction samples every depth texel a pyramid texel overlaps, however the two sizes relate
+    glm::ivec2 srcSize{renderExtent.width, renderExtent.height};
+    for (uint32_t level = 0; level < depthPyramid->getMipLevels(); level++) {
+        glm::ivec2 dstSize = glm::max(glm::ivec2{pyramidExtent.width >> level, pyramidExtent.height >> level}, glm::ivec2{1});
+        ResourceBinder& binder = level == 0 ? depthReduceBinders[currentFrameIndex] : pyramidReduceBinders[level - 1];
+        binder.bind(commandBuffer, *reducePipelineLayout, 0, vk::PipelineBindPoint::eCompute);
+
+        ReducePushConstantData push{srcSize, dstSize};
+        commandBuffer.pushConstants(
+            *reducePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ReducePushConstantData), &push
+        );
+        commandBuffer.dispatch(
+            (dstSize.x + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, (dstSize.y + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1
+        );
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+            vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead},
+            {}, {}
+        );
+        srcSize = dstSize;
+    }
+}
+
+void OcclusionCuller::cullLate(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (objectCount == 0) return;
+
+    dispatchCull(commandBuffer, currentFrameIndex, Phase::eLate);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eHost, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eHostRead},
+        {}, {}
+    );
+}
+
+void OcclusionCuller::dispatchCull(vk::CommandBuffer commandBuffer, int currentFrameIndex, Phase phase) {
+    cullPipeline->bind(commandBuffer);
+    cullBinders[currentFrameIndex].bind(commandBuffer, *cullPipelineLayout, 0, vk::PipelineBindPoint::eCompute);
+
+    CullPushConstantData push{
+        .projView = projView,
+        .pyramidSize = glm::vec2{pyramidExtent.width, pyramidExtent.height},
+        .objectCount = objectCount,
+        .phase = phase == Phase::eEarly ? 0u : 1u,
+        .mipCount = depthPyramid->getMipLevels()
+    };
+    commandBuffer.pushConstants(*cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullPushConstantData), &push);
+    commandBuffer.dispatch((objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+vk::Buffer OcclusionCuller::getDrawCommandBuffer(int currentFrameIndex, Phase phase) {
+    if (phase == Phase::eEarly) return earlyDrawBuffers[currentFrameIndex].getBuffer();
+    return lateDrawBuffers[currentFrameIndex].getBuffer();
+}
+}
\ No newline at end of file
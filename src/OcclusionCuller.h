@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Bounds.h"
+#include "ComputePipeline.h"
+#include "GraphicsBuffer.h"
+#include "GraphicsDevice.h"
+#include "Image.h"
+#include "ImageView.h"
+#include "PerFrameBuffers.h"
+#include "ResourceBinder.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rkrai {
+//Two phase hierarchical-z occlusion culling. Objects that were visible last frame are drawn first,
+//a depth pyramid is built from the resulting depth, and every object is then tested against it so
+//that the ones the first phase missed can be drawn. Results are written straight into indirect draw
+//commands, so nothing ever has to be read back before drawing.
+class OcclusionCuller {
+    public:
+    //Layout shared by VkDrawIndirectCommand and VkDrawIndexedIndirectCommand, instanceCount is what gets culled
+    struct DrawCommand {
+        uint32_t count; //Index count for indexed models, vertex count otherwise
+        uint32_t instanceCount;
+        uint32_t first;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+
+    struct Object {
+        AABB bounds;
+        uint32_t objectIndex; //Must stay the same across frames, it's what visibility is tracked by
+        uint32_t elementCount;
+    };
+
+    enum class Phase { eEarly, eLate };
+
+    OcclusionCuller(GraphicsDevice& device);
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    void operator=(const OcclusionCuller&) = delete;
+
+    //Recreates the depth pyramid, must be called whenever the depth attachment changes size. The old one is retired
+    //until the frames still using it have finished.
+    void resize(vk::Extent2D depthExtent);
+
+    //Uploads this frame's (frustum visible) objects, draw index i of either phase corresponds to objects[i]
+    void beginFrame(int currentFrameIndex, const std::vector<Object>& objects, uint32_t totalObjectCount);
+    void cullEarly(vk::CommandBuffer commandBuffer, int currentFrameIndex, const glm::mat4& projView);
+    //Expects the depth attachment to be in eDepthStencilReadOnlyOptimal layout. Only renderExtent, from the top left
+    //corner, was drawn this frame, which is stretched over the whole pyramid when rendering at a reduced resolution.
+    void buildDepthPyramid(vk::CommandBuffer commandBuffer, int currentFrameIndex, vk::ImageView depthImageView, vk::Extent2D renderExtent);
+    void cullLate(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+
+    vk::Buffer getDrawCommandBuffer(int currentFrameIndex, Phase phase);
+    static vk::DeviceSize getDrawCommandOffset(uint32_t drawIndex) { return drawIndex * sizeof(DrawCommand); }
+    //Number of objects that were neither drawn in the early or late phase, reported a few frames late
+    uint32_t getRejectedObjectCount() const { return rejectedObjectCount; }
+
+    private:
+    void createSampler();
+    void createResourceBinders();
+    void createPipelineLayouts();
+    void createPipelines();
+    void ensureCapacity(uint32_t objectCount);
+    void createDepthPyramid(vk::Extent2D depthExtent);
+    void updateCullBinder(int currentFrameIndex);
+    void dispatchCull(vk::CommandBuffer commandBuffer, int currentFrameIndex, Phase phase);
+
+    GraphicsDevice& graphicsDevice;
+
+    uint32_t objectCount = 0;
+    uint32_t rejectedObjectCount = 0;
+    glm::mat4 projView{1.0f};
+
+    PerFrameBuffers objectBuffers;
+    PerFrameBuffers earlyDrawBuffers;
+    PerFrameBuffers lateDrawBuffers;
+    std::vector<GraphicsBuffer> statsBuffers;
+    std::optional<GraphicsBuffer> visibilityBuffer;
+    bool visibilityBufferFilled = false;
+
+    vk::Extent2D pyramidExtent{0, 0};
+    std::optional<Image> depthPyramid;
+    std::optional<ImageView> depthPyramidView;
+    std::vector<ImageView> depthPyramidMipViews;
+    vk::UniqueSampler pyramidSampler;
+    //A new pyramid is moved out of its undefined layout by the first frame that culls with it
+    bool pyramidLayoutInitialized = false;
+
+    std::vector<ResourceBinder> cullBinders;
+    //Per frame sets still pointing at a pyramid that has since been replaced, the buffers keep their own flags
+    std::vector<bool> pyramidBindersOutdated;
+    std::vector<ResourceBinder> depthReduceBinders;
+    std::vector<ResourceBinder> pyramidReduceBinders;
+
+    vk::UniquePipelineLayout cullPipelineLayout;
+    vk::UniquePipelineLayout reducePipelineLayout;
+    std::optional<ComputePipeline> cullPipeline;
+    std::optional<ComputePipeline> reducePipeline;
+};
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "OffscreenTarget.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <cassert>
+
+namespace rkrai {
+OffscreenTarget::OffscreenTarget(GraphicsDevice& graphicsDevice, vk::Extent2D extent)
+    : graphicsDevice(graphicsDevice), extent(extent) {
+    assert(extent.width > 0 && extent.height > 0 && "Offscreen target needs a size");
+    depthFormat = graphicsDevice.findSupportedFormat(
+        {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint},
+        vk::ImageTiling::eOptimal,
+        vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage
+    );
+    createImages();
+    createReadbackBuffers();
+}
+
+//Views keep a reference to their image
+void OffscreenTarget::createImages() {
+    images.reserve(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    imageViews.reserve(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        images.emplace_back(
+            graphicsDevice,
+            vk::ImageType::e2D,
+            vk::Extent3D{extent.width, extent.height, 1},
+            IMAGE_FORMAT,
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst
+        );
+        imageViews.emplace_back(images.back(), vk::ImageAspectFlagBits::eColor);
+    }
+}
+
+void OffscreenTarget::createReadbackBuffers() {
+    //Every format the target can have is 4 bytes per pixel
+    const vk::DeviceSize size = vk::DeviceSize{extent.width} * extent.height * 4;
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        readbackBuffers.emplace_back(
+            graphicsDevice, size, vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+        readbackData.push_back(readbackBuffers.back().map());
+    }
+}
+
+void OffscreenTarget::recordReadback(vk::CommandBuffer commandBuffer, int frameIndex) {
+    vk::BufferImageCopy region{
+        0, 0, 0,
+        vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+        vk::Offset3D{0, 0, 0},
+        vk::Extent3D{extent.width, extent.height, 1}
+    };
+    commandBuffer.copyImageToBuffer(
+        images[frameIndex].getImage(), vk::ImageLayout::eTransferSrcOptimal, readbackBuffers[frameIndex].getBuffer(), region
+    );
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead},
+        {}, {}
+    );
+}
+
+std::vector<vk::Image> OffscreenTarget::getImages() {
+    std::vector<vk::Image> result;
+    for (Image& image : images) {
+        result.push_back(image.getImage());
+    }
+    return result;
+}
+
+std::vector<vk::ImageView> OffscreenTarget::getImageViews() {
+    std::vector<vk::ImageView> result;
+    for (ImageView& imageView : imageViews) {
+        result.push_back(imageView.getImageView());
+    }
+    return result;
+}
+}
\ No newline at end of file
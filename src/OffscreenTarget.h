@@ -0,0 +1,61 @@
+#pragma once
+
+#include "GraphicsBuffer.h"
+#include "GraphicsDevice.h"
+#include "Image.h"
+#include "ImageView.h"
+#include "SwapChain.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rkrai {
+//Pixels of a finished headless frame, rows tightly packed in the target's format. Only valid while it's being handed over.
+struct FrameReadback {
+    //As returned by GraphicsDevice::getFrameNumber while the frame was recorded
+    uint64_t frameNumber;
+    vk::Extent2D extent;
+    vk::Format format;
+    const void* pixels;
+};
+
+//Stands in for the swap chain when rendering without a window. Every frame in flight draws into its own image, which
+//can be copied into host visible memory and read once the frame has finished.
+class OffscreenTarget {
+    public:
+    static constexpr vk::Format IMAGE_FORMAT = vk::Format::eR8G8B8A8Srgb;
+
+    OffscreenTarget(GraphicsDevice& graphicsDevice, vk::Extent2D extent);
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    void operator=(const OffscreenTarget&) = delete;
+
+    //Expects the frame's image in eTransferSrcOptimal layout, the copy is made visible to the host
+    void recordReadback(vk::CommandBuffer commandBuffer, int frameIndex);
+    //Only holds the frame's pixels once its fence has signaled
+    const void* getReadbackData(int frameIndex) const { return readbackData[frameIndex]; }
+
+    vk::Extent2D getExtent() const { return extent; }
+    float getAspectRatio() const { return static_cast<float>(extent.width) / static_cast<float>(extent.height); }
+    vk::Format getImageFormat() const { return IMAGE_FORMAT; }
+    vk::Format getDepthFormat() const { return depthFormat; }
+    //One per frame in flight, indexed by frame index
+    std::vector<vk::Image> getImages();
+    std::vector<vk::ImageView> getImageViews();
+
+    private:
+    GraphicsDevice& graphicsDevice;
+    vk::Extent2D extent;
+    vk::Format depthFormat;
+
+    std::vector<Image> images;
+    std::vector<ImageView> imageViews;
+    std::vector<GraphicsBuffer> readbackBuffers;
+    //Stay mapped for the target's lifetime
+    std::vector<const void*> readbackData;
+
+    void createImages();
+    void createReadbackBuffers();
+};
+}
\ No newline at end of file
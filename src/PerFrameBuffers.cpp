@@ -0,0 +1,23 @@
+#include "PerFrameBuffers.h"
+#include "SwapChain.h"
+
+#include <algorithm>
+
+namespace rkrai {
+PerFrameBuffers::PerFrameBuffers(
+    GraphicsDevice& graphicsDevice, vk::DeviceSize elementSize, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties)
+    : graphicsDevice(graphicsDevice), elementSize(elementSize), usage(usage), properties(properties) {}
+
+bool PerFrameBuffers::ensureCapacity(uint32_t requiredCapacity) {
+    if (requiredCapacity <= capacity) return false;
+    if (capacity > 0) graphicsDevice.retire(std::move(buffers));
+    capacity = std::max(requiredCapacity, capacity * 2);
+
+    buffers.clear();
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        buffers.emplace_back(graphicsDevice, capacity * elementSize, usage, properties);
+    }
+    outdated.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, true);
+    return true;
+}
+}
\ No newline at end of file
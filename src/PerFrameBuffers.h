@@ -0,0 +1,44 @@
+#pragma once
+
+#include "GraphicsBuffer.h"
+#include "GraphicsDevice.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rkrai {
+//One buffer per frame in flight for data the cpu rewrites every frame, each with room for the same number of elements.
+//Growing is rare, it only happens when there are more elements than ever before, and at least doubles the capacity.
+//The old buffers are retired, frames in flight keep using them through their own descriptor sets until those are
+//rewritten once their frame comes around again. The outdated flags tell which frames' sets still need that.
+class PerFrameBuffers {
+    public:
+    PerFrameBuffers(
+        GraphicsDevice& graphicsDevice, vk::DeviceSize elementSize, vk::BufferUsageFlags usage,
+        vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    PerFrameBuffers(const PerFrameBuffers&) = delete;
+    void operator=(const PerFrameBuffers&) = delete;
+
+    //Returns whether the buffers were replaced, the new ones start out with undefined contents
+    bool ensureCapacity(uint32_t requiredCapacity);
+    uint32_t getCapacity() const { return capacity; }
+    GraphicsBuffer& operator[](int frameIndex) { return buffers[frameIndex]; }
+
+    //Whether the frame's set still points at a buffer that has since been replaced. Only to be reset once the frame's
+    //fence has signaled and its set was pointed at the current buffer.
+    bool isOutdated(int frameIndex) const { return outdated[frameIndex]; }
+    void setUpToDate(int frameIndex) { outdated[frameIndex] = false; }
+
+    private:
+    GraphicsDevice& graphicsDevice;
+    vk::DeviceSize elementSize;
+    vk::BufferUsageFlags usage;
+    vk::MemoryPropertyFlags properties;
+
+    uint32_t capacity = 0;
+    std::vector<GraphicsBuffer> buffers;
+    std::vector<bool> outdated;
+};
+}
\ No newline at end of file
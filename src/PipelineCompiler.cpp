@@ -0,0 +1,81 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace rkrai {
+PipelineCompiler::PipelineCompiler(GraphicsDevice& device, std::shared_ptr<JobSystem> jobSystem)
+    : graphicsDevice(device), jobSystem(std::move(jobSystem)) {}
+
+PipelineHandle<GraphicsPipeline> PipelineCompiler::compile(
+    const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) {
+    //The config's copy constructor repoints its create infos at the copy's own arrays
+    return schedule<GraphicsPipeline>([this, vertFilepath, fragFilepath, configInfo](std::optional<GraphicsPipeline>& pipeline) {
+        pipeline.emplace(graphicsDevice, vertFilepath, fragFilepath, configInfo);
+    }, "CompileGraphicsPipeline");
+}
+
+PipelineHandle<ComputePipeline> PipelineCompiler::compile(const std::string& compFilepath, vk::PipelineLayout pipelineLayout) {
+    return schedule<ComputePipeline>([this, compFilepath, pipelineLayout](std::optional<ComputePipeline>& pipeline) {
+        pipeline.emplace(graphicsDevice, compFilepath, pipelineLayout);
+    }, "CompileComputePipeline");
+}
+
+//The device's pipeline cache is internally synchronized, so any number of these can run at once
+template <typename Pipeline, typename CreateFunction>
+PipelineHandle<Pipeline> PipelineCompiler::schedule(CreateFunction create, const char* name) {
+    PipelineHandle<Pipeline> handle;
+    handle.state = std::make_shared<typename PipelineHandle<Pipeline>::State>();
+    auto compile = [state = handle.state, create = std::move(create)] {
+        try {
+            create(state->pipeline);
+            state->ready.store(true, std::memory_order_release);
+        } catch (const std::exception& error) {
+            std::cerr << "Failed to compile pipeline: " << error.what() << '\n';
+            state->error = std::current_exception();
+        }
+    };
+    if (jobSystem == nullptr) {
+        compile();
+        return handle;
+    }
+
+    handle.state->job = jobSystem->schedule(std::move(compile), {}, name);
+    std::lock_guard lock{pendingMutex};
+    std::erase_if(pendingJobs, [](const JobSystem::JobHandle& job) { return job.isDone(); });
+    pendingJobs.push_back(handle.state->job);
+    return handle;
+}
+
+void PipelineCompiler::waitAll() {
+    std::vector<JobSystem::JobHandle> jobs;
+    {
+        std::lock_guard lock{pendingMutex};
+        jobs.swap(pendingJobs);
+    }
+    for (const auto& job : jobs) {
+        jobSystem->wait(job);
+    }
+}
+
+GraphicsPipelineVariants::GraphicsPipelineVariants(
+    PipelineCompiler& pipelineCompiler, std::string vertFilepath, std::string fragFilepath, const PipelineConfigInfo& baseConfig)
+    : pipelineCompiler(pipelineCompiler), vertFilepath(std::move(vertFilepath)), fragFilepath(std::move(fragFilepath)), baseConfig(baseConfig) {}
+
+const PipelineHandle<GraphicsPipeline>& GraphicsPipelineVariants::get(const ShaderVariantKey& key) {
+    auto [variant, inserted] = variants.try_emplace(key);
+    if (inserted) {
+        PipelineConfigInfo configInfo = baseConfig;
+        key.apply(configInfo);
+        variant->second = pipelineCompiler.compile(vertFilepath, fragFilepath, configInfo);
+    }
+    return variant->second;
+}
+
+void GraphicsPipelineVariants::request(const std::vector<ShaderVariantKey>& keys) {
+    for (const auto& key : keys) {
+        get(key);
+    }
+}
+}
\ No newline at end of file
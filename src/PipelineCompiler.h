@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ComputePipeline.h"
+#include "GraphicsDevice.h"
+#include "GraphicsPipeline.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rkrai {
+//Refers to a pipeline that is compiled in the background. It becomes ready once the compilation has finished,
+//draws that need a pipeline that isn't ready yet are expected to be skipped or fall back to another one.
+template <typename Pipeline>
+class PipelineHandle {
+    public:
+    PipelineHandle() = default;
+
+    //Never blocks, stays false if the compilation failed
+    bool isReady() const { return state != nullptr && state->ready.load(std::memory_order_acquire); }
+    Pipeline& operator*() const {
+        assert(isReady() && "The pipeline hasn't finished compiling");
+        return *state->pipeline;
+    }
+    Pipeline* operator->() const { return &**this; }
+
+    private:
+    struct State {
+        std::optional<Pipeline> pipeline;
+        std::exception_ptr error;
+        std::atomic<bool> ready{false};
+        JobSystem::JobHandle job;
+    };
+
+    std::shared_ptr<State> state;
+
+    friend class PipelineCompiler;
+};
+
+//Compiles pipelines as jobs, so that every variant requested at startup is built concurrently instead of one after
+//the other. The pipeline layouts and render passes a pipeline is created with have to outlive its compilation.
+class PipelineCompiler {
+    public:
+    //Without a job system pipelines are compiled right away on the calling thread
+    PipelineCompiler(GraphicsDevice& device, std::shared_ptr<JobSystem> jobSystem = nullptr);
+    PipelineCompiler(const PipelineCompiler&) = delete;
+    void operator=(const PipelineCompiler&) = delete;
+
+    //The config is copied, it doesn't need to stay alive
+    PipelineHandle<GraphicsPipeline> compile(
+        const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+    PipelineHandle<ComputePipeline> compile(const std::string& compFilepath, vk::PipelineLayout pipelineLayout);
+
+    //Blocks until the pipeline is compiled, rethrows whatever its compilation threw
+    template <typename Pipeline>
+    void wait(const PipelineHandle<Pipeline>& handle) {
+        assert(handle.state != nullptr && "Waiting on an empty pipeline handle");
+        if (handle.state->job.isValid()) jobSystem->wait(handle.state->job);
+        if (handle.state->error) std::rethrow_exception(handle.state->error);
+    }
+    //Blocks until every pipeline requested so far is compiled, failed ones are only reported by wait
+    void waitAll();
+
+    private:
+    template <typename Pipeline, typename CreateFunction>
+    PipelineHandle<Pipeline> schedule(CreateFunction create, const char* name);
+
+    GraphicsDevice& graphicsDevice;
+    std::shared_ptr<JobSystem> jobSystem;
+
+    std::mutex pendingMutex;
+    std::vector<JobSystem::JobHandle> pendingJobs;
+};
+
+//Every variant of one shader pair and pipeline config, compiled the first time its key is requested.
+//Requesting isn't thread safe, variants needed by chunks recorded in parallel have to be requested in prepare.
+class GraphicsPipelineVariants {
+    public:
+    GraphicsPipelineVariants(
+        PipelineCompiler& pipelineCompiler, std::string vertFilepath, std::string fragFilepath, const PipelineConfigInfo& baseConfig);
+    GraphicsPipelineVariants(const GraphicsPipelineVariants&) = delete;
+    void operator=(const GraphicsPipelineVariants&) = delete;
+
+    const PipelineHandle<GraphicsPipeline>& get(const ShaderVariantKey& key);
+    //Starts compiling all of them at once, e.g. every variant a scene's materials need at startup
+    void request(const std::vector<ShaderVariantKey>& keys);
+    //Variants compiled from now on target this render pass, the ones already compiled are kept
+    void setRenderPass(vk::RenderPass renderPass) { baseConfig.renderPass = renderPass; }
+
+    private:
+    PipelineCompiler& pipelineCompiler;
+    std::string vertFilepath;
+    std::string fragFilepath;
+    PipelineConfigInfo baseConfig;
+
+    std::unordered_map<ShaderVariantKey, PipelineHandle<GraphicsPipeline>, ShaderVariantKey::Hash> variants;
+};
+}
\ No newline at end of file
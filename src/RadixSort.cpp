@@ -0,0 +1,38 @@
+#include "RadixSort.h"
+
+#include <array>
+#include <utility>
+
+namespace rkrai {
+void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch) {
+    constexpr uint32_t PASS_COUNT = sizeof(uint64_t);
+    constexpr uint32_t BUCKET_COUNT = 256;
+    if (items.size() < 2) return;
+    scratch.resize(items.size());
+
+    //All histograms are built in one read of the keys
+    std::array<std::array<uint32_t, BUCKET_COUNT>, PASS_COUNT> histograms{};
+    for (const SortItem& item : items) {
+        for (uint32_t pass = 0; pass < PASS_COUNT; pass++) {
+            histograms[pass][(item.key >> (pass * 8)) & 0xff]++;
+        }
+    }
+
+    for (uint32_t pass = 0; pass < PASS_COUNT; pass++) {
+        auto& histogram = histograms[pass];
+        const uint32_t firstByte = (items[0].key >> (pass * 8)) & 0xff;
+        if (histogram[firstByte] == items.size()) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& count : histogram) {
+            uint32_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+        for (const SortItem& item : items) {
+            scratch[histogram[(item.key >> (pass * 8)) & 0xff]++] = item;
+        }
+        std::swap(items, scratch);
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace rkrai {
+struct SortItem {
+    uint64_t key;
+    uint32_t value;
+};
+
+//Stable least significant digit radix sort over the 64 bit keys, one byte per pass. Passes where every key
+//has the same byte are skipped, so keys that only use a few bits cost a few passes. scratch is resized as needed.
+void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
+}
\ No newline at end of file
@@ -0,0 +1,592 @@
+#include "RenderGraph.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace rkrai {
+static constexpr vk::AccessFlags WRITE_ACCESS = vk::AccessFlagBits::eColorAttachmentWrite
+    | vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+
+RenderGraph::RenderGraph(GraphicsDevice& device) : graphicsDevice(device) {}
+
+RenderGraph::ResourceHandle RenderGraph::createImage(const char* name, vk::Format format) {
+    assert(!compiled && "Can't add resources to a compiled RenderGraph!");
+    resources.push_back({.name = name, .format = format, .imported = false});
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::importImage(
+    const char* name, vk::Format format, std::vector<vk::Image> images, std::vector<vk::ImageView> imageViews,
+    vk::ImageLayout finalLayout, vk::PipelineStageFlags availableStages) {
+    assert(!compiled && "Can't add resources to a compiled RenderGraph!");
+    assert(images.size() == imageViews.size() && "Every imported image needs a view!");
+    resources.push_back({
+        .name = name,
+        .format = format,
+        .imported = true,
+        .images = std::move(images),
+        .imageViews = std::move(imageViews),
+        .finalLayout = finalLayout,
+        .availableStages = availableStages
+    });
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+RenderGraph::PassHandle RenderGraph::addPass(const char* name, PassType type, RecordFunction record, vk::SubpassContents contents) {
+    assert(!compiled && "Can't add passes to a compiled RenderGraph!");
+    passes.push_back({.name = name, .type = type, .record = std::move(record), .contents = contents});
+    return static_cast<PassHandle>(passes.size() - 1);
+}
+
+void RenderGraph::writeColor(PassHandle pass, ResourceHandle image, std::optional<vk::ClearColorValue> clearValue) {
+    std::optional<vk::ClearValue> value;
+    if (clearValue) {
+        value.emplace();
+        value->color = *clearValue;
+    }
+    addUsage(pass, image, UsageType::eColorWrite, vk::PipelineStageFlagBits::eColorAttachmentOutput, value);
+}
+
+void RenderGraph::writeDepth(PassHandle pass, ResourceHandle image, std::optional<vk::ClearDepthStencilValue> clearValue) {
+    std::optional<vk::ClearValue> value;
+    if (clearValue) {
+        value.emplace();
+        value->depthStencil = *clearValue;
+    }
+    addUsage(
+        pass, image, UsageType::eDepthWrite,
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, value
+    );
+}
+
+void RenderGraph::readDepth(PassHandle pass, ResourceHandle image) {
+    addUsage(
+        pass, image, UsageType::eDepthRead,
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, std::nullopt
+    );
+}
+
+void RenderGraph::readInputAttachment(PassHandle pass, ResourceHandle image) {
+    addUsage(pass, image, UsageType::eInputAttachment, vk::PipelineStageFlagBits::eFragmentShader, std::nullopt);
+}
+
+void RenderGraph::readSampled(PassHandle pass, ResourceHandle image, vk::PipelineStageFlags stages) {
+    addUsage(pass, image, UsageType::eSampled, stages, std::nullopt);
+}
+
+void RenderGraph::readTransfer(PassHandle pass, ResourceHandle image) {
+    addUsage(pass, image, UsageType::eTransferRead, vk::PipelineStageFlagBits::eTransfer, std::nullopt);
+}
+
+void RenderGraph::writeTransfer(PassHandle pass, ResourceHandle image) {
+    addUsage(pass, image, UsageType::eTransferWrite, vk::PipelineStageFlagBits::eTransfer, std::nullopt);
+}
+
+void RenderGraph::addUsage(
+    PassHandle pass, ResourceHandle image, UsageType type, vk::PipelineStageFlags stages, std::optional<vk::ClearValue> clearValue) {
+    assert(!compiled && "Can't add usages to a compiled RenderGraph!");
+    const bool isTransferUsage = type == UsageType::eTransferRead || type == UsageType::eTransferWrite;
+    assert((isTransferUsage == (passes[pass].type == PassType::eTransfer)) && "Only transfer passes copy images!");
+    assert((type == UsageType::eSampled || isTransferUsage || passes[pass].type == PassType::eGraphics) && "Only graphics passes have attachments!");
+
+    vk::ImageLayout readOnlyLayout = isDepthFormat(resources[image].format)
+        ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal;
+    vk::AccessFlags access;
+    vk::ImageLayout layout;
+    switch (type) {
+        case UsageType::eColorWrite:
+            access = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+            layout = vk::ImageLayout::eColorAttachmentOptimal;
+            break;
+        case UsageType::eDepthWrite:
+            access = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+            layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            break;
+        case UsageType::eDepthRead:
+            access = vk::AccessFlagBits::eDepthStencilAttachmentRead;
+            layout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+            break;
+        case UsageType::eInputAttachment:
+            access = vk::AccessFlagBits::eInputAttachmentRead;
+            layout = readOnlyLayout;
+            break;
+        case UsageType::eSampled:
+            access = vk::AccessFlagBits::eShaderRead;
+            layout = readOnlyLayout;
+            break;
+        case UsageType::eTransferRead:
+            access = vk::AccessFlagBits::eTransferRead;
+            layout = vk::ImageLayout::eTransferSrcOptimal;
+            break;
+        case UsageType::eTransferWrite:
+            access = vk::AccessFlagBits::eTransferWrite;
+            layout = vk::ImageLayout::eTransferDstOptimal;
+            break;
+    }
+    for (const Usage& usage : passes[pass].usages) {
+        assert((usage.resource != image || usage.layout == layout) && "A pass can't use an image in two different layouts!");
+    }
+    passes[pass].usages.push_back({image, type, stages, access, layout, clearValue});
+}
+
+void RenderGraph::compile(vk::Extent2D extent, RenderGraph* previous) {
+    assert(!compiled && "RenderGraph is already compiled!");
+    this->extent = extent;
+    renderPassesReused = previous != nullptr;
+    createSteps();
+    createImages();
+    createBarriers(previous);
+    compiled = true;
+}
+
+void RenderGraph::createSteps() {
+    for (PassHandle passHandle = 0; passHandle < passes.size(); passHandle++) {
+        Pass& pass = passes[passHandle];
+        if (steps.empty() || !canMerge(steps.back(), pass)) {
+            steps.emplace_back();
+        }
+        Step& step = steps.back();
+        pass.step = static_cast<uint32_t>(steps.size() - 1);
+        pass.subpass = static_cast<uint32_t>(step.passes.size());
+        step.passes.push_back(passHandle);
+    }
+}
+
+//Subpasses can only depend on each other at the same pixel, so anything sampled has to wait for the render pass to end
+bool RenderGraph::canMerge(const Step& step, const Pass& pass) const {
+    if (pass.type != PassType::eGraphics || passes[step.passes.back()].type != PassType::eGraphics) return false;
+
+    for (PassHandle previousPass : step.passes) {
+        for (const Usage& previous : passes[previousPass].usages) {
+            for (const Usage& usage : pass.usages) {
+                if (usage.resource == previous.resource && (usage.type == UsageType::eSampled || previous.type == UsageType::eSampled)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void RenderGraph::createImages() {
+    for (const Pass& pass : passes) {
+        for (const Usage& usage : pass.usages) {
+            Resource& resource = resources[usage.resource];
+            resource.firstStep = std::min(resource.firstStep, pass.step);
+            resource.lastStep = std::max(resource.lastStep, pass.step);
+            switch (usage.type) {
+                case UsageType::eColorWrite: resource.usage |= vk::ImageUsageFlagBits::eColorAttachment; break;
+                case UsageType::eDepthWrite:
+                case UsageType::eDepthRead: resource.usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment; break;
+                case UsageType::eInputAttachment: resource.usage |= vk::ImageUsageFlagBits::eInputAttachment; break;
+                case UsageType::eSampled: resource.usage |= vk::ImageUsageFlagBits::eSampled; break;
+                case UsageType::eTransferRead: resource.usage |= vk::ImageUsageFlagBits::eTransferSrc; break;
+                case UsageType::eTransferWrite: resource.usage |= vk::ImageUsageFlagBits::eTransferDst; break;
+            }
+        }
+    }
+
+    //Everything the last step using an image does with it, which the first use of the next frame has to wait for
+    auto getLastUse = [&](ResourceHandle handle) {
+        ResourceState state{};
+        for (const Pass& pass : passes) {
+            if (pass.step != resources[handle].lastStep) continue;
+            for (const Usage& usage : pass.usages) {
+                if (usage.resource != handle) continue;
+                state.stages |= usage.stages;
+                state.access |= usage.access & WRITE_ACCESS;
+            }
+        }
+        return state;
+    };
+
+    size_t createdCount = std::count_if(resources.begin(), resources.end(), [](const Resource& resource) { return !resource.imported; });
+    //Views keep a reference to their image
+    images.reserve(createdCount);
+    imageViews.reserve(createdCount);
+
+    std::vector<ResourceHandle> aliasedImages;
+    for (ResourceHandle handle = 0; handle < resources.size(); handle++) {
+        Resource& resource = resources[handle];
+        if (resource.imported) {
+            resource.initialState = {resource.availableStages, {}, vk::ImageLayout::eUndefined};
+            continue;
+        }
+        assert(resource.firstStep != UINT32_MAX && "Created image is never used!");
+
+        //Never stored or sampled, tilers can keep it in tile memory for the whole render pass
+        resource.transient = resource.firstStep == resource.lastStep && passes[steps[resource.firstStep].passes[0]].type == PassType::eGraphics
+            && !(resource.usage & vk::ImageUsageFlagBits::eSampled);
+        if (resource.transient) {
+            resource.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+        } else {
+            aliasedImages.push_back(handle);
+        }
+        resource.imageIndex = static_cast<uint32_t>(images.size());
+        resource.initialState = getLastUse(handle);
+        images.emplace_back(
+            graphicsDevice,
+            vk::ImageType::e2D,
+            vk::Extent3D{extent.width, extent.height, 1},
+            resource.format,
+            resource.usage,
+            1,
+            resource.transient
+        );
+    }
+
+    std::vector<vk::MemoryRequirements> requirements(resources.size());
+    for (ResourceHandle handle : aliasedImages) {
+        requirements[handle] = images[resources[handle].imageIndex].getMemoryRequirements();
+    }
+    std::sort(aliasedImages.begin(), aliasedImages.end(), [&](ResourceHandle a, ResourceHandle b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    //Largest first, every image goes into the first slot that none of the images it overlaps with are in
+    std::vector<MemorySlot> slots;
+    for (ResourceHandle handle : aliasedImages) {
+        const Resource& resource = resources[handle];
+        auto overlaps = [&](ResourceHandle other) {
+            return resource.firstStep <= resources[other].lastStep && resources[other].firstStep <= resource.lastStep;
+        };
+        auto slot = std::find_if(slots.begin(), slots.end(), [&](const MemorySlot& candidate) {
+            return (candidate.memoryTypeBits & requirements[handle].memoryTypeBits) != 0
+                && std::none_of(candidate.resources.begin(), candidate.resources.end(), overlaps);
+        });
+        if (slot == slots.end()) {
+            slot = slots.emplace(slots.end());
+        }
+        slot->size = std::max(slot->size, requirements[handle].size);
+        slot->memoryTypeBits &= requirements[handle].memoryTypeBits;
+        slot->resources.push_back(handle);
+    }
+
+    for (const MemorySlot& slot : slots) {
+        uint32_t memoryType = graphicsDevice.findMemoryType(slot.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        memorySlots.push_back(graphicsDevice.getDevice().allocateMemoryUnique({slot.size, memoryType}));
+
+        //Whichever image used the memory last in the previous frame has to be done with it before any of them start
+        ResourceState sharedState{};
+        for (ResourceHandle handle : slot.resources) {
+            sharedState.stages |= resources[handle].initialState.stages;
+            sharedState.access |= resources[handle].initialState.access;
+        }
+        for (ResourceHandle handle : slot.resources) {
+            resources[handle].initialState = sharedState;
+            images[resources[handle].imageIndex].bindMemory(*memorySlots.back(), 0);
+        }
+    }
+
+    for (Image& image : images) {
+        vk::ImageAspectFlags aspect = isDepthFormat(image.getFormat()) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+        imageViews.emplace_back(image, aspect);
+    }
+}
+
+//Walks the steps in order while tracking how every image was last used. A barrier is only needed when the layout
+//changes, something was written before, or something is about to be written that an earlier step still reads.
+void RenderGraph::createBarriers(RenderGraph* previous) {
+    struct StepUse {
+        bool used = false;
+        ResourceState state;
+        vk::ImageLayout firstLayout = vk::ImageLayout::eUndefined;
+    };
+
+    std::vector<ResourceState> states(resources.size());
+    for (ResourceHandle handle = 0; handle < resources.size(); handle++) {
+        states[handle] = resources[handle].initialState;
+    }
+
+    for (uint32_t stepIndex = 0; stepIndex < steps.size(); stepIndex++) {
+        Step& step = steps[stepIndex];
+        std::vector<StepUse> uses(resources.size());
+        for (PassHandle passHandle : step.passes) {
+            for (const Usage& usage : passes[passHandle].usages) {
+                StepUse& use = uses[usage.resource];
+                if (!use.used) {
+                    use.used = true;
+                    use.firstLayout = usage.layout;
+                }
+                use.state.stages |= usage.stages;
+                use.state.access |= usage.access;
+                use.state.layout = usage.layout;
+            }
+        }
+
+        std::vector<ResourceState> statesBefore = states;
+        bool isRenderPass = passes[step.passes[0]].type == PassType::eGraphics;
+        for (ResourceHandle handle = 0; handle < resources.size(); handle++) {
+            const StepUse& use = uses[handle];
+            if (!use.used) continue;
+            const ResourceState& state = states[handle];
+
+            bool writtenBefore = static_cast<bool>(state.access & WRITE_ACCESS);
+            bool writeAfterRead = (use.state.access & WRITE_ACCESS) && state.stages;
+            if (state.layout != use.firstLayout || writtenBefore || writeAfterRead) {
+                step.srcStages |= state.stages ? state.stages : vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTopOfPipe};
+                step.dstStages |= use.state.stages;
+                step.barriers.push_back({handle, state.access & WRITE_ACCESS, use.state.access, state.layout, use.firstLayout});
+            }
+
+            //Imported images are moved into their final layout by the render pass that uses them last
+            const Resource& resource = resources[handle];
+            bool endsInFinalLayout = resource.imported && resource.lastStep == stepIndex && isRenderPass;
+            states[handle] = {use.state.stages, use.state.access, endsInFinalLayout ? resource.finalLayout : use.state.layout};
+        }
+
+        if (isRenderPass) {
+            createRenderPass(stepIndex, statesBefore, previous);
+            createFramebuffers(step);
+        }
+    }
+
+    Step finalStep{};
+    for (ResourceHandle handle = 0; handle < resources.size(); handle++) {
+        const Resource& resource = resources[handle];
+        if (!resource.imported || states[handle].layout == resource.finalLayout) continue;
+        finalStep.srcStages |= states[handle].stages ? states[handle].stages : vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTopOfPipe};
+        finalStep.dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+        finalStep.barriers.push_back({handle, states[handle].access & WRITE_ACCESS, {}, states[handle].layout, resource.finalLayout});
+    }
+    if (!finalStep.barriers.empty()) {
+        steps.push_back(std::move(finalStep));
+    }
+}
+
+//Attachments are loaded only if an earlier step left something in them and stored only if a later step or the
+//importer needs them. Every earlier subpass a subpass shares an attachment with gets a per pixel dependency.
+void RenderGraph::createRenderPass(uint32_t stepIndex, const std::vector<ResourceState>& statesBefore, RenderGraph* previous) {
+    Step& step = steps[stepIndex];
+
+    std::vector<vk::AttachmentDescription> attachments;
+    std::vector<uint32_t> attachmentIndices(resources.size(), UINT32_MAX);
+    for (PassHandle passHandle : step.passes) {
+        for (const Usage& usage : passes[passHandle].usages) {
+            if (usage.type == UsageType::eSampled) continue;
+            const Resource& resource = resources[usage.resource];
+
+            uint32_t& attachmentIndex = attachmentIndices[usage.resource];
+            if (attachmentIndex != UINT32_MAX) {
+                attachments[attachmentIndex].finalLayout = usage.layout;
+                continue;
+            }
+            attachmentIndex = static_cast<uint32_t>(attachments.size());
+            step.attachments.push_back(usage.resource);
+            step.clearValues.push_back(usage.clearValue.value_or(vk::ClearValue{}));
+
+            bool hasContents = statesBefore[usage.resource].layout != vk::ImageLayout::eUndefined;
+            bool isReadLater = resource.imported || resource.lastStep > stepIndex;
+            vk::AttachmentDescription attachment{};
+            attachment.format = resource.format;
+            attachment.samples = vk::SampleCountFlagBits::e1;
+            attachment.loadOp = usage.clearValue ? vk::AttachmentLoadOp::eClear
+                : (hasContents ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare);
+            attachment.storeOp = isReadLater ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+            attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+            attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+            attachment.initialLayout = usage.layout;
+            attachment.finalLayout = usage.layout;
+            attachments.push_back(attachment);
+        }
+    }
+    for (uint32_t i = 0; i < attachments.size(); i++) {
+        const Resource& resource = resources[step.attachments[i]];
+        if (resource.imported && resource.lastStep == stepIndex) {
+            attachments[i].finalLayout = resource.finalLayout;
+        }
+    }
+
+    std::vector<SubpassReferences> references(step.passes.size());
+    std::vector<std::vector<bool>> isUsed(step.passes.size(), std::vector<bool>(attachments.size(), false));
+    for (uint32_t subpass = 0; subpass < step.passes.size(); subpass++) {
+        for (const Usage& usage : passes[step.passes[subpass]].usages) {
+            if (usage.type == UsageType::eSampled) continue;
+            uint32_t attachmentIndex = attachmentIndices[usage.resource];
+            isUsed[subpass][attachmentIndex] = true;
+            switch (usage.type) {
+                case UsageType::eColorWrite:
+                    references[subpass].colors.push_back({attachmentIndex, usage.layout});
+                    break;
+                case UsageType::eDepthWrite:
+                case UsageType::eDepthRead:
+                    assert(!references[subpass].depth && "A pass can only have one depth attachment!");
+                    references[subpass].depth = vk::AttachmentReference{attachmentIndex, usage.layout};
+                    break;
+                case UsageType::eInputAttachment:
+                    references[subpass].inputs.push_back({attachmentIndex, usage.layout});
+                    break;
+                case UsageType::eSampled:
+                case UsageType::eTransferRead:
+                case UsageType::eTransferWrite:
+                    break;
+            }
+        }
+    }
+    //Attachments that a subpass skips but that are used before and after it have to keep their contents
+    for (uint32_t subpass = 1; subpass + 1 < step.passes.size(); subpass++) {
+        for (uint32_t attachmentIndex = 0; attachmentIndex < attachments.size(); attachmentIndex++) {
+            if (isUsed[subpass][attachmentIndex]) continue;
+            bool usedBefore = false;
+            bool usedAfter = false;
+            for (uint32_t other = 0; other < step.passes.size(); other++) {
+                if (other < subpass) usedBefore |= isUsed[other][attachmentIndex];
+                if (other > subpass) usedAfter |= isUsed[other][attachmentIndex];
+            }
+            if (usedBefore && usedAfter) {
+                references[subpass].preserves.push_back(attachmentIndex);
+            }
+        }
+    }
+
+    std::vector<vk::SubpassDescription> subpasses(step.passes.size());
+    for (uint32_t subpass = 0; subpass < step.passes.size(); subpass++) {
+        subpasses[subpass].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpasses[subpass].setColorAttachments(references[subpass].colors);
+        subpasses[subpass].setInputAttachments(references[subpass].inputs);
+        subpasses[subpass].setPreserveAttachments(references[subpass].preserves);
+        if (references[subpass].depth) {
+            subpasses[subpass].setPDepthStencilAttachment(&*references[subpass].depth);
+        }
+    }
+
+    std::vector<vk::SubpassDependency> dependencies;
+    for (uint32_t dstSubpass = 1; dstSubpass < step.passes.size(); dstSubpass++) {
+        for (uint32_t srcSubpass = 0; srcSubpass < dstSubpass; srcSubpass++) {
+            vk::SubpassDependency dependency{srcSubpass, dstSubpass};
+            dependency.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+            for (const Usage& dstUsage : passes[step.passes[dstSubpass]].usages) {
+                for (const Usage& srcUsage : passes[step.passes[srcSubpass]].usages) {
+                    if (srcUsage.resource != dstUsage.resource || !((srcUsage.access | dstUsage.access) & WRITE_ACCESS)) continue;
+                    dependency.srcStageMask |= srcUsage.stages;
+                    dependency.srcAccessMask |= srcUsage.access & WRITE_ACCESS;
+                    dependency.dstStageMask |= dstUsage.stages;
+                    dependency.dstAccessMask |= dstUsage.access;
+                }
+            }
+            if (dependency.srcStageMask) {
+                dependencies.push_back(dependency);
+            }
+        }
+    }
+
+    step.attachmentDescriptions = attachments;
+    step.subpassReferences = references;
+    step.dependencies = dependencies;
+    if (previous != nullptr) {
+        step.renderPass = previous->takeRenderPass(step);
+    }
+    if (!step.renderPass) {
+        renderPassesReused = false;
+        step.renderPass = graphicsDevice.getDevice().createRenderPassUnique({{}, attachments, subpasses, dependencies});
+    }
+}
+
+//Only identical descriptions are taken, merely compatible ones could still differ in load and store ops
+vk::UniqueRenderPass RenderGraph::takeRenderPass(const Step& step) {
+    for (Step& ownStep : steps) {
+        if (ownStep.renderPass && ownStep.attachmentDescriptions == step.attachmentDescriptions
+            && ownStep.subpassReferences == step.subpassReferences && ownStep.dependencies == step.dependencies) {
+            return std::move(ownStep.renderPass);
+        }
+    }
+    return {};
+}
+
+void RenderGraph::createFramebuffers(Step& step) {
+    size_t framebufferCount = 1;
+    for (ResourceHandle handle : step.attachments) {
+        if (resources[handle].imported) {
+            assert((framebufferCount == 1 || framebufferCount == resources[handle].images.size()) && "Imported images don't match up!");
+            framebufferCount = resources[handle].images.size();
+        }
+    }
+
+    for (size_t i = 0; i < framebufferCount; i++) {
+        std::vector<vk::ImageView> attachments;
+        for (ResourceHandle handle : step.attachments) {
+            const Resource& resource = resources[handle];
+            attachments.push_back(resource.imported ? resource.imageViews[i] : imageViews[resource.imageIndex].getImageView());
+        }
+        step.framebuffers.push_back(graphicsDevice.getDevice().createFramebufferUnique({
+            {}, *step.renderPass, attachments, extent.width, extent.height, 1
+        }));
+    }
+}
+
+vk::Framebuffer RenderGraph::getFramebuffer(PassHandle pass, uint32_t importIndex) const {
+    const Step& step = steps[passes[pass].step];
+    return *step.framebuffers[step.framebuffers.size() == 1 ? 0 : importIndex];
+}
+
+void RenderGraph::execute(vk::CommandBuffer commandBuffer, uint32_t importIndex, std::optional<vk::Extent2D> renderArea) {
+    assert(compiled && "RenderGraph::compile must be called before executing!");
+    assert((!renderArea || (renderArea->width <= extent.width && renderArea->height <= extent.height)) && "Render area exceeds the graph's extent!");
+    for (const Step& step : steps) {
+        recordBarriers(commandBuffer, step, importIndex);
+        if (!step.renderPass) {
+            for (PassHandle passHandle : step.passes) {
+                passes[passHandle].record(commandBuffer, passHandle);
+            }
+            continue;
+        }
+
+        vk::RenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.renderPass = *step.renderPass;
+        renderPassInfo.framebuffer = getFramebuffer(step.passes[0], importIndex);
+        renderPassInfo.renderArea = vk::Rect2D{{0, 0}, renderArea.value_or(extent)};
+        renderPassInfo.setClearValues(step.clearValues);
+
+        for (PassHandle passHandle : step.passes) {
+            const Pass& pass = passes[passHandle];
+            if (pass.subpass == 0) {
+                commandBuffer.beginRenderPass(renderPassInfo, pass.contents);
+            } else {
+                commandBuffer.nextSubpass(pass.contents);
+            }
+            pass.record(commandBuffer, passHandle);
+        }
+        commandBuffer.endRenderPass();
+    }
+}
+
+void RenderGraph::recordBarriers(vk::CommandBuffer commandBuffer, const Step& step, uint32_t importIndex) {
+    if (step.barriers.empty()) return;
+
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    for (const ImageBarrier& barrier : step.barriers) {
+        imageBarriers.push_back({
+            barrier.srcAccess, barrier.dstAccess, barrier.oldLayout, barrier.newLayout,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, getImage(barrier.resource, importIndex),
+            vk::ImageSubresourceRange{getAspectMask(resources[barrier.resource].format), 0, VK_REMAINING_MIP_LEVELS, 0, 1}
+        });
+    }
+    commandBuffer.pipelineBarrier(step.srcStages, step.dstStages, {}, {}, {}, imageBarriers);
+}
+
+vk::Image RenderGraph::getImage(ResourceHandle resource, uint32_t importIndex) {
+    return resources[resource].imported ? resources[resource].images[importIndex] : images[resources[resource].imageIndex].getImage();
+}
+
+bool RenderGraph::isDepthFormat(vk::Format format) {
+    switch (format) {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eX8D24UnormPack32:
+        case vk::Format::eD32Sfloat:
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint:
+            return true;
+        default:
+            return false;
+    }
+}
+
+vk::ImageAspectFlags RenderGraph::getAspectMask(vk::Format format) {
+    if (!isDepthFormat(format)) return vk::ImageAspectFlagBits::eColor;
+    bool hasStencil = format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+    return hasStencil ? vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil : vk::ImageAspectFlagBits::eDepth;
+}
+}
\ No newline at end of file
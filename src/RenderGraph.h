@@ -0,0 +1,199 @@
+#pragma once
+
+#include "GraphicsDevice.h"
+#include "Image.h"
+#include "ImageView.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace rkrai {
+//Describes a frame as passes, added in execution order, that declare which images they read and write. Compiling
+//merges runs of graphics passes that only read each other's output at the same pixel into subpasses of one render
+//pass, picks attachment load and store ops from how every image is used before and after, and derives the barriers
+//needed between render passes and compute or transfer passes. Images that only live within one render pass get transient,
+//lazily allocated memory, all other created images share memory with the ones they are never alive at the same time as.
+//Buffers aren't tracked, compute work that writes them still synchronizes them itself.
+class RenderGraph {
+    public:
+    using ResourceHandle = uint32_t;
+    using PassHandle = uint32_t;
+    //Graphics passes are called with their subpass already begun
+    using RecordFunction = std::function<void(vk::CommandBuffer commandBuffer, PassHandle pass)>;
+
+    enum class PassType {
+        eGraphics,
+        eCompute,
+        eTransfer
+    };
+
+    RenderGraph(GraphicsDevice& device);
+    RenderGraph(const RenderGraph&) = delete;
+    void operator=(const RenderGraph&) = delete;
+
+    //Created at the graph's extent when compiling, the contents don't carry over from one frame to the next
+    ResourceHandle createImage(const char* name, vk::Format format);
+    //One image per import index passed to execute, like the swap chain images. They are left in finalLayout at the end
+    //of the frame, and availableStages has to include the stages the submission waits on for them to become available.
+    ResourceHandle importImage(
+        const char* name, vk::Format format, std::vector<vk::Image> images, std::vector<vk::ImageView> imageViews,
+        vk::ImageLayout finalLayout, vk::PipelineStageFlags availableStages
+    );
+
+    PassHandle addPass(const char* name, PassType type, RecordFunction record, vk::SubpassContents contents = vk::SubpassContents::eInline);
+    //Color attachments get locations in the order they are written, input attachments indices in the order they are read
+    void writeColor(PassHandle pass, ResourceHandle image, std::optional<vk::ClearColorValue> clearValue = std::nullopt);
+    void writeDepth(PassHandle pass, ResourceHandle image, std::optional<vk::ClearDepthStencilValue> clearValue = std::nullopt);
+    //Binds the image as a read only depth attachment
+    void readDepth(PassHandle pass, ResourceHandle image);
+    void readInputAttachment(PassHandle pass, ResourceHandle image);
+    void readSampled(PassHandle pass, ResourceHandle image, vk::PipelineStageFlags stages);
+    //Copy or blit source and destination of transfer passes
+    void readTransfer(PassHandle pass, ResourceHandle image);
+    void writeTransfer(PassHandle pass, ResourceHandle image);
+
+    //No passes or resources can be added after compiling. Render passes that come out exactly like one of the previous
+    //graph's are taken over from it instead of being created again, which leaves it without them.
+    void compile(vk::Extent2D extent, RenderGraph* previous = nullptr);
+    //Records every pass along with the barriers between them, importIndex picks the image of every imported resource.
+    //Render passes only touch renderArea, which defaults to the whole extent.
+    void execute(vk::CommandBuffer commandBuffer, uint32_t importIndex, std::optional<vk::Extent2D> renderArea = std::nullopt);
+
+    vk::RenderPass getRenderPass(PassHandle pass) const { return *steps[passes[pass].step].renderPass; }
+    uint32_t getSubpass(PassHandle pass) const { return passes[pass].subpass; }
+    vk::Framebuffer getFramebuffer(PassHandle pass, uint32_t importIndex) const;
+    vk::SubpassContents getSubpassContents(PassHandle pass) const { return passes[pass].contents; }
+    //Only for created images, valid once compiled
+    vk::ImageView getImageView(ResourceHandle image) { return imageViews[resources[image].imageIndex].getImageView(); }
+    vk::Image getImage(ResourceHandle resource, uint32_t importIndex);
+    vk::Extent2D getExtent() const { return extent; }
+    //Whether every render pass was taken over from the previous graph, handles to its render passes then stay valid
+    bool reusesRenderPasses() const { return renderPassesReused; }
+
+    private:
+    enum class UsageType {
+        eColorWrite,
+        eDepthWrite,
+        eDepthRead,
+        eInputAttachment,
+        eSampled,
+        eTransferRead,
+        eTransferWrite
+    };
+
+    struct Usage {
+        ResourceHandle resource;
+        UsageType type;
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags access;
+        vk::ImageLayout layout;
+        std::optional<vk::ClearValue> clearValue;
+    };
+
+    struct ResourceState {
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags access;
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+    };
+
+    struct Resource {
+        const char* name;
+        vk::Format format;
+        bool imported;
+        std::vector<vk::Image> images;
+        std::vector<vk::ImageView> imageViews;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags availableStages;
+
+        //Filled in when compiling
+        vk::ImageUsageFlags usage;
+        uint32_t firstStep = UINT32_MAX;
+        uint32_t lastStep = 0;
+        bool transient = false;
+        uint32_t imageIndex = 0;
+        //What the first use of a frame has to wait for, the image's (or the images it aliases') last use of the previous frame
+        ResourceState initialState;
+    };
+
+    struct Pass {
+        const char* name;
+        PassType type;
+        RecordFunction record;
+        vk::SubpassContents contents;
+        std::vector<Usage> usages;
+        uint32_t step = 0;
+        uint32_t subpass = 0;
+    };
+
+    struct ImageBarrier {
+        ResourceHandle resource;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+    };
+
+    struct SubpassReferences {
+        std::vector<vk::AttachmentReference> colors;
+        std::vector<vk::AttachmentReference> inputs;
+        std::optional<vk::AttachmentReference> depth;
+        std::vector<uint32_t> preserves;
+
+        bool operator==(const SubpassReferences&) const = default;
+    };
+
+    //A render pass made of one or more graphics passes, or a single compute or transfer pass, and the barriers recorded before it
+    struct Step {
+        std::vector<PassHandle> passes;
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        std::vector<ImageBarrier> barriers;
+
+        vk::UniqueRenderPass renderPass;
+        //What the render pass was created from
+        std::vector<vk::AttachmentDescription> attachmentDescriptions;
+        std::vector<SubpassReferences> subpassReferences;
+        std::vector<vk::SubpassDependency> dependencies;
+        std::vector<ResourceHandle> attachments;
+        std::vector<vk::ClearValue> clearValues;
+        //One per import index if any attachment is imported
+        std::vector<vk::UniqueFramebuffer> framebuffers;
+    };
+
+    struct MemorySlot {
+        vk::DeviceSize size = 0;
+        uint32_t memoryTypeBits = ~0u;
+        std::vector<ResourceHandle> resources;
+    };
+
+    void addUsage(PassHandle pass, ResourceHandle image, UsageType type, vk::PipelineStageFlags stages, std::optional<vk::ClearValue> clearValue);
+    bool canMerge(const Step& step, const Pass& pass) const;
+    void createSteps();
+    void createImages();
+    void createBarriers(RenderGraph* previous);
+    void createRenderPass(uint32_t stepIndex, const std::vector<ResourceState>& statesBefore, RenderGraph* previous);
+    vk::UniqueRenderPass takeRenderPass(const Step& step);
+    void createFramebuffers(Step& step);
+    void recordBarriers(vk::CommandBuffer commandBuffer, const Step& step, uint32_t importIndex);
+
+    static bool isDepthFormat(vk::Format format);
+    static vk::ImageAspectFlags getAspectMask(vk::Format format);
+
+    GraphicsDevice& graphicsDevice;
+    vk::Extent2D extent{0, 0};
+    bool compiled = false;
+    bool renderPassesReused = false;
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+
+    std::vector<vk::UniqueDeviceMemory> memorySlots;
+    std::vector<Image> images;
+    std::vector<ImageView> imageViews;
+    std::vector<Step> steps;
+};
+}
\ No newline at end of file
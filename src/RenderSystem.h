@@ -1,12 +1,40 @@
 #pragma once
 
+#include "ResourceBinder.h"
+
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
+#include <cstdint>
 
 namespace rkrai {
 class RenderSystem {
     private:
+    //Recorded before the render pass begins, for uploads and compute work the draws depend on
+    virtual void prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex) {}
+    //Recorded in the depth only subpass with ShadingPath::eForwardDepthPrepass, render then follows in the main subpass
+    virtual void renderDepthPrepass(vk::CommandBuffer commandBuffer, int currentFrameIndex) {}
     virtual void render(vk::CommandBuffer commandBuffer, int currentFrameIndex) = 0;
+    //Recorded in the second render pass when the Renderer splits the frame for occlusion culling
+    virtual void renderLate(vk::CommandBuffer commandBuffer, int currentFrameIndex) {}
+    //Recorded in the lighting subpass with the deferred shading path, the G-buffer binder holds the albedo,
+    //normal and depth input attachments at bindings 0, 1 and 2
+    virtual void renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder) {}
+    //Called when a rebuild replaced the main render pass. Pipelines already created stay usable since the new pass
+    //is compatible, but any pipeline created from now on has to name the new one.
+    virtual void renderPassChanged(vk::RenderPass renderPass) {}
+
+    //With parallel recording every chunk gets its own secondary command buffer, possibly on another thread.
+    //Chunks of the same system record concurrently, so they may only read state set up in prepare.
+    virtual uint32_t getChunkCount(int currentFrameIndex) const { return 1; }
+    virtual void renderChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount) {
+        render(commandBuffer, currentFrameIndex);
+    }
+    virtual void renderLateChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount) {
+        renderLate(commandBuffer, currentFrameIndex);
+    }
+    virtual void renderDepthPrepassChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount) {
+        renderDepthPrepass(commandBuffer, currentFrameIndex);
+    }
 
     friend class Renderer;
 };
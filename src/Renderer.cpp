@@ -2,33 +2,233 @@
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <stdexcept>
 #include <cassert>
+#include <optional>
+#include <thread>
 
 namespace rkrai {
-Renderer::Renderer(Window& window, GraphicsDevice& device) : window(window), graphicsDevice(device) {
+Renderer::Renderer(Window& window, GraphicsDevice& device, ShadingPath shadingPath, const PresentationSettings& presentationSettings)
+    : window(&window), graphicsDevice(device), shadingPath(shadingPath), presentationSettings(presentationSettings) {
+    //There's nothing to draw into until the window has had a size once
+    while (window.isMinimized()) {
+        glfwWaitEvents();
+    }
+    createTimestampQueries();
     recreateSwapChain();
     createCommandBuffers();
 }
 
-void Renderer::recreateSwapChain() {
-    while (window.getWidth() == 0 || window.getHeight() == 0) {
-        glfwWaitEvents();
+Renderer::Renderer(GraphicsDevice& device, vk::Extent2D extent, ShadingPath shadingPath, const PresentationSettings& presentationSettings)
+    : graphicsDevice(device), shadingPath(shadingPath), presentationSettings(presentationSettings) {
+    assert(presentationSettings.framesInFlight >= 1 && presentationSettings.framesInFlight <= static_cast<uint32_t>(SwapChain::MAX_FRAMES_IN_FLIGHT)
+        && "Unsupported number of frames in flight");
+    offscreenTarget = std::make_unique<OffscreenTarget>(graphicsDevice, extent);
+    readbackFrameNumbers.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, 0);
+    createTimestampQueries();
+    buildRenderGraph();
+    createCommandBuffers();
+}
+
+//Nothing waits for the device, the old swap chain is retired until the frames still using it have finished.
+//While the window is minimized the old one is kept and nothing is drawn, it's recreated once the window has a size again.
+bool Renderer::recreateSwapChain() {
+    assert(window != nullptr && "Headless renderers have no swap chain");
+    if (window->isMinimized()) {
+        swapChainOutOfDate = true;
+        return false;
     }
-    graphicsDevice.getDevice().waitIdle();
+    swapChainOutOfDate = false;
 
-    vk::Extent2D extent = {static_cast<uint32_t>(window.getWidth()), static_cast<uint32_t>(window.getHeight())};
+    vk::Extent2D extent = {static_cast<uint32_t>(window->getWidth()), static_cast<uint32_t>(window->getHeight())};
     if (swapChain == nullptr) {
-        swapChain = std::make_unique<SwapChain>(graphicsDevice, extent);
+        swapChain = std::make_unique<SwapChain>(graphicsDevice, extent, presentationSettings);
     } else {
         std::shared_ptr<SwapChain> oldSwapChain = std::move(swapChain);
-        swapChain = std::make_unique<SwapChain>(graphicsDevice, extent, oldSwapChain);
+        swapChain = std::make_unique<SwapChain>(graphicsDevice, extent, presentationSettings, oldSwapChain);
 
         if (!oldSwapChain->compareSwapChainFormats(*swapChain)) {
             throw std::runtime_error("Swap chain image or depth format has changed!");
         }
+        graphicsDevice.retire(std::move(oldSwapChain));
+    }
+    buildRenderGraph();
+    return true;
+}
+
+//The previous graph is retired along with the swap chain. Formats never change, so the render passes of every rebuild
+//are compatible with the ones render systems created their pipelines for, and after a resize they are the very same.
+//With dynamic resolution the scene is drawn into an image of its own that is sized for the maximum scale, every frame
+//only draws into as much of it as its scale needs, so changing the scale doesn't rebuild anything.
+//Headless, the frame ends up in the offscreen target's image, which is left ready to be copied out.
+void Renderer::buildRenderGraph() {
+    std::unique_ptr<RenderGraph> previousGraph = std::move(renderGraph);
+    renderGraph = std::make_unique<RenderGraph>(graphicsDevice);
+    RenderGraph& graph = *renderGraph;
+
+    const vk::SubpassContents contents = jobSystem != nullptr ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline;
+    const vk::ClearColorValue clearColor{std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}};
+    const vk::ClearColorValue clearGBuffer{std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}};
+    const vk::ClearDepthStencilValue clearDepth{1.0f, 0};
+    auto recordPhase = [this](RenderPhase phase) {
+        return [this, phase](vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass) {
+            recordRenderSystems(commandBuffer, pass, phase);
+        };
+    };
+
+    RenderGraph::ResourceHandle outputImage = swapChain != nullptr
+        ? graph.importImage(
+            "SwapChainImage", swapChain->getImageFormat(), swapChain->getImages(), swapChain->getImageViews(),
+            vk::ImageLayout::ePresentSrcKHR, vk::PipelineStageFlagBits::eColorAttachmentOutput
+        )
+        : graph.importImage(
+            "OffscreenImage", offscreenTarget->getImageFormat(), offscreenTarget->getImages(), offscreenTarget->getImageViews(),
+            vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTopOfPipe
+        );
+    const vk::Format depthFormat = swapChain != nullptr ? swapChain->getDepthFormat() : offscreenTarget->getDepthFormat();
+    vk::Extent2D sceneExtent = getOutputExtent();
+    RenderGraph::ResourceHandle sceneImage = outputImage;
+    sceneScaled = dynamicResolutionSettings.enabled && canScaleScene();
+    if (sceneScaled) {
+        sceneExtent.width = std::max(static_cast<uint32_t>(std::ceil(sceneExtent.width * dynamicResolutionSettings.maxScale)), 1u);
+        sceneExtent.height = std::max(static_cast<uint32_t>(std::ceil(sceneExtent.height * dynamicResolutionSettings.maxScale)), 1u);
+        sceneImage = graph.createImage("Scene", getOutputFormat());
+        resolutionScale = std::clamp(resolutionScale, dynamicResolutionSettings.minScale, dynamicResolutionSettings.maxScale);
+    } else {
+        resolutionScale = 1.0f;
+    }
+    if (occlusionCuller != nullptr) {
+        occlusionCuller->resize(sceneExtent);
+    }
+    depthImage = graph.createImage("Depth", depthFormat);
+
+    if (shadingPath == ShadingPath::eDeferred) {
+        albedoImage = graph.createImage("Albedo", SwapChain::ALBEDO_FORMAT);
+        normalImage = graph.createImage("Normal", SwapChain::NORMAL_FORMAT);
+
+        mainPass = graph.addPass("GBuffer", RenderGraph::PassType::eGraphics, recordPhase(RenderPhase::eMain), contents);
+        graph.writeColor(mainPass, albedoImage, clearGBuffer);
+        graph.writeColor(mainPass, normalImage, clearGBuffer);
+        graph.writeDepth(mainPass, depthImage, clearDepth);
+
+        //Lighting is a handful of fullscreen draws, so it's always recorded inline. Depth stays bound read only,
+        //so forward drawn things like billboards can still be depth tested while lighting.
+        RenderGraph::PassHandle lightingPass = graph.addPass(
+            "Lighting", RenderGraph::PassType::eGraphics,
+            [this](vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass) { recordLighting(commandBuffer); }
+        );
+        graph.readInputAttachment(lightingPass, albedoImage);
+        graph.readInputAttachment(lightingPass, normalImage);
+        graph.readInputAttachment(lightingPass, depthImage);
+        graph.readDepth(lightingPass, depthImage);
+        graph.writeColor(lightingPass, sceneImage, clearColor);
+    } else if (occlusionCuller != nullptr) {
+        //The depth pyramid is built from the early pass's depth, the late pass then draws what the early one missed
+        mainPass = graph.addPass("Early", RenderGraph::PassType::eGraphics, recordPhase(RenderPhase::eMain), contents);
+        graph.writeColor(mainPass, sceneImage, clearColor);
+        graph.writeDepth(mainPass, depthImage, clearDepth);
+
+        RenderGraph::PassHandle cullPass = graph.addPass(
+            "OcclusionCull", RenderGraph::PassType::eCompute,
+            [this](vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass) {
+                occlusionCuller->buildDepthPyramid(commandBuffer, currentFrameIndex, renderGraph->getImageView(depthImage), renderExtent);
+                occlusionCuller->cullLate(commandBuffer, currentFrameIndex);
+            }
+        );
+        graph.readSampled(cullPass, depthImage, vk::PipelineStageFlagBits::eComputeShader);
+
+        RenderGraph::PassHandle latePass = graph.addPass("Late", RenderGraph::PassType::eGraphics, recordPhase(RenderPhase::eLate), contents);
+        graph.writeColor(latePass, sceneImage);
+        graph.writeDepth(latePass, depthImage);
+    } else {
+        std::optional<vk::ClearDepthStencilValue> forwardClearDepth = clearDepth;
+        if (shadingPath == ShadingPath::eForwardDepthPrepass) {
+            RenderGraph::PassHandle prepass = graph.addPass(
+                "DepthPrepass", RenderGraph::PassType::eGraphics, recordPhase(RenderPhase::eDepthPrepass), contents
+            );
+            graph.writeDepth(prepass, depthImage, clearDepth);
+            forwardClearDepth.reset();
+            mainPass = prepass;
+        }
+        RenderGraph::PassHandle forwardPass = graph.addPass(
+            "Forward", RenderGraph::PassType::eGraphics, recordPhase(RenderPhase::eMain), contents
+        );
+        graph.writeColor(forwardPass, sceneImage, clearColor);
+        graph.writeDepth(forwardPass, depthImage, forwardClearDepth);
+        if (shadingPath == ShadingPath::eForward) {
+            mainPass = forwardPass;
+        }
+    }
+
+    if (sceneScaled) {
+        RenderGraph::PassHandle upscalePass = graph.addPass(
+            "Upscale", RenderGraph::PassType::eTransfer,
+            [this, sceneImage, outputImage](vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass) {
+                recordUpscale(commandBuffer, sceneImage, outputImage);
+            }
+        );
+        graph.readTransfer(upscalePass, sceneImage);
+        graph.writeTransfer(upscalePass, outputImage);
+    }
+    if (offscreenTarget != nullptr) {
+        RenderGraph::PassHandle readbackPass = graph.addPass(
+            "Readback", RenderGraph::PassType::eTransfer,
+            [this](vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass) {
+                if (!readbackFunction) return;
+                offscreenTarget->recordReadback(commandBuffer, currentFrameIndex);
+                readbackFrameNumbers[currentFrameIndex] = graphicsDevice.getFrameNumber();
+            }
+        );
+        graph.readTransfer(readbackPass, outputImage);
+    }
+
+    graph.compile(sceneExtent, previousGraph.get());
+    if (previousGraph != nullptr) {
+        //Pipelines still compiling were created against render passes that are about to be destroyed
+        if (!graph.reusesRenderPasses()) {
+            if (pipelineCompiler != nullptr) pipelineCompiler->waitAll();
+            for (auto& renderSystem : renderSystems) {
+                renderSystem->renderPassChanged(graph.getRenderPass(mainPass));
+            }
+        }
+        graphicsDevice.retire(std::move(previousGraph));
+    }
+
+    if (shadingPath == ShadingPath::eDeferred) {
+        for (int i = static_cast<int>(gBufferBinders.size()); i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+            gBufferBinders.emplace_back(
+                graphicsDevice,
+                std::vector<ResourceBinder::Binding>{
+                    {0, vk::DescriptorType::eInputAttachment, 1},
+                    {1, vk::DescriptorType::eInputAttachment, 1},
+                    {2, vk::DescriptorType::eInputAttachment, 1}
+                }
+            );
+        }
+        gBufferBindersOutdated.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, true);
     }
-    //TODO: check if render pass if compatible in order to not recreate pipleine everytime with swapchain
+}
+
+//Only called once the frame's fence has signaled, so the set can be rewritten in place
+void Renderer::updateGBufferBinder(int frameIndex) {
+    ResourceBinder& gBufferBinder = gBufferBinders[frameIndex];
+    gBufferBinder.setImage(0, renderGraph->getImageView(albedoImage), nullptr, vk::ImageLayout::eShaderReadOnlyOptimal);
+    gBufferBinder.setImage(1, renderGraph->getImageView(normalImage), nullptr, vk::ImageLayout::eShaderReadOnlyOptimal);
+    gBufferBinder.setImage(2, renderGraph->getImageView(depthImage), nullptr, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+    gBufferBindersOutdated[frameIndex] = false;
+}
+
+//The scene image has the output's format, which has to be blittable with a linear filter. Offscreen targets can
+//always be blitted into.
+bool Renderer::canScaleScene() {
+    return timestampQueryPool && (swapChain == nullptr || (swapChain->getImageUsage() & vk::ImageUsageFlagBits::eTransferDst))
+        && graphicsDevice.hasFormatFeatures(
+            getOutputFormat(), vk::ImageTiling::eOptimal,
+            vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear
+        );
 }
 
 void Renderer::createCommandBuffers() {
@@ -41,76 +241,367 @@ void Renderer::createCommandBuffers() {
     commandBuffers = graphicsDevice.getDevice().allocateCommandBuffersUnique(allocInfo);
 }
 
+void Renderer::createTimestampQueries() {
+    const uint32_t validBits = graphicsDevice.getGraphicsTimestampValidBits();
+    if (validBits == 0) return;
+    timestampMask = validBits >= 64 ? ~uint64_t{0} : (uint64_t{1} << validBits) - 1;
+    timestampPeriod = graphicsDevice.getDeviceProperties().limits.timestampPeriod;
+    timestampQueryPool = graphicsDevice.getDevice().createQueryPoolUnique({
+        {}, vk::QueryType::eTimestamp, 2 * SwapChain::MAX_FRAMES_IN_FLIGHT
+    });
+    timestampsWritten.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, false);
+    timestampScales.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, 1.0f);
+}
+
+void Renderer::setOcclusionCuller(std::shared_ptr<OcclusionCuller> occlusionCuller) {
+    assert((occlusionCuller == nullptr || shadingPath == ShadingPath::eForward) && "Occlusion culling needs the forward shading path");
+    assert(!isFrameStarted && "Can't change the occlusion culler while a frame is in progress");
+    //Frames in flight may still be culling with the previous one
+    if (this->occlusionCuller != nullptr) graphicsDevice.retire(std::move(this->occlusionCuller));
+    this->occlusionCuller = occlusionCuller;
+    buildRenderGraph();
+}
+
+void Renderer::setJobSystem(std::shared_ptr<JobSystem> jobSystem) {
+    assert(!isFrameStarted && "Can't change the job system while a frame is in progress");
+    //Secondary command buffers of frames still in flight live in these pools
+    graphicsDevice.retire(std::move(recordingContexts));
+    recordingContexts.clear();
+    this->jobSystem = jobSystem;
+    if (jobSystem != nullptr) createRecordingContexts();
+    //Passes are begun for either inline or secondary command buffer contents
+    buildRenderGraph();
+}
+
+void Renderer::createRecordingContexts() {
+    uint32_t graphicsFamily = graphicsDevice.getQueueFamilyIndices().graphicsFamily.value();
+    recordingContexts.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (auto& frameContexts : recordingContexts) {
+        frameContexts.resize(jobSystem->getWorkerCount());
+        for (auto& context : frameContexts) {
+            context.commandPool = graphicsDevice.getDevice().createCommandPoolUnique({
+                vk::CommandPoolCreateFlagBits::eTransient, graphicsFamily
+            });
+        }
+    }
+}
+
+void Renderer::setPresentationSettings(const PresentationSettings& presentationSettings) {
+    assert(!isFrameStarted && "Can't change presentation settings while a frame is in progress");
+    assert(presentationSettings.framesInFlight >= 1 && presentationSettings.framesInFlight <= static_cast<uint32_t>(SwapChain::MAX_FRAMES_IN_FLIGHT)
+        && "Unsupported number of frames in flight");
+    //Frame indices that are no longer used still have to hand over their readbacks
+    if (offscreenTarget != nullptr) finishFrames();
+    this->presentationSettings = presentationSettings;
+    currentFrameIndex %= presentationSettings.framesInFlight;
+    nextFrameTime = {};
+    if (swapChain != nullptr) recreateSwapChain();
+}
+
+void Renderer::setReadbackFunction(std::function<void(const FrameReadback&)> readbackFunction) {
+    assert(offscreenTarget != nullptr && "Only headless frames can be read back");
+    assert(!isFrameStarted && "Can't change the readback function while a frame is in progress");
+    this->readbackFunction = std::move(readbackFunction);
+}
+
+//Oldest first, the current frame index is the next to be reused
+void Renderer::finishFrames() {
+    assert(!isFrameStarted && "Can't finish frames while a frame is in progress");
+    for (uint32_t i = 0; i < presentationSettings.framesInFlight; i++) {
+        const int frameIndex = static_cast<int>((currentFrameIndex + i) % presentationSettings.framesInFlight);
+        graphicsDevice.waitForFrame(frameIndex);
+        readGpuFrameTime(frameIndex);
+        if (offscreenTarget != nullptr) deliverReadback(frameIndex);
+    }
+}
+
+//Only called once the frame's fence has signaled
+void Renderer::deliverReadback(int frameIndex) {
+    if (readbackFrameNumbers[frameIndex] == 0) return;
+    const FrameReadback readback{
+        readbackFrameNumbers[frameIndex], offscreenTarget->getExtent(), offscreenTarget->getImageFormat(),
+        offscreenTarget->getReadbackData(frameIndex)
+    };
+    readbackFrameNumbers[frameIndex] = 0;
+    if (readbackFunction) readbackFunction(readback);
+}
+
+void Renderer::setDynamicResolutionSettings(const DynamicResolutionSettings& dynamicResolutionSettings) {
+    assert(!isFrameStarted && "Can't change dynamic resolution settings while a frame is in progress");
+    assert(dynamicResolutionSettings.minScale > 0.0f && dynamicResolutionSettings.minScale <= dynamicResolutionSettings.maxScale
+        && dynamicResolutionSettings.maxScale <= 1.0f && "Resolution scale bounds must satisfy 0 < minScale <= maxScale <= 1");
+    assert(dynamicResolutionSettings.targetGpuTime > 0.0f && "Target gpu time must be positive");
+    this->dynamicResolutionSettings = dynamicResolutionSettings;
+    resolutionScale = dynamicResolutionSettings.maxScale;
+    buildRenderGraph();
+}
+
+//Present wait holds the cpu back until the display has caught up, then the limiter spaces frames out evenly.
+//A frame that started late isn't made up for, the next one is simply a full frame later.
+void Renderer::paceFrame() {
+    if (framePaced) return;
+    framePaced = true;
+    if (swapChain != nullptr) swapChain->waitForQueuedPresents();
+    if (presentationSettings.maxFrameRate <= 0.0f) return;
+
+    const auto frameDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / presentationSettings.maxFrameRate)
+    );
+    const auto now = std::chrono::steady_clock::now();
+    if (now < nextFrameTime) {
+        std::this_thread::sleep_until(nextFrameTime);
+        nextFrameTime += frameDuration;
+    } else {
+        nextFrameTime = now + frameDuration;
+    }
+}
+
 void Renderer::drawFrame() {
     //assert(renderSystems != nullptr && "A RenderSystem must be set before attempting to draw frames.");
 
+    paceFrame();
+    framePaced = false;
     if (beginFrame()) {
-        beginSwapChainRenderPass();
+        vk::CommandBuffer commandBuffer = *commandBuffers[currentFrameIndex];
         for (auto& renderSystem : renderSystems) {
-            renderSystem->render(*commandBuffers[currentFrameIndex], currentFrameIndex);
+            renderSystem->prepare(commandBuffer, currentFrameIndex);
         }
-        endSwapChainRenderPass();
+        renderGraph->execute(commandBuffer, currentImageIndex, renderExtent);
         endFrame();
     }
 }
 
-bool Renderer::beginFrame() {
-    vk::ResultValue<uint32_t> result = swapChain->acquireNextImage();
-    currentImageIndex = result.value;
-    if (result.result == vk::Result::eErrorOutOfDateKHR) {
-        recreateSwapChain();
-        return false;
-    } else if (result.result != vk::Result::eSuccess && result.result != vk::Result::eSuboptimalKHR) {
-        throw std::runtime_error("Failed to acquire swapchain image");
+//Inline passes are recorded straight into the frame's command buffer, otherwise every chunk gets its own secondary one
+void Renderer::recordRenderSystems(vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass, RenderPhase phase) {
+    if (renderGraph->getSubpassContents(pass) == vk::SubpassContents::eInline) {
+        setViewportAndScissor(commandBuffer);
+        for (auto& renderSystem : renderSystems) {
+            recordRenderSystem(*renderSystem, commandBuffer, phase, 0, 0);
+        }
+        return;
     }
-    isFrameStarted = true;
-    commandBuffers[currentFrameIndex]->begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
-    return true;
-}
+    struct Chunk {
+        RenderSystem* renderSystem;
+        uint32_t index;
+        uint32_t count;
+    };
+    std::vector<Chunk> chunks;
+    for (auto& renderSystem : renderSystems) {
+        uint32_t chunkCount = renderSystem->getChunkCount(currentFrameIndex);
+        for (uint32_t i = 0; i < chunkCount; i++) {
+            chunks.push_back({renderSystem.get(), i, chunkCount});
+        }
+    }
 
-void Renderer::beginSwapChainRenderPass() {
-    vk::Extent2D swapChainExtent = swapChain->getExtent();
+    //Secondary buffers are executed in chunk order, so the draw order matches serial recording
+    std::vector<vk::CommandBuffer> secondaryCommandBuffers(chunks.size());
+    jobSystem->parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkIndex, uint32_t workerIndex) {
+        const Chunk& chunk = chunks[chunkIndex];
+        vk::CommandBuffer secondaryCommandBuffer = beginSecondaryCommandBuffer(pass, workerIndex);
+        recordRenderSystem(*chunk.renderSystem, secondaryCommandBuffer, phase, chunk.index, chunk.count);
+        secondaryCommandBuffer.end();
+        secondaryCommandBuffers[chunkIndex] = secondaryCommandBuffer;
+    }, 1, "RecordRenderChunk");
 
-    vk::RenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.renderPass = swapChain->getRenderPass();
-    renderPassInfo.framebuffer = swapChain->getFrameBuffer(currentImageIndex);
-    renderPassInfo.renderArea = vk::Rect2D{{0, 0}, swapChainExtent};
-    
-    std::array<vk::ClearValue, 2> clearValues{};
-    clearValues[0].color = vk::ClearColorValue{std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}};
-    clearValues[1].depthStencil = vk::ClearDepthStencilValue{1.0f, 0};
-    renderPassInfo.setClearValues(clearValues);
+    if (!secondaryCommandBuffers.empty()) {
+        commandBuffer.executeCommands(secondaryCommandBuffers);
+    }
+}
+
+//A chunk count of 0 records the whole system at once
+void Renderer::recordRenderSystem(
+    RenderSystem& renderSystem, vk::CommandBuffer commandBuffer, RenderPhase phase, uint32_t chunkIndex, uint32_t chunkCount) {
+    switch (phase) {
+        case RenderPhase::eDepthPrepass:
+            if (chunkCount == 0) {
+                renderSystem.renderDepthPrepass(commandBuffer, currentFrameIndex);
+            } else {
+                renderSystem.renderDepthPrepassChunk(commandBuffer, currentFrameIndex, chunkIndex, chunkCount);
+            }
+            break;
+        case RenderPhase::eMain:
+            if (chunkCount == 0) {
+                renderSystem.render(commandBuffer, currentFrameIndex);
+            } else {
+                renderSystem.renderChunk(commandBuffer, currentFrameIndex, chunkIndex, chunkCount);
+            }
+            break;
+        case RenderPhase::eLate:
+            if (chunkCount == 0) {
+                renderSystem.renderLate(commandBuffer, currentFrameIndex);
+            } else {
+                renderSystem.renderLateChunk(commandBuffer, currentFrameIndex, chunkIndex, chunkCount);
+            }
+            break;
+    }
+}
 
-    commandBuffers[currentFrameIndex]->beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+vk::CommandBuffer Renderer::beginSecondaryCommandBuffer(RenderGraph::PassHandle pass, uint32_t workerIndex) {
+    RecordingContext& context = recordingContexts[currentFrameIndex][workerIndex];
+    if (context.usedCount == context.commandBuffers.size()) {
+        auto allocated = graphicsDevice.getDevice().allocateCommandBuffersUnique({
+            *context.commandPool, vk::CommandBufferLevel::eSecondary, 1
+        });
+        context.commandBuffers.push_back(std::move(allocated[0]));
+    }
+    vk::CommandBuffer commandBuffer = *context.commandBuffers[context.usedCount++];
 
-    vk::Viewport viewport{
-        0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f
+    vk::CommandBufferInheritanceInfo inheritanceInfo{
+        renderGraph->getRenderPass(pass), renderGraph->getSubpass(pass), renderGraph->getFramebuffer(pass, currentImageIndex)
     };
-    vk::Rect2D scissor{{0, 0}, swapChainExtent};
+    commandBuffer.begin({
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        &inheritanceInfo
+    });
+    //Dynamic state isn't inherited from the primary command buffer
+    setViewportAndScissor(commandBuffer);
+    return commandBuffer;
+}
+
+void Renderer::recordLighting(vk::CommandBuffer commandBuffer) {
+    //Dynamic state set by the G-buffer subpass's secondary command buffers doesn't carry over
+    setViewportAndScissor(commandBuffer);
+    for (auto& renderSystem : renderSystems) {
+        renderSystem->renderLighting(commandBuffer, currentFrameIndex, gBufferBinders[currentFrameIndex]);
+    }
+}
 
-    commandBuffers[currentFrameIndex]->setViewport(0, viewport);
-    commandBuffers[currentFrameIndex]->setScissor(0, scissor);
+//The source is stretched over the whole swap chain image
+void Renderer::recordUpscale(vk::CommandBuffer commandBuffer, RenderGraph::ResourceHandle sceneImage, RenderGraph::ResourceHandle outputImage) {
+    const vk::Extent2D outputExtent = getOutputExtent();
+    vk::ImageBlit region{};
+    region.srcSubresource = vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+    region.srcOffsets[1] = vk::Offset3D{static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+    region.dstSubresource = vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+    region.dstOffsets[1] = vk::Offset3D{static_cast<int32_t>(outputExtent.width), static_cast<int32_t>(outputExtent.height), 1};
+    commandBuffer.blitImage(
+        renderGraph->getImage(sceneImage, currentImageIndex), vk::ImageLayout::eTransferSrcOptimal,
+        renderGraph->getImage(outputImage, currentImageIndex), vk::ImageLayout::eTransferDstOptimal,
+        region, vk::Filter::eLinear
+    );
 }
 
-void Renderer::endSwapChainRenderPass() {
-    commandBuffers[currentFrameIndex]->endRenderPass();
+//Only called once the frame's fence has signaled, so both of its timestamps are available
+void Renderer::readGpuFrameTime(int frameIndex) {
+    if (!timestampQueryPool || !timestampsWritten[frameIndex]) return;
+    timestampsWritten[frameIndex] = false;
+    vk::ResultValue<std::vector<uint64_t>> timestamps = graphicsDevice.getDevice().getQueryPoolResults<uint64_t>(
+        *timestampQueryPool, 2 * frameIndex, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64
+    );
+    if (timestamps.result != vk::Result::eSuccess) return;
+
+    const uint64_t ticks = (timestamps.value[1] - timestamps.value[0]) & timestampMask;
+    const float frameTime = static_cast<float>(ticks) * timestampPeriod / 1'000'000.0f;
+    gpuFrameTime = gpuFrameTime == 0.0f ? frameTime : gpuFrameTime + (frameTime - gpuFrameTime) * GPU_FRAME_TIME_SMOOTHING;
+    const float frameScale = timestampScales[frameIndex];
+    const float frameFullScaleTime = frameTime / (frameScale * frameScale);
+    fullScaleGpuTime = fullScaleGpuTime == 0.0f
+        ? frameFullScaleTime
+        : fullScaleGpuTime + (frameFullScaleTime - fullScaleGpuTime) * GPU_FRAME_TIME_SMOOTHING;
+    updateResolutionScale();
+}
+
+//Gpu time grows about linearly with the pixel count, which grows with the square of the scale. Any part of the time
+//that doesn't scale makes a single step fall short, the following frames make up for the rest.
+void Renderer::updateResolutionScale() {
+    if (!sceneScaled || fullScaleGpuTime <= 0.0f) return;
+    const float targetScale = std::sqrt(dynamicResolutionSettings.targetGpuTime / fullScaleGpuTime);
+    float scale = resolutionScale + (targetScale - resolutionScale) * RESOLUTION_SCALE_RATE;
+    scale = std::round(scale / RESOLUTION_SCALE_STEP) * RESOLUTION_SCALE_STEP;
+    resolutionScale = std::clamp(scale, dynamicResolutionSettings.minScale, dynamicResolutionSettings.maxScale);
+}
+
+bool Renderer::beginFrame() {
+    if (swapChainOutOfDate && !recreateSwapChain()) return false;
+    graphicsDevice.waitForFrame(currentFrameIndex);
+    readGpuFrameTime(currentFrameIndex);
+    if (offscreenTarget != nullptr) {
+        deliverReadback(currentFrameIndex);
+        currentImageIndex = static_cast<uint32_t>(currentFrameIndex);
+    } else {
+        vk::ResultValue<uint32_t> result = swapChain->acquireNextImage(currentFrameIndex);
+        currentImageIndex = result.value;
+        if (result.result == vk::Result::eErrorOutOfDateKHR) {
+            recreateSwapChain();
+            return false;
+        } else if (result.result != vk::Result::eSuccess && result.result != vk::Result::eSuboptimalKHR) {
+            throw std::runtime_error("Failed to acquire swapchain image");
+        }
+    }
+    isFrameStarted = true;
+    vk::CommandBuffer commandBuffer = *commandBuffers[currentFrameIndex];
+    commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    if (timestampQueryPool) {
+        commandBuffer.resetQueryPool(*timestampQueryPool, 2 * currentFrameIndex, 2);
+        //The acquire semaphore is waited on at color attachment output, so a timestamp at that stage starts the span
+        //once the image is ready instead of counting the wait for the display
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eColorAttachmentOutput, *timestampQueryPool, 2 * currentFrameIndex);
+    }
+
+    const vk::Extent2D sceneExtent = renderGraph->getExtent();
+    renderExtent = sceneExtent;
+    if (sceneScaled) {
+        const vk::Extent2D outputExtent = getOutputExtent();
+        renderExtent.width = std::clamp(static_cast<uint32_t>(std::lround(outputExtent.width * resolutionScale)), 1u, sceneExtent.width);
+        renderExtent.height = std::clamp(static_cast<uint32_t>(std::lround(outputExtent.height * resolutionScale)), 1u, sceneExtent.height);
+    }
+    if (timestampQueryPool) timestampScales[currentFrameIndex] = sceneScaled ? resolutionScale : 1.0f;
+
+    //The frame's fence was waited on before acquiring, so neither its G-buffer set nor its secondary command buffers
+    //are in use anymore
+    if (shadingPath == ShadingPath::eDeferred && gBufferBindersOutdated[currentFrameIndex]) {
+        updateGBufferBinder(currentFrameIndex);
+    }
+    if (!recordingContexts.empty()) {
+        for (auto& context : recordingContexts[currentFrameIndex]) {
+            graphicsDevice.getDevice().resetCommandPool(*context.commandPool);
+            context.usedCount = 0;
+        }
+    }
+
+    return true;
+}
+
+void Renderer::setViewportAndScissor(vk::CommandBuffer commandBuffer) {
+    vk::Viewport viewport{
+        0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f
+    };
+    vk::Rect2D scissor{{0, 0}, renderExtent};
+
+    commandBuffer.setViewport(0, viewport);
+    commandBuffer.setScissor(0, scissor);
 }
 
 void Renderer::endFrame() {
+    if (timestampQueryPool) {
+        commandBuffers[currentFrameIndex]->writeTimestamp(
+            vk::PipelineStageFlagBits::eBottomOfPipe, *timestampQueryPool, 2 * currentFrameIndex + 1
+        );
+        timestampsWritten[currentFrameIndex] = true;
+    }
     commandBuffers[currentFrameIndex]->end();
 
-    swapChain->submitDrawCommands(*commandBuffers[currentFrameIndex]);
+    //Nothing to wait for or present when headless
+    if (offscreenTarget != nullptr) {
+        vk::CommandBuffer commandBuffer = *commandBuffers[currentFrameIndex];
+        vk::SubmitInfo submitInfo{};
+        submitInfo.setCommandBuffers(commandBuffer);
+        graphicsDevice.submitFrame(currentFrameIndex, submitInfo);
+        isFrameStarted = false;
+        currentFrameIndex = (currentFrameIndex + 1) % presentationSettings.framesInFlight;
+        return;
+    }
+    swapChain->submitDrawCommands(*commandBuffers[currentFrameIndex], currentFrameIndex);
 
-    vk::Result result = swapChain->presentImage(currentImageIndex);
-    if ( result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || window.wasFramebufferResized()) {
-        window.resetFramebufferResizedFlag();
+    vk::Result result = swapChain->presentImage(currentImageIndex, currentFrameIndex);
+    isFrameStarted = false;
+    currentFrameIndex = (currentFrameIndex + 1) % presentationSettings.framesInFlight;
+    if ( result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || window->wasFramebufferResized()) {
+        window->resetFramebufferResizedFlag();
         recreateSwapChain();
     } else if ( result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to present swap chain image!");
     }
-
-    isFrameStarted = false;
-    currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 }
\ No newline at end of file
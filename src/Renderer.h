@@ -1,50 +1,196 @@
 #pragma once
 
 #include "RenderSystem.h"
+#include "ResourceBinder.h"
 #include "Window.h"
 #include "GraphicsDevice.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "OffscreenTarget.h"
+#include "PipelineCompiler.h"
+#include "RenderGraph.h"
 #include "SwapChain.h"
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
 #include <cassert>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <vector>
 
 namespace rkrai {
+//Renders the scene into an offscreen target at a fraction of the swap chain's resolution, which follows the measured
+//gpu time per frame, and upscales it into the swap chain with a linear filter. Without timestamp queries or swap chain
+//images that can be blitted into, the scene is rendered straight into the swap chain as if it were disabled.
+struct DynamicResolutionSettings {
+    bool enabled = false;
+    //Bounds of the scale applied to both dimensions, the scene target is allocated for maxScale
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    //Gpu time per frame the scale is adjusted towards, in milliseconds
+    float targetGpuTime = 16.0f;
+};
+
 class Renderer {
 public:
-    Renderer(Window& window, GraphicsDevice& device);
+    Renderer(
+        Window& window, GraphicsDevice& device, ShadingPath shadingPath = ShadingPath::eForward,
+        const PresentationSettings& presentationSettings = {});
+    //Headless, draws into an OffscreenTarget of the given size instead of a swap chain. Of the presentation settings
+    //only the frames in flight and the frame limiter apply.
+    Renderer(
+        GraphicsDevice& device, vk::Extent2D extent, ShadingPath shadingPath = ShadingPath::eForward,
+        const PresentationSettings& presentationSettings = {});
     Renderer(const Renderer&) = delete;
     void operator=(const Renderer&) = delete;
 
     void addRenderSystem(std::shared_ptr<RenderSystem> renderSystem) { this->renderSystems.push_back(renderSystem); }
+    //Splits the frame into an early and late render pass with the culler's depth pyramid built in between.
+    //Only supported with forward shading.
+    void setOcclusionCuller(std::shared_ptr<OcclusionCuller> occlusionCuller);
+    //Records render system chunks into secondary command buffers as jobs, nullptr records serially
+    void setJobSystem(std::shared_ptr<JobSystem> jobSystem);
+    //Render systems' pipelines are compiled against the render graph's render passes, which aren't rebuilt
+    //until the compiler has finished with them
+    void setPipelineCompiler(std::shared_ptr<PipelineCompiler> pipelineCompiler) { this->pipelineCompiler = pipelineCompiler; }
+    //Recreates the swap chain, pipelines stay valid
+    void setPresentationSettings(const PresentationSettings& presentationSettings);
+    //Rebuilds the render graph, starting out at the maximum scale
+    void setDynamicResolutionSettings(const DynamicResolutionSettings& dynamicResolutionSettings);
+    //Holds the next frame back for the frame limiter and present wait. Called by drawFrame unless it already was
+    //this frame, apps get the least latency by calling it themselves right before reading input.
+    void paceFrame();
     void drawFrame();
+    //Headless only. Frames drawn while a function is set are copied into host memory and handed to it, on the render
+    //thread, once they have finished on the gpu. That's a few frames later or in finishFrames.
+    void setReadbackFunction(std::function<void(const FrameReadback&)> readbackFunction);
+    //Waits for every frame in flight and hands over their readbacks, for instance before reading the last frame drawn
+    void finishFrames();
 
-    vk::RenderPass getSwapChainRenderPass() const { return swapChain->getRenderPass(); }
-    float getAspectRatio() const { return swapChain->getAspectRatio(); }
+    //Every render pass the graph is compiled into is compatible with this one, pipelines can be created for any of them
+    vk::RenderPass getSwapChainRenderPass() const { return renderGraph->getRenderPass(mainPass); }
+    ShadingPath getShadingPath() const { return shadingPath; }
+    const PresentationSettings& getPresentationSettings() const { return presentationSettings; }
+    //eImmediate when headless, nothing waits for a display then
+    vk::PresentModeKHR getPresentMode() const {
+        return swapChain != nullptr ? swapChain->getPresentMode() : vk::PresentModeKHR::eImmediate;
+    }
+    bool isHeadless() const { return offscreenTarget != nullptr; }
+    const DynamicResolutionSettings& getDynamicResolutionSettings() const { return dynamicResolutionSettings; }
+    //1 unless dynamic resolution is in use
+    float getResolutionScale() const { return resolutionScale; }
+    //Smoothed over the last frames and lagging behind by the frames in flight, 0 without timestamp queries
+    float getGpuFrameTime() const { return gpuFrameTime; }
+    //Layout of the set passed to RenderSystem::renderLighting for building lighting pipeline layouts, nullptr with forward shading.
+    //Every frame in flight has its own set, all of them with this layout.
+    vk::DescriptorSetLayout getGBufferSetLayout() {
+        return gBufferBinders.empty() ? vk::DescriptorSetLayout{} : gBufferBinders[0].getSetLayout();
+    }
+    float getAspectRatio() const { return swapChain != nullptr ? swapChain->getAspectRatio() : offscreenTarget->getAspectRatio(); }
     bool isFrameInProgress() const { return isFrameStarted; }
 
 private:
+    enum class RenderPhase {
+        eDepthPrepass,
+        eMain,
+        eLate
+    };
+
+    //Each recording thread gets its own command pool per frame in flight, reset once its frame's fence has signaled
+    struct RecordingContext {
+        vk::UniqueCommandPool commandPool;
+        std::vector<vk::UniqueCommandBuffer> commandBuffers;
+        uint32_t usedCount = 0;
+    };
+
     void createCommandBuffers();
+    void createRecordingContexts();
+    void createTimestampQueries();
     void freeCommandBuffers();
-    void recreateSwapChain();
+    bool recreateSwapChain();
+    void buildRenderGraph();
+    void updateGBufferBinder(int frameIndex);
+    void deliverReadback(int frameIndex);
+    vk::Extent2D getOutputExtent() const { return swapChain != nullptr ? swapChain->getExtent() : offscreenTarget->getExtent(); }
+    vk::Format getOutputFormat() const { return swapChain != nullptr ? swapChain->getImageFormat() : offscreenTarget->getImageFormat(); }
+    bool canScaleScene();
+    void readGpuFrameTime(int frameIndex);
+    void updateResolutionScale();
 
     bool beginFrame();
     void endFrame();
-    void beginSwapChainRenderPass();
-    void endSwapChainRenderPass();
+    void setViewportAndScissor(vk::CommandBuffer commandBuffer);
+    void recordRenderSystems(vk::CommandBuffer commandBuffer, RenderGraph::PassHandle pass, RenderPhase phase);
+    void recordRenderSystem(RenderSystem& renderSystem, vk::CommandBuffer commandBuffer, RenderPhase phase, uint32_t chunkIndex, uint32_t chunkCount);
+    void recordLighting(vk::CommandBuffer commandBuffer);
+    void recordUpscale(vk::CommandBuffer commandBuffer, RenderGraph::ResourceHandle sceneImage, RenderGraph::ResourceHandle outputImage);
+    vk::CommandBuffer beginSecondaryCommandBuffer(RenderGraph::PassHandle pass, uint32_t workerIndex);
 
-    Window& window;
+    //nullptr when headless
+    Window* window = nullptr;
     GraphicsDevice& graphicsDevice;
+    ShadingPath shadingPath;
+    PresentationSettings presentationSettings;
+    bool framePaced = false;
+    std::chrono::steady_clock::time_point nextFrameTime{};
 
+    //The scale moves this part of the way towards the one that would meet the target each frame, in steps of
+    //RESOLUTION_SCALE_STEP so that the resolution doesn't follow every bit of noise in the measurements
+    static constexpr float RESOLUTION_SCALE_RATE = 0.5f;
+    static constexpr float RESOLUTION_SCALE_STEP = 0.05f;
+    //Weight of the newest measurement in the smoothed gpu frame time
+    static constexpr float GPU_FRAME_TIME_SMOOTHING = 0.1f;
+    DynamicResolutionSettings dynamicResolutionSettings;
+    //Whether the current graph renders into a scene image that is upscaled into the swap chain
+    bool sceneScaled = false;
+    float resolutionScale = 1.0f;
+    //The part of the graph's images the current frame draws into, from the top left corner
+    vk::Extent2D renderExtent{0, 0};
+    //Written at the start and end of every frame's command buffer, two per frame in flight
+    vk::UniqueQueryPool timestampQueryPool;
+    std::vector<bool> timestampsWritten;
+    //The scale each frame in flight was drawn at, its measured time only says something about that scale
+    std::vector<float> timestampScales;
+    uint64_t timestampMask = 0;
+    float timestampPeriod = 0.0f;
+    float gpuFrameTime = 0.0f;
+    //Frame times divided by the squared scale they were drawn at and smoothed like gpuFrameTime, what a frame would
+    //take at full scale. Unlike the plain average it doesn't lag behind changes of the scale.
+    float fullScaleGpuTime = 0.0f;
+
+    //Exactly one of the two is set
     std::unique_ptr<SwapChain> swapChain;
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    //Set while the window is minimized, nothing is drawn until the swap chain could be recreated
+    bool swapChainOutOfDate = false;
+    std::function<void(const FrameReadback&)> readbackFunction;
+    //The number of the frame whose readback each frame index recorded, 0 if it recorded none
+    std::vector<uint64_t> readbackFrameNumbers;
+    std::unique_ptr<RenderGraph> renderGraph;
+    //The first pass render systems draw in, its render pass is the one pipelines get created for
+    RenderGraph::PassHandle mainPass = 0;
+    RenderGraph::ResourceHandle depthImage = 0;
+    RenderGraph::ResourceHandle albedoImage = 0;
+    RenderGraph::ResourceHandle normalImage = 0;
     std::vector<vk::UniqueCommandBuffer> commandBuffers;
+    //Swap chain image, or the frame index when headless
     uint32_t currentImageIndex = 0;
+    //Cycles through PresentationSettings::framesInFlight, the frame fences belong to the GraphicsDevice
     int currentFrameIndex = 0;
     bool isFrameStarted = false;
 
     std::vector<std::shared_ptr<RenderSystem>> renderSystems;
+    std::shared_ptr<OcclusionCuller> occlusionCuller;
+    std::shared_ptr<PipelineCompiler> pipelineCompiler;
+
+    std::shared_ptr<JobSystem> jobSystem;
+    std::vector<std::vector<RecordingContext>> recordingContexts;
+
+    //Kept across render graph rebuilds so render systems' pipeline layouts stay valid. One per frame in flight, so
+    //a rebuilt graph's images can be written into each once its frame has finished instead of waiting for the device.
+    std::vector<ResourceBinder> gBufferBinders;
+    std::vector<bool> gBufferBindersOutdated;
 };
 }
\ No newline at end of file
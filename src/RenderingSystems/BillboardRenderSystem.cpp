@@ -9,29 +9,28 @@
 #include <vulkan/vulkan.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <algorithm>
 #include <optional>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 namespace rkrai {
-struct BillboardPushConstantData {
-    glm::vec4 billboardColor{1.0f}; //w is intensity
-    glm::vec2 billboardDimensions{0.1f};
-    alignas(16) glm::vec3 billboardPosition{0.0f};
-};
-
 struct BillboardUbo {
     glm::mat4 projMat{1.0f};
     glm::mat4 viewMat{1.0f};
 };
 
-BillboardRenderSystem::BillboardRenderSystem(GraphicsDevice& device, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera)
-    : graphicsDevice(device), renderPass(renderPass), camera(camera) {
+BillboardRenderSystem::BillboardRenderSystem(
+    GraphicsDevice& device, PipelineCompiler& pipelineCompiler, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera,
+    std::shared_ptr<World> world, std::shared_ptr<const SceneGraph> sceneGraph, ShadingPath shadingPath)
+    : graphicsDevice(device), pipelineCompiler(pipelineCompiler), renderPass(renderPass), shadingPath(shadingPath), world(world), camera(camera),
+    sceneGraph(sceneGraph), instanceBuffers(device, sizeof(Instance), vk::BufferUsageFlagBits::eStorageBuffer) {
     createUboBuffers();
     createResourceBinder();
     createPipelineLayout();
     createPipeline();
+    instanceBuffers.ensureCapacity(INITIAL_INSTANCE_CAPACITY);
 }
 
 void BillboardRenderSystem::createUboBuffers() {
@@ -49,57 +48,79 @@ void BillboardRenderSystem::createResourceBinder() {
     for (int i = 0; i < uboBuffers.size(); i++) {
         resourceBinder.emplace_back(
             graphicsDevice,
-            std::vector<ResourceBinder::Binding>{ {0, vk::DescriptorType::eUniformBuffer, 1} }
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eUniformBuffer, 1},
+                {1, vk::DescriptorType::eStorageBuffer, 1}
+            }
         );
         resourceBinder[i].setBuffer(0, &uboBuffers[i]);
     }
 }
 
 void BillboardRenderSystem::createPipelineLayout() {
-    vk::PushConstantRange pushConstantRange{
-        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
-        0,
-        sizeof(BillboardPushConstantData)
-    };
     vk::DescriptorSetLayout descriptorSetLayout = resourceBinder[0].getSetLayout();
-    pipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, descriptorSetLayout, pushConstantRange});
+    pipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, descriptorSetLayout});
 }
 
 void BillboardRenderSystem::createPipeline() {
     PipelineConfigInfo pipelineConfig = GraphicsPipeline::getDefaultPipelineConfigInfo();
     pipelineConfig.renderPass = renderPass;
     pipelineConfig.pipelineLayout = *pipelineLayout;
-    graphicsPipeline.emplace(
-        graphicsDevice,
+    pipelineConfig.subpass = SwapChain::getForwardSubpass(shadingPath);
+    if (shadingPath == ShadingPath::eDeferred) {
+        //The lighting subpass only has read access to depth
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    }
+    graphicsPipeline = pipelineCompiler.compile(
         "shaders/BillboardShader.vert.spv",
         "shaders/BillboardShader.frag.spv",
         pipelineConfig
     );
 }
 
-void BillboardRenderSystem::render(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+//Every entity with a billboard becomes an instance of a single draw, read by the vertex shader through gl_InstanceIndex
+void BillboardRenderSystem::prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
     BillboardUbo billboardUbo{
         .projMat = camera->getProjection(),
         .viewMat = camera->getView()
     };
     uboBuffers[currentFrameIndex].mapData(&billboardUbo);
 
-    graphicsPipeline->bind(commandBuffer);
-    resourceBinder[currentFrameIndex].bind(commandBuffer, *pipelineLayout, 0);
+    instances.clear();
+    world->query<const SceneNodeComponent, const BillboardComponent>().each(
+        [&](Entity, const SceneNodeComponent& sceneNode, const BillboardComponent& billboard) {
+            instances.push_back({
+                .position = glm::vec4{sceneGraph->getWorldPosition(sceneNode.node), 1.0f},
+                .color = billboard.color,
+                .dimensions = glm::vec4{billboard.dimensions, 0.0f, 0.0f}
+            });
+        }
+    );
+    instanceBuffers.ensureCapacity(static_cast<uint32_t>(instances.size()));
+    //This frame's fence has signaled, so its set is no longer in use
+    if (instanceBuffers.isOutdated(currentFrameIndex)) {
+        resourceBinder[currentFrameIndex].setBuffer(1, &instanceBuffers[currentFrameIndex]);
+        instanceBuffers.setUpToDate(currentFrameIndex);
+    }
+    if (!instances.empty()) {
+        instanceBuffers[currentFrameIndex].writeData(instances.data(), instances.size() * sizeof(Instance));
+    }
+}
 
-    for (const auto& gameObject : gameObjects) {
-        BillboardPushConstantData push{
-            .billboardColor = gameObject->billboard->color,
-            .billboardDimensions = gameObject->billboard->dimensions,
-            .billboardPosition = gameObject->transform.translation
-        };
+void BillboardRenderSystem::render(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (shadingPath == ShadingPath::eDeferred) return;
+    recordDraws(commandBuffer, currentFrameIndex);
+}
 
-        commandBuffer.pushConstants(
-            *pipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
-            0, sizeof(BillboardPushConstantData), &push
-        );
+void BillboardRenderSystem::renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder) {
+    if (shadingPath != ShadingPath::eDeferred) return;
+    recordDraws(commandBuffer, currentFrameIndex);
+}
 
-        commandBuffer.draw(6, 1, 0, 0);
-    }
+void BillboardRenderSystem::recordDraws(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (instances.empty() || !graphicsPipeline.isReady()) return;
+    graphicsPipeline->bind(commandBuffer);
+    resourceBinder[currentFrameIndex].bind(commandBuffer, *pipelineLayout, 0);
+    commandBuffer.draw(6, static_cast<uint32_t>(instances.size()), 0, 0);
 }
 }
\ No newline at end of file
@@ -3,44 +3,68 @@
 #include "Camera.h"
 #include "GraphicsDevice.h"
 #include "GraphicsPipeline.h"
-#include "GameObject.h"
+#include "PerFrameBuffers.h"
+#include "Components.h"
+#include "PipelineCompiler.h"
 #include "RenderSystem.h"
 #include "ResourceBinder.h"
+#include "SwapChain.h"
+#include "World.h"
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
 #include <memory>
 #include <optional>
 #include <vector>
 
 namespace rkrai {
+//Draws every entity with a SceneNodeComponent and a BillboardComponent as a camera facing quad
 class BillboardRenderSystem : public RenderSystem {
 public:
-    BillboardRenderSystem(GraphicsDevice& device, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera);
+    static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 256;
+
+    //With deferred shading billboards are drawn unlit on top of the lit image in the lighting subpass
+    BillboardRenderSystem(
+        GraphicsDevice& device, PipelineCompiler& pipelineCompiler, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera,
+        std::shared_ptr<World> world, std::shared_ptr<const SceneGraph> sceneGraph, ShadingPath shadingPath = ShadingPath::eForward);
     BillboardRenderSystem(const BillboardRenderSystem&) = delete;
     void operator=(const BillboardRenderSystem&) = delete;
 
-    void addGameObject(std::shared_ptr<const GameObject> gameObject) { gameObjects.push_back(gameObject); }
-    void removeGameObject();
     void setCamera(std::shared_ptr<const Camera> camera) { this->camera = camera; }
     GraphicsPipeline& getPipeline() { return *graphicsPipeline; }
 
 private:
+    //Must match BillboardShader.vert
+    struct Instance {
+        glm::vec4 position{0.0f};
+        glm::vec4 color{1.0f}; //w is intensity
+        glm::vec4 dimensions{0.1f}; //zw are unused
+    };
+
     void createUboBuffers();
     void createResourceBinder();
     void createPipelineLayout();
     void createPipeline();
+    void prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex);
     void render(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder);
+    void recordDraws(vk::CommandBuffer commandBuffer, int currentFrameIndex);
 
     GraphicsDevice& graphicsDevice;
+    PipelineCompiler& pipelineCompiler;
     vk::RenderPass renderPass;
+    ShadingPath shadingPath;
 
-    std::vector<std::shared_ptr<const GameObject>> gameObjects;
+    std::shared_ptr<World> world;
     std::shared_ptr<const Camera> camera;
+    std::shared_ptr<const SceneGraph> sceneGraph;
     
     std::vector<GraphicsBuffer> uboBuffers;
+    std::vector<Instance> instances;
+    PerFrameBuffers instanceBuffers;
     std::vector<ResourceBinder> resourceBinder;
     vk::UniquePipelineLayout pipelineLayout;
-    std::optional<GraphicsPipeline> graphicsPipeline;
+    PipelineHandle<GraphicsPipeline> graphicsPipeline;
 };
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "DefaultRenderSystem.h"
+#include "ComputePipeline.h"
 #include "GraphicsPipeline.h"
 #include "Model.h"
 #include "ResourceBinder.h"
@@ -12,6 +13,11 @@
 #include <glm/glm.hpp>
 #include <glm/fwd.hpp>
 #include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
 #include <optional>
 
 #define GLM_FORCE_RADIANS
@@ -19,32 +25,65 @@
 
 namespace rkrai {
 
-#define MAX_POINT_LIGHTS 10
+//Must match ClusterLights.comp, SimpleShader.frag and DeferredLighting.frag
+#define MAX_LIGHTS_PER_CLUSTER 127
+#define CLUSTER_GROUP_SIZE 64
+#define INITIAL_LIGHT_CAPACITY 64
+#define INITIAL_TRANSFORM_CAPACITY 256
+//Frames that aren't in flight never upload their ranges, past this many they're merged into one covering everything
+#define MAX_PENDING_TRANSFORM_RANGES 1024
 
+//The object's matrices are read from the transform buffer at its scene graph slot
 struct SimplePushConstantData {
-    glm::mat4 modelMat{1.0f};
-    glm::mat4 normalMat{1.0f};
+    uint32_t objectIndex = 0;
 };
 
 struct PointLight {
-    glm::vec4 position{0.0f}; //w is ignored
+    glm::vec4 position{0.0f}; //w is the radius
     glm::vec4 color{1.0f}; //w is intensity
 };
 
+struct Cluster {
+    uint32_t lightCount;
+    uint32_t lightIndices[MAX_LIGHTS_PER_CLUSTER];
+};
+
 struct SimpleUbo {
     glm::mat4 projMat{1.0f};
     glm::mat4 viewMat{1.0f};
+    glm::mat4 inverseProjMat{1.0f};
     glm::vec4 ambientLightColor{1.0f, 1.0f, 1.0f, 0.02f}; //w is intensity
-    PointLight pointLights[MAX_POINT_LIGHTS];
-    int numLights;
+    glm::uvec4 clusterGrid{0}; //xyz is the cluster count per axis, w is the light count
+    glm::vec4 clusterDepth{0.0f}; //x is near, y is far, z is the z slice count over log(far / near)
+    glm::mat4 inverseViewMat{1.0f};
 };
 
-DefaultRenderSystem::DefaultRenderSystem(GraphicsDevice& device, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera)
-    : graphicsDevice(device), renderPass(renderPass), camera(camera) {
+DefaultRenderSystem::DefaultRenderSystem(
+    GraphicsDevice& device, PipelineCompiler& pipelineCompiler, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera,
+    std::shared_ptr<World> world, std::shared_ptr<const SceneGraph> sceneGraph, ShadingPath shadingPath, vk::DescriptorSetLayout gBufferSetLayout)
+    : graphicsDevice(device), pipelineCompiler(pipelineCompiler), renderPass(renderPass), shadingPath(shadingPath), gBufferSetLayout(gBufferSetLayout),
+    world(world), camera(camera), sceneGraph(sceneGraph), sceneChangeCount(sceneGraph->getChangeCount()),
+    lightBuffers(device, sizeof(PointLight), vk::BufferUsageFlagBits::eStorageBuffer),
+    transformBuffers(device, sizeof(TransformBatch::Matrices), vk::BufferUsageFlagBits::eStorageBuffer) {
+    assert((shadingPath == ShadingPath::eForward || gBufferSetLayout) && "Deferred shading needs the renderer's G-buffer set layout");
+    //Whatever the scene graph already holds has to be uploaded once
+    pendingTransformRanges.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, {{0, static_cast<uint32_t>(sceneGraph->size())}});
     createUboBuffers();
+    createClusterBuffers();
     createResourceBinder();
     createPipelineLayout();
     createPipeline();
+    lightBuffers.ensureCapacity(INITIAL_LIGHT_CAPACITY);
+    ensureTransformCapacity(INITIAL_TRANSFORM_CAPACITY);
+    proxyObserver = world->observeRemoval<CullingProxyComponent>(
+        [this](Entity entity, CullingProxyComponent& cullingProxy) { removeProxy(entity, cullingProxy); }
+    );
+    meshObserver = world->observeRemoval<MeshComponent>([this](Entity, MeshComponent& mesh) { retireMesh(mesh); });
+}
+
+DefaultRenderSystem::~DefaultRenderSystem() {
+    world->removeObserver(proxyObserver);
+    world->removeObserver(meshObserver);
 }
 
 void DefaultRenderSystem::createUboBuffers() {
@@ -58,13 +97,46 @@ void DefaultRenderSystem::createUboBuffers() {
     }
 }
 
+//The grid is only written and read on the gpu, so a single one is shared by all frames in flight
+void DefaultRenderSystem::createClusterBuffers() {
+    clusterBuffer.emplace(
+        graphicsDevice,
+        CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z * sizeof(Cluster),
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+}
+
+//New transform buffers start out without any matrices, every frame's has to be filled in from scratch
+void DefaultRenderSystem::ensureTransformCapacity(uint32_t requiredCapacity) {
+    if (!transformBuffers.ensureCapacity(requiredCapacity)) return;
+    for (auto& pendingRanges : pendingTransformRanges) {
+        pendingRanges = {{0, static_cast<uint32_t>(sceneGraph->size())}};
+    }
+}
+
+//Only called once the frame's fence has signaled, and before anything binds the set this frame
+void DefaultRenderSystem::updateFrameBinder(int currentFrameIndex) {
+    if (!lightBuffers.isOutdated(currentFrameIndex) && !transformBuffers.isOutdated(currentFrameIndex)) return;
+    resourceBinder[currentFrameIndex].setBuffer(1, &lightBuffers[currentFrameIndex]);
+    resourceBinder[currentFrameIndex].setBuffer(3, &transformBuffers[currentFrameIndex]);
+    lightBuffers.setUpToDate(currentFrameIndex);
+    transformBuffers.setUpToDate(currentFrameIndex);
+}
+
 void DefaultRenderSystem::createResourceBinder() {
     for (int i = 0; i < uboBuffers.size(); i++) {
         resourceBinder.emplace_back(
             graphicsDevice,
-            std::vector<ResourceBinder::Binding>{ {0, vk::DescriptorType::eUniformBuffer, 1} }
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eUniformBuffer, 1},
+                {1, vk::DescriptorType::eStorageBuffer, 1},
+                {2, vk::DescriptorType::eStorageBuffer, 1},
+                {3, vk::DescriptorType::eStorageBuffer, 1}
+            }
         );
         resourceBinder[i].setBuffer(0, &uboBuffers[i]);
+        resourceBinder[i].setBuffer(2, &*clusterBuffer);
     }
     perObjectBinder.emplace(
         graphicsDevice,
@@ -74,7 +146,7 @@ void DefaultRenderSystem::createResourceBinder() {
 
 void DefaultRenderSystem::createPipelineLayout() {
     vk::PushConstantRange pushConstantRange{
-        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+        vk::ShaderStageFlagBits::eVertex,
         0,
         sizeof(SimplePushConstantData)
     };
@@ -82,6 +154,14 @@ void DefaultRenderSystem::createPipelineLayout() {
     descriptorSetLayouts.push_back(resourceBinder[0].getSetLayout());
     descriptorSetLayouts.push_back(perObjectBinder->getSetLayout());
     pipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, descriptorSetLayouts, pushConstantRange});
+
+    vk::DescriptorSetLayout clusterSetLayout = resourceBinder[0].getSetLayout();
+    clusterPipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, clusterSetLayout});
+
+    if (shadingPath == ShadingPath::eDeferred) {
+        std::array<vk::DescriptorSetLayout, 2> lightingSetLayouts{resourceBinder[0].getSetLayout(), gBufferSetLayout};
+        lightingPipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, lightingSetLayouts});
+    }
 }
 
 void DefaultRenderSystem::createPipeline() {
@@ -90,53 +170,478 @@ void DefaultRenderSystem::createPipeline() {
     pipelineConfig.pipelineLayout = *pipelineLayout;
     pipelineConfig.bindingDescriptions = Model::Vertex::getBindingDescriptions();
     pipelineConfig.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
-    graphicsPipeline.emplace(
-        graphicsDevice,
+    clusterPipeline = pipelineCompiler.compile("shaders/ClusterLights.comp.spv", *clusterPipelineLayout);
+
+    //The variants materials commonly need are compiled right away, any other one on first use
+    const std::vector<ShaderVariantKey> commonVariants{
+        {.lighting = true, .textured = true},
+        {.lighting = true, .textured = false},
+        {.lighting = false, .textured = true},
+        {.lighting = false, .textured = false}
+    };
+
+    if (shadingPath == ShadingPath::eDeferred) {
+        pipelineConfig.subpass = SwapChain::GBUFFER_SUBPASS;
+        pipelineConfig.colorAttachmentCount = 2;
+        pipelineVariants.emplace(
+            pipelineCompiler,
+            "shaders/SimpleShader.vert.spv",
+            "shaders/GBuffer.frag.spv",
+            pipelineConfig
+        );
+        pipelineVariants->request(commonVariants);
+
+        //A single fullscreen triangle, every pixel is lit exactly once no matter how much overdraw the G-buffer had
+        PipelineConfigInfo lightingConfig = GraphicsPipeline::getDefaultPipelineConfigInfo();
+        lightingConfig.renderPass = renderPass;
+        lightingConfig.pipelineLayout = *lightingPipelineLayout;
+        lightingConfig.subpass = SwapChain::LIGHTING_SUBPASS;
+        lightingConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+        lightingConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        lightingPipeline = pipelineCompiler.compile(
+            "shaders/DeferredLighting.vert.spv",
+            "shaders/DeferredLighting.frag.spv",
+            lightingConfig
+        );
+        return;
+    }
+
+    pipelineConfig.subpass = SwapChain::getForwardSubpass(shadingPath);
+    pipelineVariants.emplace(
+        pipelineCompiler,
         "shaders/SimpleShader.vert.spv",
         "shaders/SimpleShader.frag.spv",
         pipelineConfig
     );
+    pipelineVariants->request(commonVariants);
+    if (shadingPath == ShadingPath::eForwardDepthPrepass) {
+        //Depth is already final after the pre-pass, so only the visible fragment of every pixel passes the equal test
+        PipelineConfigInfo depthEqualConfig = pipelineConfig;
+        depthEqualConfig.depthStencilInfo.depthCompareOp = vk::CompareOp::eEqual;
+        depthEqualConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        depthEqualVariants.emplace(
+            pipelineCompiler,
+            "shaders/SimpleShader.vert.spv",
+            "shaders/SimpleShader.frag.spv",
+            depthEqualConfig
+        );
+        depthEqualVariants->request(commonVariants);
+
+        PipelineConfigInfo depthPrepassConfig = pipelineConfig;
+        depthPrepassConfig.subpass = SwapChain::DEPTH_PREPASS_SUBPASS;
+        depthPrepassConfig.colorAttachmentCount = 0;
+        depthPrepassConfig.attributeDescriptions = Model::Vertex::getPositionAttributeDescriptions();
+        depthPrepassPipeline = pipelineCompiler.compile("shaders/DepthPrepass.vert.spv", "", depthPrepassConfig);
+    }
 }
 
-void DefaultRenderSystem::render(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+Entity DefaultRenderSystem::pick(const Ray& ray, float maxDistance) const {
+    auto hit = boundingVolumeHierarchy.raycast(ray, maxDistance, [&](BoundingVolumeHierarchy::ProxyId proxyId) {
+        const Entity entity = world->getEntity(boundingVolumeHierarchy.getUserData(proxyId));
+        const MeshComponent* mesh = world->getComponent<MeshComponent>(entity);
+        const SceneNodeComponent* sceneNode = world->getComponent<SceneNodeComponent>(entity);
+        //Until the next frame removes it, the proxy can belong to an entity that lost one of them
+        if (mesh == nullptr || sceneNode == nullptr) return std::optional<float>{};
+        return ray.intersect(getWorldBounds(*mesh, sceneNode->node), maxDistance);
+    });
+    if (!hit) return NO_ENTITY;
+    return world->getEntity(boundingVolumeHierarchy.getUserData(hit->proxyId));
+}
+
+AABB DefaultRenderSystem::getWorldBounds(const MeshComponent& mesh, SceneGraph::NodeId node) const {
+    return mesh.model->getBoundingBox().transformed(sceneGraph->getWorldMatrix(node));
+}
+
+//Called by the world whenever a culling proxy component goes away. The node may already be used by a newer mesh.
+void DefaultRenderSystem::removeProxy(Entity entity, const CullingProxyComponent& cullingProxy) {
+    boundingVolumeHierarchy.destroyProxy(cullingProxy.proxyId);
+    if (nodeEntities[cullingProxy.node] == entity) nodeEntities[cullingProxy.node] = NO_ENTITY;
+}
+
+//Meshes streamed out mid-game may still be drawn by frames in flight, so their model and texture are retired instead
+//of possibly being destroyed right away. A texture's set goes once the texture itself is gone, see updateTextureBinders.
+void DefaultRenderSystem::retireMesh(MeshComponent& mesh) {
+    if (mesh.texture != nullptr) graphicsDevice.retire(std::move(mesh.texture));
+    if (mesh.model != nullptr) graphicsDevice.retire(std::move(mesh.model));
+}
+
+//Entities that are destroyed outright lose their proxy right away, this catches the ones that only lost a component
+void DefaultRenderSystem::removeStaleProxies() {
+    queriedEntities.clear();
+    auto collect = [&](Entity entity, const CullingProxyComponent&) { queriedEntities.push_back(entity); };
+    world->query<const CullingProxyComponent>().without<MeshComponent>().each(collect);
+    world->query<const CullingProxyComponent>().without<SceneNodeComponent>().each(collect);
+    for (Entity entity : queriedEntities) {
+        world->removeComponent<CullingProxyComponent>(entity);
+    }
+}
+
+//Gives every mesh entity created since the last frame a proxy, which also takes it out of the query for the next frame
+void DefaultRenderSystem::addNewMeshes() {
+    queriedEntities.clear();
+    world->query<const SceneNodeComponent, const MeshComponent>().without<CullingProxyComponent>().each(
+        [&](Entity entity, const SceneNodeComponent&, const MeshComponent&) { queriedEntities.push_back(entity); }
+    );
+    for (Entity entity : queriedEntities) {
+        const SceneGraph::NodeId node = world->getComponent<SceneNodeComponent>(entity)->node;
+        const MeshComponent& mesh = *world->getComponent<MeshComponent>(entity);
+        assert(node != SceneGraph::NO_NODE && mesh.model != nullptr && "Meshes need a scene graph node and a model");
+        if (node >= nodeEntities.size()) nodeEntities.resize(node + 1, NO_ENTITY);
+        nodeEntities[node] = entity;
+        auto proxyId = boundingVolumeHierarchy.createProxy(getWorldBounds(mesh, node), entity.index);
+        world->addComponent(entity, CullingProxyComponent{proxyId, node});
+    }
+}
+
+//Only meshes whose world matrix the scene graph changed since the last frame get their bounds recomputed,
+//and the tree is only restructured when an object leaves its fat bounds. Nothing is done if nothing moved.
+void DefaultRenderSystem::updateBounds() {
+    const uint64_t changeCount = sceneGraph->getChangeCount();
+    if (changeCount == sceneChangeCount) return;
+    const std::vector<SceneGraph::SlotRange> allSlots{{0, static_cast<uint32_t>(sceneGraph->size())}};
+    const auto& changedRanges = changeCount == sceneChangeCount + 1 ? sceneGraph->getChangedRanges() : allSlots;
+    sceneChangeCount = changeCount;
+
+    for (auto range : changedRanges) {
+        for (uint32_t slot = range.first; slot < range.end; slot++) {
+            SceneGraph::NodeId node = sceneGraph->getNode(slot);
+            if (node >= nodeEntities.size() || nodeEntities[node] == NO_ENTITY) continue;
+            const Entity entity = nodeEntities[node];
+            boundingVolumeHierarchy.moveProxy(
+                world->getComponent<CullingProxyComponent>(entity)->proxyId, getWorldBounds(*world->getComponent<MeshComponent>(entity), node)
+            );
+        }
+    }
+    for (auto& pendingRanges : pendingTransformRanges) {
+        if (pendingRanges.size() + changedRanges.size() > MAX_PENDING_TRANSFORM_RANGES) {
+            pendingRanges.assign(1, {0, static_cast<uint32_t>(sceneGraph->size())});
+        } else {
+            pendingRanges.insert(pendingRanges.end(), changedRanges.begin(), changedRanges.end());
+        }
+    }
+}
+
+//Only the changed world matrices are copied into this frame's transform buffer, static objects cost nothing.
+//Ranges can reach past slots the scene graph has dropped since.
+void DefaultRenderSystem::updateTransforms(int currentFrameIndex) {
+    const uint32_t slotCount = static_cast<uint32_t>(sceneGraph->size());
+    auto& pendingRanges = pendingTransformRanges[currentFrameIndex];
+    if (pendingRanges.empty()) return;
+    auto* matrices = static_cast<TransformBatch::Matrices*>(transformBuffers[currentFrameIndex].map());
+    const TransformBatch::Matrices* worldMatrices = sceneGraph->getWorldMatrices();
+    for (auto range : pendingRanges) {
+        const uint32_t end = std::min(range.end, slotCount);
+        if (range.first < end) std::copy(worldMatrices + range.first, worldMatrices + end, matrices + range.first);
+    }
+    transformBuffers[currentFrameIndex].unmap();
+    pendingRanges.clear();
+}
+
+//Components are only looked up for the frustum visible meshes
+void DefaultRenderSystem::gatherDraws() {
+    drawList.clear();
+    for (auto proxyId : visibleProxyIds) {
+        const Entity entity = world->getEntity(boundingVolumeHierarchy.getUserData(proxyId));
+        const SceneGraph::NodeId node = world->getComponent<SceneNodeComponent>(entity)->node;
+        const MeshComponent& mesh = *world->getComponent<MeshComponent>(entity);
+        drawList.push_back({
+            .entity = entity,
+            .model = mesh.model.get(),
+            .texture = mesh.texture.get(),
+            .bounds = getWorldBounds(mesh, node),
+            .transformSlot = sceneGraph->getSlot(node),
+            .variantId = getVariantId(getVariantKey(mesh, world->getComponent<MaterialComponent>(entity)))
+        });
+    }
+}
+
+void DefaultRenderSystem::cullOccludedObjects(const glm::mat4& projView) {
+    occluders.clear();
+    for (const Draw& draw : drawList) {
+        const OccluderComponent* occluder = world->getComponent<OccluderComponent>(draw.entity);
+        if (occluder == nullptr) continue;
+        occluders.push_back({occluder, sceneGraph->getWorldMatrices()[draw.transformSlot].modelMat});
+    }
+    softwareOcclusionCuller->renderOccluders(projView, occluders);
+
+    std::erase_if(drawList, [&](const Draw& draw) {
+        return !softwareOcclusionCuller->isVisible(draw.bounds);
+    });
+}
+
+ShaderVariantKey DefaultRenderSystem::getVariantKey(const MeshComponent& mesh, const MaterialComponent* material) const {
+    ShaderVariantKey key{.textured = mesh.texture != nullptr};
+    if (material != nullptr) {
+        key.lighting = material->lit;
+        //The deferred lighting pass shades every lit pixel alike, the limit would only add variants
+        if (shadingPath != ShadingPath::eDeferred) key.maxLights = material->maxLights;
+    }
+    return key;
+}
+
+uint32_t DefaultRenderSystem::getVariantId(const ShaderVariantKey& key) {
+    auto [variantId, inserted] = variantIds.try_emplace(key, static_cast<uint32_t>(variants.size()));
+    if (inserted) {
+        variants.push_back({
+            .key = key,
+            .pipeline = pipelineVariants->get(key),
+            .depthEqualPipeline = depthEqualVariants ? depthEqualVariants->get(key) : PipelineHandle<GraphicsPipeline>{}
+        });
+    }
+    return variantId->second;
+}
+
+//Key layout from the most significant bit: 4 bit shader variant id, 12 bit texture id, 16 bit mesh id, 32 bit view depth.
+//Non negative floats keep their order when compared as integers, so the depth's bit pattern is used directly.
+//Ids are handed out anew each frame, so they stay dense and never outlive the textures and meshes they were given to.
+void DefaultRenderSystem::sortDrawList(const glm::mat4& view) {
+    sortItems.clear();
+    textureSortIds.clear();
+    meshSortIds.clear();
+    for (uint32_t drawIndex = 0; drawIndex < drawList.size(); drawIndex++) {
+        const Draw& draw = drawList[drawIndex];
+        //Ids past their field's range share its last value, those draws still sort by the remaining fields
+        //and the recording loop rebinds whatever actually changes, so only the batching suffers
+        auto variantId = std::min(draw.variantId, 0xfu);
+        auto textureId = std::min(textureSortIds.try_emplace(draw.texture, static_cast<uint32_t>(textureSortIds.size())).first->second, 0xfffu);
+        auto meshId = std::min(meshSortIds.try_emplace(draw.model, static_cast<uint32_t>(meshSortIds.size())).first->second, 0xffffu);
+
+        float viewDepth = std::max((view * glm::vec4{draw.bounds.getCenter(), 1.0f}).z, 0.0f);
+        uint64_t key = (static_cast<uint64_t>(variantId) << 60) | (static_cast<uint64_t>(textureId) << 48)
+            | (static_cast<uint64_t>(meshId) << 32) | std::bit_cast<uint32_t>(viewDepth);
+        sortItems.push_back({key, drawIndex});
+    }
+    radixSort(sortItems, sortScratch);
+    drawScratch.clear();
+    for (const auto& sortItem : sortItems) {
+        drawScratch.push_back(drawList[sortItem.value]);
+    }
+    std::swap(drawList, drawScratch);
+}
+
+//Sets are dropped once their texture has been destroyed, whoever held it last, before a new texture can show up at
+//the same address and be handed the old set
+void DefaultRenderSystem::updateTextureBinders() {
+    for (auto binder = textureBinders.begin(); binder != textureBinders.end();) {
+        if (binder->second.texture.expired()) {
+            graphicsDevice.retire(std::move(binder->second.binder));
+            binder = textureBinders.erase(binder);
+        } else {
+            ++binder;
+        }
+    }
+    for (const Draw& draw : drawList) {
+        if (draw.texture == nullptr || textureBinders.contains(draw.texture)) continue;
+        auto binder = textureBinders.emplace(draw.texture, TextureBinder{
+            .texture = world->getComponent<MeshComponent>(draw.entity)->texture,
+            .binder = ResourceBinder{graphicsDevice, std::vector<ResourceBinder::Binding>{ {1, vk::DescriptorType::eCombinedImageSampler, 1} }}
+        }).first;
+        binder->second.binder.setTexture(1, draw.texture);
+    }
+}
+
+//Bins every light into the view space clusters its radius touches, so that fragments only shade
+//the lights of their own cluster instead of every light in the scene.
+void DefaultRenderSystem::clusterLights(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    std::vector<PointLight> pointLights;
+    world->query<const SceneNodeComponent, const PointLightComponent>().each(
+        [&](Entity, const SceneNodeComponent& sceneNode, const PointLightComponent& pointLight) {
+            pointLights.push_back({
+                .position = glm::vec4{sceneGraph->getWorldPosition(sceneNode.node), pointLight.radius},
+                .color = pointLight.color
+            });
+        }
+    );
+    lightBuffers.ensureCapacity(static_cast<uint32_t>(pointLights.size()));
+    updateFrameBinder(currentFrameIndex);
+    if (!pointLights.empty()) {
+        lightBuffers[currentFrameIndex].writeData(pointLights.data(), pointLights.size() * sizeof(PointLight));
+    }
+
+    //The clusters are exponentially sliced in depth, which needs a near plane in front of the camera
+    const float nearPlane = std::max(camera->getNear(), 0.01f);
+    const float farPlane = std::max(camera->getFar(), nearPlane * 2.0f);
     SimpleUbo simpleUbo{
         .projMat = camera->getProjection(),
-        .viewMat = camera->getView()
+        .viewMat = camera->getView(),
+        .inverseProjMat = glm::inverse(camera->getProjection()),
+        .clusterGrid = {CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, static_cast<uint32_t>(pointLights.size())},
+        .clusterDepth = {nearPlane, farPlane, CLUSTER_GRID_Z / std::log(farPlane / nearPlane), 0.0f},
+        .inverseViewMat = glm::inverse(camera->getView())
     };
+    uboBuffers[currentFrameIndex].mapData(&simpleUbo);
+
+    //The previous frame's fragments may still be reading the clusters
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eComputeShader, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderWrite},
+        {}, {}
+    );
+    clusterPipeline->bind(commandBuffer);
+    resourceBinder[currentFrameIndex].bind(commandBuffer, *clusterPipelineLayout, 0, vk::PipelineBindPoint::eCompute);
+    constexpr uint32_t clusterCount = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+    commandBuffer.dispatch((clusterCount + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE, 1, 1);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead},
+        {}, {}
+    );
+}
 
-    for (const auto& gameObj : gameObjects) {
-        if (gameObj->pointLight != nullptr) {
-            PointLight pointLight{
-                .position = glm::vec4{gameObj->transform.translation, 1.0f},
-                .color = gameObj->pointLight->color
-            };
-            simpleUbo.pointLights[simpleUbo.numLights] = pointLight;
-            simpleUbo.numLights++;
+void DefaultRenderSystem::prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    pipelinesReady = clusterPipeline.isReady() && (shadingPath != ShadingPath::eDeferred || lightingPipeline.isReady());
+    depthPrepassReady = depthPrepassPipeline.isReady();
+    //Growing either buffer outdates this frame's set, which has to be rewritten before anything binds it
+    ensureTransformCapacity(static_cast<uint32_t>(sceneGraph->size()));
+    if (pipelinesReady) clusterLights(commandBuffer, currentFrameIndex);
+    updateFrameBinder(currentFrameIndex);
+
+    const glm::mat4 projView = camera->getProjection() * camera->getView();
+    removeStaleProxies();
+    addNewMeshes();
+    updateBounds();
+    updateTransforms(currentFrameIndex);
+    visibleProxyIds.clear();
+    boundingVolumeHierarchy.queryFrustum(Frustum::fromMatrix(projView), visibleProxyIds);
+
+    gatherDraws();
+    if (softwareOcclusionCuller != nullptr) cullOccludedObjects(projView);
+    sortDrawList(camera->getView());
+    updateTextureBinders();
+    //Draws of a variant that is still compiling are skipped
+    for (auto& variant : variants) {
+        variant.ready = (usesDepthPrepass() ? variant.depthEqualPipeline : variant.pipeline).isReady();
+    }
+
+    if (occlusionCuller != nullptr) {
+        std::vector<OcclusionCuller::Object> cullObjects;
+        cullObjects.reserve(drawList.size());
+        for (const Draw& draw : drawList) {
+            cullObjects.push_back({draw.bounds, draw.entity.index, draw.model->getElementCount()});
         }
+        occlusionCuller->beginFrame(currentFrameIndex, cullObjects, world->getEntityCapacity());
+        occlusionCuller->cullEarly(commandBuffer, currentFrameIndex, projView);
     }
+}
 
-    uboBuffers[currentFrameIndex].mapData(&simpleUbo);
+void DefaultRenderSystem::render(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    recordDraws(commandBuffer, currentFrameIndex, OcclusionCuller::Phase::eEarly, 0, static_cast<uint32_t>(drawList.size()));
+}
 
-    graphicsPipeline->bind(commandBuffer);
+void DefaultRenderSystem::renderLate(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (occlusionCuller == nullptr) return;
+    recordDraws(commandBuffer, currentFrameIndex, OcclusionCuller::Phase::eLate, 0, static_cast<uint32_t>(drawList.size()));
+}
+
+//Variants are compiled on first use, long after the pass they were set up with may have been destroyed
+void DefaultRenderSystem::renderPassChanged(vk::RenderPass renderPass) {
+    this->renderPass = renderPass;
+    if (pipelineVariants) pipelineVariants->setRenderPass(renderPass);
+    if (depthEqualVariants) depthEqualVariants->setRenderPass(renderPass);
+}
+
+void DefaultRenderSystem::renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder) {
+    if (shadingPath != ShadingPath::eDeferred || !pipelinesReady) return;
+    lightingPipeline->bind(commandBuffer);
+    resourceBinder[currentFrameIndex].bind(commandBuffer, *lightingPipelineLayout, 0);
+    gBufferBinder.bind(commandBuffer, *lightingPipelineLayout, 1);
+    commandBuffer.draw(3, 1, 0, 0);
+}
+
+void DefaultRenderSystem::renderDepthPrepass(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (!usesDepthPrepass()) return;
+    recordDepthPrepassDraws(commandBuffer, currentFrameIndex, 0, static_cast<uint32_t>(drawList.size()));
+}
+
+uint32_t DefaultRenderSystem::getChunkCount(int currentFrameIndex) const {
+    return std::max(1u, static_cast<uint32_t>((drawList.size() + DRAWS_PER_CHUNK - 1) / DRAWS_PER_CHUNK));
+}
+
+void DefaultRenderSystem::renderChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount) {
+    const uint32_t drawCount = static_cast<uint32_t>(drawList.size());
+    recordDraws(
+        commandBuffer, currentFrameIndex, OcclusionCuller::Phase::eEarly,
+        drawCount * chunkIndex / chunkCount, drawCount * (chunkIndex + 1) / chunkCount
+    );
+}
+
+void DefaultRenderSystem::renderLateChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount) {
+    if (occlusionCuller == nullptr) return;
+    const uint32_t drawCount = static_cast<uint32_t>(drawList.size());
+    recordDraws(
+        commandBuffer, currentFrameIndex, OcclusionCuller::Phase::eLate,
+        drawCount * chunkIndex / chunkCount, drawCount * (chunkIndex + 1) / chunkCount
+    );
+}
+
+void DefaultRenderSystem::renderDepthPrepassChunk(
+    vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount) {
+    if (!usesDepthPrepass()) return;
+    const uint32_t drawCount = static_cast<uint32_t>(drawList.size());
+    recordDepthPrepassDraws(
+        commandBuffer, currentFrameIndex, drawCount * chunkIndex / chunkCount, drawCount * (chunkIndex + 1) / chunkCount
+    );
+}
+
+//Position only and without a fragment shader, textures aren't needed
+void DefaultRenderSystem::recordDepthPrepassDraws(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t firstDraw, uint32_t endDraw) {
+    depthPrepassPipeline->bind(commandBuffer);
     resourceBinder[currentFrameIndex].bind(commandBuffer, *pipelineLayout, 0);
 
-    for (const auto& gameObj : gameObjects) {
-        if (gameObj->model == nullptr) continue;
-        SimplePushConstantData push{};
-        push.modelMat = gameObj->transform.modelMatrix();
-        push.normalMat = gameObj->transform.normalMatrix();
-        
-        commandBuffer.pushConstants(
-            *pipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
-            0, sizeof(SimplePushConstantData), &push
-        );
+    const Model* boundModel = nullptr;
+    for (uint32_t drawIndex = firstDraw; drawIndex < endDraw; drawIndex++) {
+        const Draw& draw = drawList[drawIndex];
+        SimplePushConstantData push{.objectIndex = draw.transformSlot};
+        commandBuffer.pushConstants(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(SimplePushConstantData), &push);
 
-        perObjectBinder->setTexture(1, gameObj->texture.get());
-        perObjectBinder->bind(commandBuffer, *pipelineLayout, 1);
+        if (draw.model != boundModel) {
+            boundModel = draw.model;
+            draw.model->bind(commandBuffer);
+        }
+        draw.model->draw(commandBuffer);
+    }
+}
 
-        gameObj->model->bind(commandBuffer);
-        gameObj->model->draw(commandBuffer);
+//With an occlusion culler every draw is indirect, and the culler decides on the gpu whether it has any instances.
+//The draw list is sorted by texture and mesh, so most of their binds repeat the previous draw's and are skipped.
+void DefaultRenderSystem::recordDraws(
+    vk::CommandBuffer commandBuffer, int currentFrameIndex, OcclusionCuller::Phase phase, uint32_t firstDraw, uint32_t endDraw) {
+    if (!pipelinesReady) return;
+    resourceBinder[currentFrameIndex].bind(commandBuffer, *pipelineLayout, 0);
+
+    const Variant* boundVariant = nullptr;
+    const Texture* boundTexture = nullptr;
+    const Model* boundModel = nullptr;
+    for (uint32_t drawIndex = firstDraw; drawIndex < endDraw; drawIndex++) {
+        const Draw& draw = drawList[drawIndex];
+        const Variant& variant = variants[draw.variantId];
+        if (!variant.ready) continue;
+        if (&variant != boundVariant) {
+            boundVariant = &variant;
+            (usesDepthPrepass() ? variant.depthEqualPipeline : variant.pipeline)->bind(commandBuffer);
+        }
+
+        SimplePushConstantData push{.objectIndex = draw.transformSlot};
+        commandBuffer.pushConstants(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(SimplePushConstantData), &push);
+
+        //Untextured variants never read set 1
+        if (draw.texture != nullptr && draw.texture != boundTexture) {
+            boundTexture = draw.texture;
+            textureBinders.at(boundTexture).binder.bind(commandBuffer, *pipelineLayout, 1);
+        }
+        if (draw.model != boundModel) {
+            boundModel = draw.model;
+            draw.model->bind(commandBuffer);
+        }
+        if (occlusionCuller == nullptr) {
+            draw.model->draw(commandBuffer);
+        } else {
+            draw.model->drawIndirect(
+                commandBuffer,
+                occlusionCuller->getDrawCommandBuffer(currentFrameIndex, phase),
+                OcclusionCuller::getDrawCommandOffset(drawIndex)
+            );
+        }
     }
-    simpleUbo.numLights = 0;
 }
 }
\ No newline at end of file
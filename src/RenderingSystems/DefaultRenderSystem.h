@@ -1,47 +1,194 @@
 #pragma once
 
+#include "BoundingVolumeHierarchy.h"
 #include "Camera.h"
+#include "ComputePipeline.h"
 #include "GraphicsDevice.h"
 #include "GraphicsPipeline.h"
-#include "GameObject.h"
+#include "Components.h"
+#include "OcclusionCuller.h"
+#include "PerFrameBuffers.h"
+#include "PipelineCompiler.h"
+#include "RadixSort.h"
 #include "RenderSystem.h"
 #include "ResourceBinder.h"
+#include "SceneGraph.h"
+#include "SoftwareOcclusionCuller.h"
+#include "SwapChain.h"
+#include "TransformBatch.h"
+#include "World.h"
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace rkrai {
+//Draws every entity with a SceneNodeComponent and a MeshComponent, lit by every entity with a SceneNodeComponent and a
+//PointLightComponent. New meshes are picked up by the next frame, destroyed ones are dropped right away and meshes
+//that lost their mesh or scene node component are dropped by the next frame.
 class DefaultRenderSystem : public RenderSystem {
 public:
-    DefaultRenderSystem(GraphicsDevice& device, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera);
+    //Draws are split into chunks of this size when the Renderer records in parallel
+    static constexpr uint32_t DRAWS_PER_CHUNK = 256;
+    //View space light clusters, x and y split the screen evenly while z is split exponentially
+    static constexpr uint32_t CLUSTER_GRID_X = 16;
+    static constexpr uint32_t CLUSTER_GRID_Y = 9;
+    static constexpr uint32_t CLUSTER_GRID_Z = 24;
+
+    //The deferred shading path writes the G-buffer and lights it in a fullscreen pass, which needs Renderer::getGBufferSetLayout().
+    //Nothing is drawn until the pipelines the compiler builds in the background are ready.
+    DefaultRenderSystem(
+        GraphicsDevice& device, PipelineCompiler& pipelineCompiler, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera,
+        std::shared_ptr<World> world, std::shared_ptr<const SceneGraph> sceneGraph, ShadingPath shadingPath = ShadingPath::eForward,
+        vk::DescriptorSetLayout gBufferSetLayout = nullptr);
+    ~DefaultRenderSystem();
     DefaultRenderSystem(const DefaultRenderSystem&) = delete;
     void operator=(const DefaultRenderSystem&) = delete;
 
-    void addGameObject(std::shared_ptr<const GameObject> gameObject) { gameObjects.push_back(gameObject); }
-    void removeGameObject();
+    //Returns the closest mesh entity whose world bounds are hit by the ray, or NO_ENTITY
+    Entity pick(const Ray& ray, float maxDistance) const;
     void setCamera(std::shared_ptr<const Camera> camera) { this->camera = camera; }
-    GraphicsPipeline& getPipeline() { return *graphicsPipeline; }
+    //The same culler must also be given to the Renderer
+    void setOcclusionCuller(std::shared_ptr<OcclusionCuller> occlusionCuller) { this->occlusionCuller = occlusionCuller; }
+    //Objects with an occluder component are rasterized on the cpu, and anything hidden behind them is never drawn
+    void setSoftwareOcclusionCuller(std::shared_ptr<SoftwareOcclusionCuller> softwareOcclusionCuller) {
+        this->softwareOcclusionCuller = softwareOcclusionCuller;
+    }
+    //With ShadingPath::eForwardDepthPrepass the objects' depth is laid down in the depth only subpass and the main
+    //subpass only shades fragments with exactly that depth. Turning it off shades them with a regular depth test.
+    void setDepthPrepassEnabled(bool enabled) { depthPrepassEnabled = enabled; }
 
 private:
+    //Added to every mesh entity the system has given a proxy in its bounding volume hierarchy, the proxy's user data is
+    //the entity index. Removing the component removes the proxy.
+    struct CullingProxyComponent {
+        BoundingVolumeHierarchy::ProxyId proxyId;
+        SceneGraph::NodeId node;
+    };
+
+    //Everything recording a draw needs, gathered in prepare so that recording never looks up components
+    struct Draw {
+        Entity entity;
+        Model* model;
+        Texture* texture;
+        AABB bounds;
+        uint32_t transformSlot;
+        uint32_t variantId;
+    };
+
+    //A shader variant at least one draw has used, ids are handed out on first sight and go into the draw sort key
+    struct Variant {
+        ShaderVariantKey key;
+        PipelineHandle<GraphicsPipeline> pipeline;
+        PipelineHandle<GraphicsPipeline> depthEqualPipeline;
+        //Taken in prepare along with pipelinesReady
+        bool ready = false;
+    };
+
+    //The weak pointer tells when the texture is gone, its address alone could be reused by another one
+    struct TextureBinder {
+        std::weak_ptr<const Texture> texture;
+        ResourceBinder binder;
+    };
+
     void createUboBuffers();
+    void createClusterBuffers();
+    void ensureTransformCapacity(uint32_t requiredCapacity);
+    void updateFrameBinder(int currentFrameIndex);
     void createResourceBinder();
     void createPipelineLayout();
     void createPipeline();
+    void clusterLights(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void removeProxy(Entity entity, const CullingProxyComponent& cullingProxy);
+    void removeStaleProxies();
+    void retireMesh(MeshComponent& mesh);
+    void addNewMeshes();
+    void updateBounds();
+    void updateTransforms(int currentFrameIndex);
+    void gatherDraws();
+    void cullOccludedObjects(const glm::mat4& projView);
+    AABB getWorldBounds(const MeshComponent& mesh, SceneGraph::NodeId node) const;
+    ShaderVariantKey getVariantKey(const MeshComponent& mesh, const MaterialComponent* material) const;
+    uint32_t getVariantId(const ShaderVariantKey& key);
+    void sortDrawList(const glm::mat4& view);
+    void updateTextureBinders();
+    void prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex);
     void render(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void renderLate(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void renderDepthPrepass(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder);
+    void renderPassChanged(vk::RenderPass renderPass);
+    uint32_t getChunkCount(int currentFrameIndex) const;
+    void renderChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount);
+    void renderLateChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount);
+    void renderDepthPrepassChunk(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t chunkIndex, uint32_t chunkCount);
+    //Falls back to shading with a regular depth test until the pre-pass pipeline is compiled
+    bool usesDepthPrepass() const {
+        return shadingPath == ShadingPath::eForwardDepthPrepass && depthPrepassEnabled
+            && depthPrepassReady;
+    }
+    void recordDepthPrepassDraws(vk::CommandBuffer commandBuffer, int currentFrameIndex, uint32_t firstDraw, uint32_t endDraw);
+    void recordDraws(
+        vk::CommandBuffer commandBuffer, int currentFrameIndex, OcclusionCuller::Phase phase, uint32_t firstDraw, uint32_t endDraw);
 
     GraphicsDevice& graphicsDevice;
+    PipelineCompiler& pipelineCompiler;
     vk::RenderPass renderPass;
+    ShadingPath shadingPath;
+    vk::DescriptorSetLayout gBufferSetLayout;
+    bool depthPrepassEnabled = true;
+    //Taken once per frame in prepare, so that every pass of a frame agrees on which pipelines are used
+    bool pipelinesReady = false;
+    bool depthPrepassReady = false;
 
-    std::vector<std::shared_ptr<const GameObject>> gameObjects;
+    std::shared_ptr<World> world;
     std::shared_ptr<const Camera> camera;
+    std::shared_ptr<const SceneGraph> sceneGraph;
+
+    BoundingVolumeHierarchy boundingVolumeHierarchy;
+    World::ObserverId proxyObserver;
+    World::ObserverId meshObserver;
+    //Entities found by a query, which can't be changed until it's done iterating
+    std::vector<Entity> queriedEntities;
+    //Indexed by scene graph node, the mesh entity using the node or NO_ENTITY
+    std::vector<Entity> nodeEntities;
+    //The scene graph's change count as of the last frame
+    uint64_t sceneChangeCount = 0;
+    std::vector<BoundingVolumeHierarchy::ProxyId> visibleProxyIds;
+    std::vector<Draw> drawList;
+    std::vector<Draw> drawScratch;
+    //Sort keys group draws by texture, then by mesh, then front to back. Ids are handed out on first sight each frame.
+    std::vector<SortItem> sortItems;
+    std::vector<SortItem> sortScratch;
+    std::unordered_map<const Texture*, uint32_t> textureSortIds;
+    std::unordered_map<const Model*, uint32_t> meshSortIds;
+    std::unordered_map<ShaderVariantKey, uint32_t, ShaderVariantKey::Hash> variantIds;
+    std::vector<Variant> variants;
+    std::shared_ptr<OcclusionCuller> occlusionCuller;
+    std::shared_ptr<SoftwareOcclusionCuller> softwareOcclusionCuller;
+    std::vector<SoftwareOcclusionCuller::Occluder> occluders;
     
     std::vector<GraphicsBuffer> uboBuffers;
+    PerFrameBuffers lightBuffers;
+    //Mirror the scene graph's world matrices by slot, each frame's buffer catches up on the slots changed since it was last written
+    PerFrameBuffers transformBuffers;
+    std::vector<std::vector<SceneGraph::SlotRange>> pendingTransformRanges;
+    std::optional<GraphicsBuffer> clusterBuffer;
+    vk::UniquePipelineLayout clusterPipelineLayout;
+    PipelineHandle<ComputePipeline> clusterPipeline;
     std::vector<ResourceBinder> resourceBinder;
     std::optional<ResourceBinder> perObjectBinder;
+    //One descriptor set per texture, so draws never have to update a set that is already bound
+    std::unordered_map<const Texture*, TextureBinder> textureBinders;
     vk::UniquePipelineLayout pipelineLayout;
-    std::optional<GraphicsPipeline> graphicsPipeline;
+    //Depth equal variants are only compiled for the pre-pass shading path
+    std::optional<GraphicsPipelineVariants> pipelineVariants;
+    std::optional<GraphicsPipelineVariants> depthEqualVariants;
+    PipelineHandle<GraphicsPipeline> depthPrepassPipeline;
+    vk::UniquePipelineLayout lightingPipelineLayout;
+    PipelineHandle<GraphicsPipeline> lightingPipeline;
 };
 }
\ No newline at end of file
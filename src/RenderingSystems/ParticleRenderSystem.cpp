@@ -0,0 +1,295 @@
+#include "ParticleRenderSystem.h"
+#include "ComputePipeline.h"
+#include "GraphicsPipeline.h"
+#include "ResourceBinder.h"
+#include "SwapChain.h"
+#include <vector>
+#include <vulkan/vulkan_enums.hpp>
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+namespace rkrai {
+
+//Must match the particle compute shaders
+#define PARTICLE_GROUP_SIZE 64
+//Long stalls (loading, dragging the window) would otherwise emit and integrate one huge step
+#define MAX_DELTA_TIME 0.1f
+
+//Must match Particle.glsl
+struct Particle {
+    glm::vec4 position; //w is the age in seconds
+    glm::vec4 velocity; //w is the lifetime in seconds
+    glm::vec4 color; //w is intensity
+    glm::vec4 acceleration; //w is the size
+};
+
+//Must match Particle.glsl, starts with the indirect draw arguments followed by the simulation's indirect dispatch
+struct ParticleState {
+    uint32_t vertexCount = 6;
+    uint32_t instanceCount = 0;
+    uint32_t firstVertex = 0;
+    uint32_t firstInstance = 0;
+    uint32_t simulateGroupCountX = 0;
+    uint32_t simulateGroupCountY = 1;
+    uint32_t simulateGroupCountZ = 1;
+    uint32_t aliveCount = 0;
+};
+
+struct ParticlePushConstantData {
+    float deltaTime;
+    uint32_t emitterCount;
+    uint32_t emitCount;
+    uint32_t seed;
+    uint32_t capacity;
+};
+
+struct ParticleUbo {
+    glm::mat4 projMat{1.0f};
+    glm::mat4 viewMat{1.0f};
+};
+
+ParticleRenderSystem::ParticleRenderSystem(
+    GraphicsDevice& device, PipelineCompiler& pipelineCompiler, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera,
+    std::shared_ptr<World> world, std::shared_ptr<const SceneGraph> sceneGraph, ShadingPath shadingPath, uint32_t particleCapacity)
+    : graphicsDevice(device), pipelineCompiler(pipelineCompiler), renderPass(renderPass), shadingPath(shadingPath), particleCapacity(particleCapacity),
+    world(world), camera(camera), sceneGraph(sceneGraph),
+    lastUpdateTime(std::chrono::steady_clock::now()), emitterBuffers(device, sizeof(Emitter), vk::BufferUsageFlagBits::eStorageBuffer) {
+    assert(particleCapacity > 0 && "A particle system needs room for at least one particle");
+    createBuffers();
+    createResourceBinders();
+    createPipelineLayout();
+    createPipelines();
+    emitterBuffers.ensureCapacity(INITIAL_EMITTER_CAPACITY);
+}
+
+void ParticleRenderSystem::createBuffers() {
+    for (int i = 0; i < 2; i++) {
+        particleBuffers.emplace_back(
+            graphicsDevice,
+            particleCapacity * sizeof(Particle),
+            vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eDeviceLocal
+        );
+    }
+
+    stateBuffer.emplace(
+        graphicsDevice,
+        sizeof(ParticleState),
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+    GraphicsBuffer stagingBuffer{
+        graphicsDevice,
+        sizeof(ParticleState),
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    };
+    ParticleState initialState{};
+    stagingBuffer.mapData(&initialState);
+    stateBuffer->copyFrom(stagingBuffer);
+
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        uboBuffers.emplace_back(
+            graphicsDevice,
+            sizeof(ParticleUbo),
+            vk::BufferUsageFlagBits::eUniformBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible
+        );
+    }
+}
+
+void ParticleRenderSystem::createResourceBinders() {
+    //particleBinders[i] writes into particleBuffers[i]
+    for (int i = 0; i < 2; i++) {
+        particleBinders.emplace_back(
+            graphicsDevice,
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eStorageBuffer, 1},
+                {1, vk::DescriptorType::eStorageBuffer, 1},
+                {2, vk::DescriptorType::eStorageBuffer, 1}
+            }
+        );
+        particleBinders[i].setBuffer(0, &particleBuffers[1 - i]);
+        particleBinders[i].setBuffer(1, &particleBuffers[i]);
+        particleBinders[i].setBuffer(2, &*stateBuffer);
+    }
+    for (int i = 0; i < uboBuffers.size(); i++) {
+        frameBinders.emplace_back(
+            graphicsDevice,
+            std::vector<ResourceBinder::Binding>{
+                {0, vk::DescriptorType::eUniformBuffer, 1},
+                {1, vk::DescriptorType::eStorageBuffer, 1}
+            }
+        );
+        frameBinders[i].setBuffer(0, &uboBuffers[i]);
+    }
+}
+
+//The compute and graphics pipelines share one layout, only the compute shaders use the push constants
+void ParticleRenderSystem::createPipelineLayout() {
+    vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(ParticlePushConstantData)};
+    std::array<vk::DescriptorSetLayout, 2> descriptorSetLayouts{particleBinders[0].getSetLayout(), frameBinders[0].getSetLayout()};
+    pipelineLayout = graphicsDevice.getDevice().createPipelineLayoutUnique({{}, descriptorSetLayouts, pushConstantRange});
+}
+
+void ParticleRenderSystem::createPipelines() {
+    simulatePipeline = pipelineCompiler.compile("shaders/ParticleSimulate.comp.spv", *pipelineLayout);
+    emitPipeline = pipelineCompiler.compile("shaders/ParticleEmit.comp.spv", *pipelineLayout);
+    finalizePipeline = pipelineCompiler.compile("shaders/ParticleFinalize.comp.spv", *pipelineLayout);
+
+    //Additive blending makes the draw order irrelevant, so particles never need sorting
+    PipelineConfigInfo pipelineConfig = GraphicsPipeline::getDefaultPipelineConfigInfo();
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = *pipelineLayout;
+    pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+    pipelineConfig.colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eOne;
+    pipelineConfig.colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOne;
+    pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eZero;
+    pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOne;
+    pipelineConfig.subpass = SwapChain::getForwardSubpass(shadingPath);
+    graphicsPipeline = pipelineCompiler.compile(
+        "shaders/ParticleShader.vert.spv",
+        "shaders/BillboardShader.frag.spv",
+        pipelineConfig
+    );
+}
+
+//Emitters are laid out by their first new particle index, which the emit shader binary searches
+void ParticleRenderSystem::updateEmitters(int currentFrameIndex, float deltaTime) {
+    emitters.clear();
+    emitCount = 0;
+    world->query<const SceneNodeComponent, ParticleEmitterComponent>().each(
+        [&](Entity, const SceneNodeComponent& sceneNode, ParticleEmitterComponent& emitter) {
+            float owed = emitter.emissionRate * deltaTime + emitter.emissionRemainder;
+            emitter.emissionRemainder = owed - std::floor(owed);
+            uint32_t count = std::min(static_cast<uint32_t>(owed), particleCapacity - emitCount);
+            if (count == 0) return;
+
+            emitters.push_back({
+                .position = glm::vec4{sceneGraph->getWorldPosition(sceneNode.node), emitter.size},
+                .velocity = glm::vec4{emitter.velocity, emitter.velocitySpread},
+                .acceleration = glm::vec4{emitter.acceleration, emitter.lifetime},
+                .color = emitter.color,
+                .emission = glm::uvec4{emitCount, count, 0, 0}
+            });
+            emitCount += count;
+        }
+    );
+
+    emitterBuffers.ensureCapacity(static_cast<uint32_t>(emitters.size()));
+    //This frame's fence has signaled, so its set is no longer in use
+    if (emitterBuffers.isOutdated(currentFrameIndex)) {
+        frameBinders[currentFrameIndex].setBuffer(1, &emitterBuffers[currentFrameIndex]);
+        emitterBuffers.setUpToDate(currentFrameIndex);
+    }
+    if (!emitters.empty()) {
+        emitterBuffers[currentFrameIndex].writeData(emitters.data(), emitters.size() * sizeof(Emitter));
+    }
+}
+
+void ParticleRenderSystem::prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    auto currentTime = std::chrono::steady_clock::now();
+    float deltaTime = std::min(std::chrono::duration<float>(currentTime - lastUpdateTime).count(), MAX_DELTA_TIME);
+    lastUpdateTime = currentTime;
+    //Nothing is simulated or drawn until every stage's pipeline is compiled, the draw uses the same answer as the simulation
+    pipelinesReady = simulatePipeline.isReady() && emitPipeline.isReady() && finalizePipeline.isReady() && graphicsPipeline.isReady();
+    if (!pipelinesReady) return;
+    updateEmitters(currentFrameIndex, deltaTime);
+
+    ParticleUbo particleUbo{
+        .projMat = camera->getProjection(),
+        .viewMat = camera->getView()
+    };
+    uboBuffers[currentFrameIndex].mapData(&particleUbo);
+
+    //Last frame's destination becomes this frame's source
+    destinationIndex = 1 - destinationIndex;
+
+    //Waits for the previous simulation, and for draws still reading the buffer about to be overwritten
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader, {},
+        vk::MemoryBarrier{
+            vk::AccessFlagBits::eShaderWrite,
+            vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eIndirectCommandRead
+                | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+        },
+        {}, {}
+    );
+    commandBuffer.fillBuffer(stateBuffer->getBuffer(), offsetof(ParticleState, instanceCount), sizeof(uint32_t), 0);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite},
+        {}, {}
+    );
+
+    ParticlePushConstantData push{
+        .deltaTime = deltaTime,
+        .emitterCount = static_cast<uint32_t>(emitters.size()),
+        .emitCount = emitCount,
+        .seed = frameSeed++,
+        .capacity = particleCapacity
+    };
+    particleBinders[destinationIndex].bind(commandBuffer, *pipelineLayout, 0, vk::PipelineBindPoint::eCompute);
+    frameBinders[currentFrameIndex].bind(commandBuffer, *pipelineLayout, 1, vk::PipelineBindPoint::eCompute);
+    commandBuffer.pushConstants(*pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(ParticlePushConstantData), &push);
+
+    const vk::MemoryBarrier computeBarrier{
+        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+    };
+
+    //Only as many groups as there were particles alive last frame, computed on the gpu by the finalize pass
+    simulatePipeline->bind(commandBuffer);
+    commandBuffer.dispatchIndirect(stateBuffer->getBuffer(), offsetof(ParticleState, simulateGroupCountX));
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, computeBarrier, {}, {}
+    );
+
+    if (emitCount > 0) {
+        emitPipeline->bind(commandBuffer);
+        commandBuffer.dispatch((emitCount + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, computeBarrier, {}, {}
+        );
+    }
+
+    finalizePipeline->bind(commandBuffer);
+    commandBuffer.dispatch(1, 1, 1);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader, {},
+        vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead},
+        {}, {}
+    );
+}
+
+void ParticleRenderSystem::render(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (shadingPath == ShadingPath::eDeferred) return;
+    recordDraw(commandBuffer, currentFrameIndex);
+}
+
+void ParticleRenderSystem::renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder) {
+    if (shadingPath != ShadingPath::eDeferred) return;
+    recordDraw(commandBuffer, currentFrameIndex);
+}
+
+//The instance count was written by the simulation, so the cpu never learns how many particles are alive
+void ParticleRenderSystem::recordDraw(vk::CommandBuffer commandBuffer, int currentFrameIndex) {
+    if (!pipelinesReady) return;
+    graphicsPipeline->bind(commandBuffer);
+    particleBinders[destinationIndex].bind(commandBuffer, *pipelineLayout, 0);
+    frameBinders[currentFrameIndex].bind(commandBuffer, *pipelineLayout, 1);
+    commandBuffer.drawIndirect(stateBuffer->getBuffer(), 0, 1, sizeof(vk::DrawIndirectCommand));
+}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Camera.h"
+#include "ComputePipeline.h"
+#include "GraphicsDevice.h"
+#include "GraphicsPipeline.h"
+#include "PerFrameBuffers.h"
+#include "Components.h"
+#include "PipelineCompiler.h"
+#include "RenderSystem.h"
+#include "ResourceBinder.h"
+#include "SwapChain.h"
+#include "World.h"
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace rkrai {
+//Particles are emitted, integrated and compacted by compute shaders into two storage buffers that swap roles
+//every frame, and drawn as camera facing quads with an indirect draw whose instance count the gpu wrote.
+//Particle data never goes through the host, only the emitters of entities with a ParticleEmitterComponent are uploaded every frame.
+class ParticleRenderSystem : public RenderSystem {
+public:
+    static constexpr uint32_t DEFAULT_PARTICLE_CAPACITY = 1 << 20;
+    static constexpr uint32_t INITIAL_EMITTER_CAPACITY = 16;
+
+    ParticleRenderSystem(
+        GraphicsDevice& device, PipelineCompiler& pipelineCompiler, vk::RenderPass renderPass, std::shared_ptr<const Camera> camera,
+        std::shared_ptr<World> world, std::shared_ptr<const SceneGraph> sceneGraph, ShadingPath shadingPath = ShadingPath::eForward, uint32_t particleCapacity = DEFAULT_PARTICLE_CAPACITY);
+    ParticleRenderSystem(const ParticleRenderSystem&) = delete;
+    void operator=(const ParticleRenderSystem&) = delete;
+
+    void setCamera(std::shared_ptr<const Camera> camera) { this->camera = camera; }
+
+private:
+    //Must match ParticleEmit.comp
+    struct Emitter {
+        glm::vec4 position{0.0f}; //w is the particle size
+        glm::vec4 velocity{0.0f}; //w is the random velocity spread
+        glm::vec4 acceleration{0.0f}; //w is the particle lifetime
+        glm::vec4 color{1.0f};
+        glm::uvec4 emission{0}; //x is the index of the emitter's first new particle this frame, y the count
+    };
+
+    void createBuffers();
+    void createResourceBinders();
+    void createPipelineLayout();
+    void createPipelines();
+    void updateEmitters(int currentFrameIndex, float deltaTime);
+    void prepare(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void render(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+    void renderLighting(vk::CommandBuffer commandBuffer, int currentFrameIndex, ResourceBinder& gBufferBinder);
+    void recordDraw(vk::CommandBuffer commandBuffer, int currentFrameIndex);
+
+    GraphicsDevice& graphicsDevice;
+    PipelineCompiler& pipelineCompiler;
+    vk::RenderPass renderPass;
+    ShadingPath shadingPath;
+    uint32_t particleCapacity;
+
+    std::shared_ptr<World> world;
+    std::shared_ptr<const Camera> camera;
+    std::shared_ptr<const SceneGraph> sceneGraph;
+
+    std::chrono::steady_clock::time_point lastUpdateTime;
+    uint32_t frameSeed = 0;
+    std::vector<Emitter> emitters;
+    uint32_t emitCount = 0;
+    bool pipelinesReady = false;
+
+    //The simulation reads one particle buffer and writes the other, which is then drawn
+    std::vector<GraphicsBuffer> particleBuffers;
+    uint32_t destinationIndex = 0;
+    std::optional<GraphicsBuffer> stateBuffer;
+    std::vector<GraphicsBuffer> uboBuffers;
+    PerFrameBuffers emitterBuffers;
+
+    //Set 0 holds the particle buffers, one binder per direction. Set 1 holds the per frame data.
+    std::vector<ResourceBinder> particleBinders;
+    std::vector<ResourceBinder> frameBinders;
+    vk::UniquePipelineLayout pipelineLayout;
+    PipelineHandle<ComputePipeline> simulatePipeline;
+    PipelineHandle<ComputePipeline> emitPipeline;
+    PipelineHandle<ComputePipeline> finalizePipeline;
+    PipelineHandle<GraphicsPipeline> graphicsPipeline;
+};
+}
\ No newline at end of file
@@ -20,37 +20,44 @@ ResourceBinder::ResourceBinder(GraphicsDevice& graphicsDevice, std::vector<Bindi
 }
 
 void ResourceBinder::setBuffer(uint32_t index, GraphicsBuffer* graphicsBuffer) {
-    std::optional<vk::DescriptorType> descriptorType;
-    for (const auto& binding : bindings) {
-        if (binding.index == index) {
-            descriptorType = binding.descriptorType;
-        }
-    }
-    if (!descriptorType) throw std::runtime_error("This binding index does not exist!");
+    vk::DescriptorType descriptorType = getDescriptorType(index);
 
     vk::DescriptorBufferInfo bufferInfo{graphicsBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
     graphicsDevice.getDevice().updateDescriptorSets(
-        vk::WriteDescriptorSet{descriptorSet, index, 0, *descriptorType, {}, bufferInfo}, {}
+        vk::WriteDescriptorSet{descriptorSet, index, 0, descriptorType, {}, bufferInfo}, {}
     );
 }
 
 void ResourceBinder::setTexture(uint32_t index, Texture* texture) {
-    std::optional<vk::DescriptorType> descriptorType;
-    for (const auto& binding : bindings) {
-        if (binding.index == index) {
-            descriptorType = binding.descriptorType;
-        }
-    }
-    if (!descriptorType) throw std::runtime_error("This binding index does not exist!");
+    vk::DescriptorType descriptorType = getDescriptorType(index);
 
     vk::DescriptorImageInfo imageInfo{texture->getSampler(), texture->getImageView(), vk::ImageLayout::eShaderReadOnlyOptimal};
     graphicsDevice.getDevice().updateDescriptorSets(
-        vk::WriteDescriptorSet{descriptorSet, index, 0, *descriptorType, imageInfo}, {}
+        vk::WriteDescriptorSet{descriptorSet, index, 0, descriptorType, imageInfo}, {}
     );
 }
 
-void ResourceBinder::bind(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t setNum) {
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, setNum, descriptorSet, {});
+void ResourceBinder::setImage(uint32_t index, vk::ImageView imageView, vk::Sampler sampler, vk::ImageLayout imageLayout) {
+    vk::DescriptorType descriptorType = getDescriptorType(index);
+
+    vk::DescriptorImageInfo imageInfo{sampler, imageView, imageLayout};
+    graphicsDevice.getDevice().updateDescriptorSets(
+        vk::WriteDescriptorSet{descriptorSet, index, 0, descriptorType, imageInfo}, {}
+    );
+}
+
+void ResourceBinder::bind(
+    vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t setNum, vk::PipelineBindPoint bindPoint) {
+    commandBuffer.bindDescriptorSets(bindPoint, pipelineLayout, setNum, descriptorSet, {});
+}
+
+vk::DescriptorType ResourceBinder::getDescriptorType(uint32_t index) {
+    for (const auto& binding : bindings) {
+        if (binding.index == index) {
+            return binding.descriptorType;
+        }
+    }
+    throw std::runtime_error("This binding index does not exist!");
 }
 
 void ResourceBinder::createDescriptorPool() {
@@ -64,7 +71,10 @@ void ResourceBinder::createDescriptorPool() {
 void ResourceBinder::createDescriptorSetLayout() {
     std::vector<vk::DescriptorSetLayoutBinding> setBindings;
     for (const Binding& binding : bindings) {
-        setBindings.emplace_back(binding.index, binding.descriptorType, binding.descriptorCount, vk::ShaderStageFlagBits::eAll);
+        //Input attachments can only ever be read from fragment shaders
+        vk::ShaderStageFlags stageFlags = binding.descriptorType == vk::DescriptorType::eInputAttachment
+            ? vk::ShaderStageFlags{vk::ShaderStageFlagBits::eFragment} : vk::ShaderStageFlags{vk::ShaderStageFlagBits::eAll};
+        setBindings.emplace_back(binding.index, binding.descriptorType, binding.descriptorCount, stageFlags);
     }
     descriptorSetLayout = graphicsDevice.getDevice().createDescriptorSetLayoutUnique({{}, setBindings});
 }
@@ -28,7 +28,10 @@ class ResourceBinder {
 
     void setBuffer(uint32_t index, GraphicsBuffer* graphicsBuffer);
     void setTexture(uint32_t index, Texture* texture);
-    void bind(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t setNum);
+    void setImage(uint32_t index, vk::ImageView imageView, vk::Sampler sampler, vk::ImageLayout imageLayout);
+    void bind(
+        vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t setNum,
+        vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
 
     vk::DescriptorSetLayout getSetLayout() { return *descriptorSetLayout; }
 
@@ -44,5 +47,6 @@ class ResourceBinder {
     void createDescriptorPool();
     void createDescriptorSetLayout();
     void allocateDescriptorSet();
+    vk::DescriptorType getDescriptorType(uint32_t index);
 };
 }
\ No newline at end of file
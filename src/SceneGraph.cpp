@@ -0,0 +1,201 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace rkrai {
+//Pointing a root's first child slot just past itself gives it an empty children range wherever it is in the order
+SceneGraph::NodeId SceneGraph::createNode(const TransformComponent& localTransform, NodeId parent) {
+    assert((parent == NO_NODE || (parent < nodeSlots.size() && nodeSlots[parent] != NO_SLOT)) && "Parent node doesn't exist");
+    NodeId node;
+    if (freeNodes.empty()) {
+        node = static_cast<NodeId>(nodeParents.size());
+        nodeParents.push_back(NO_NODE);
+        nodeSlots.push_back(NO_SLOT);
+        nodeChildCounts.push_back(0);
+    } else {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    const uint32_t slot = static_cast<uint32_t>(slotNodes.size());
+    nodeParents[node] = parent;
+    nodeSlots[node] = slot;
+    nodeChildCounts[node] = 0;
+
+    slotNodes.push_back(node);
+    parentSlots.push_back(NO_SLOT);
+    firstChildSlots.push_back(slot + 1);
+    childCounts.push_back(0);
+    localTransforms.resize(slot + 1);
+    localTransforms.set(slot, localTransform);
+    worldMatrices.push_back({glm::mat4{1.0f}, glm::mat4{1.0f}});
+    dirtyFlags.push_back(0);
+    markDirty(slot);
+    if (parent != NO_NODE) {
+        nodeChildCounts[parent]++;
+        layoutDirty = true;
+    }
+    return node;
+}
+
+//The last slot is popped if it's a root, any other slot is left behind until the order is rebuilt
+void SceneGraph::destroyNode(NodeId node) {
+    assert(node < nodeSlots.size() && nodeSlots[node] != NO_SLOT && "Node doesn't exist");
+    assert(nodeChildCounts[node] == 0 && "Nodes with children can't be destroyed");
+    const uint32_t slot = nodeSlots[node];
+    if (nodeParents[node] != NO_NODE) nodeChildCounts[nodeParents[node]]--;
+    nodeParents[node] = NO_NODE;
+    nodeSlots[node] = NO_SLOT;
+    freeNodes.push_back(node);
+
+    if (slot == slotNodes.size() - 1 && parentSlots[slot] == NO_SLOT && !layoutDirty) {
+        //Its dirty slot entry, if any, is skipped by the next update
+        slotNodes.pop_back();
+        parentSlots.pop_back();
+        firstChildSlots.pop_back();
+        childCounts.pop_back();
+        localTransforms.resize(slot);
+        worldMatrices.pop_back();
+        dirtyFlags.pop_back();
+        return;
+    }
+    slotNodes[slot] = NO_NODE;
+    dirtyFlags[slot] = 0;
+    if (++destroyedSlotCount * 2 > slotNodes.size()) layoutDirty = true;
+}
+
+void SceneGraph::setParent(NodeId node, NodeId parent) {
+    if (nodeParents[node] == parent) return;
+    for (NodeId ancestor = parent; ancestor != NO_NODE; ancestor = nodeParents[ancestor]) {
+        assert(ancestor != node && "A node can't be parented to itself or one of its descendants");
+    }
+    if (nodeParents[node] != NO_NODE) nodeChildCounts[nodeParents[node]]--;
+    if (parent != NO_NODE) nodeChildCounts[parent]++;
+    nodeParents[node] = parent;
+    markDirty(nodeSlots[node]);
+    layoutDirty = true;
+}
+
+void SceneGraph::setLocalTransform(NodeId node, const TransformComponent& localTransform) {
+    const uint32_t slot = nodeSlots[node];
+    localTransforms.set(slot, localTransform);
+    markDirty(slot);
+}
+
+void SceneGraph::markDirty(uint32_t slot) {
+    if (dirtyFlags[slot]) return;
+    dirtyFlags[slot] = 1;
+    dirtySlots.push_back(slot);
+}
+
+//Sorting the dirty slots puts every node before its descendants, so a subtree is updated from its topmost dirty node
+//and the dirty nodes below it are already clean by the time they come up.
+void SceneGraph::update() {
+    changedRanges.clear();
+    const bool layoutChanged = layoutDirty;
+    if (layoutDirty) {
+        rebuildLayout();
+        changedRanges.push_back({0, static_cast<uint32_t>(size())});
+    }
+
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    for (uint32_t slot : dirtySlots) {
+        if (slot >= slotNodes.size() || !dirtyFlags[slot]) continue;
+        //The children of a contiguous range of nodes are the contiguous range one level down
+        uint32_t first = slot;
+        uint32_t end = slot + 1;
+        while (first < end) {
+            updateRange(first, end);
+            if (!layoutChanged) changedRanges.push_back({first, end});
+            const uint32_t childrenEnd = firstChildSlots[end - 1] + childCounts[end - 1];
+            first = firstChildSlots[first];
+            end = childrenEnd;
+        }
+    }
+    dirtySlots.clear();
+    if (!changedRanges.empty()) changeCount++;
+}
+
+//World matrices are permuted along with the nodes, only the dirty ones get recomputed afterwards.
+//Slots of destroyed nodes are dropped.
+void SceneGraph::rebuildLayout() {
+    const uint32_t nodeCount = static_cast<uint32_t>(nodeParents.size());
+    const uint32_t liveCount = nodeCount - static_cast<uint32_t>(freeNodes.size());
+
+    //Children grouped by parent through a counting sort, each group in creation order
+    std::vector<uint32_t> childStarts(nodeCount + 1, 0);
+    std::vector<NodeId> order;
+    order.reserve(liveCount);
+    for (NodeId node = 0; node < nodeCount; node++) {
+        if (nodeSlots[node] == NO_SLOT) continue;
+        if (nodeParents[node] == NO_NODE) {
+            order.push_back(node);
+        } else {
+            childStarts[nodeParents[node] + 1]++;
+        }
+    }
+    for (NodeId node = 0; node < nodeCount; node++) {
+        childStarts[node + 1] += childStarts[node];
+    }
+    std::vector<NodeId> children(childStarts[nodeCount]);
+    std::vector<uint32_t> childCursors(childStarts.begin(), childStarts.end() - 1);
+    for (NodeId node = 0; node < nodeCount; node++) {
+        if (nodeSlots[node] != NO_SLOT && nodeParents[node] != NO_NODE) children[childCursors[nodeParents[node]]++] = node;
+    }
+
+    std::vector<uint32_t> newFirstChildSlots(liveCount);
+    std::vector<uint32_t> newChildCounts(liveCount);
+    for (uint32_t slot = 0; slot < order.size(); slot++) {
+        const NodeId node = order[slot];
+        newFirstChildSlots[slot] = static_cast<uint32_t>(order.size());
+        newChildCounts[slot] = childStarts[node + 1] - childStarts[node];
+        order.insert(order.end(), children.begin() + childStarts[node], children.begin() + childStarts[node + 1]);
+    }
+    assert(order.size() == liveCount && "Every node has to be reachable from a root");
+
+    TransformBatch newLocalTransforms;
+    newLocalTransforms.resize(liveCount);
+    std::vector<TransformBatch::Matrices> newWorldMatrices(liveCount);
+    std::vector<uint8_t> newDirtyFlags(liveCount);
+    dirtySlots.clear();
+    for (uint32_t slot = 0; slot < liveCount; slot++) {
+        const uint32_t oldSlot = nodeSlots[order[slot]];
+        newLocalTransforms.set(slot, localTransforms.get(oldSlot));
+        newWorldMatrices[slot] = worldMatrices[oldSlot];
+        newDirtyFlags[slot] = dirtyFlags[oldSlot];
+        if (newDirtyFlags[slot]) dirtySlots.push_back(slot);
+    }
+    std::vector<uint32_t> newParentSlots(liveCount);
+    for (uint32_t slot = 0; slot < liveCount; slot++) {
+        nodeSlots[order[slot]] = slot;
+    }
+    for (uint32_t slot = 0; slot < liveCount; slot++) {
+        const NodeId parent = nodeParents[order[slot]];
+        newParentSlots[slot] = parent == NO_NODE ? NO_SLOT : nodeSlots[parent];
+    }
+
+    slotNodes = std::move(order);
+    parentSlots = std::move(newParentSlots);
+    firstChildSlots = std::move(newFirstChildSlots);
+    childCounts = std::move(newChildCounts);
+    localTransforms = std::move(newLocalTransforms);
+    worldMatrices = std::move(newWorldMatrices);
+    dirtyFlags = std::move(newDirtyFlags);
+    layoutDirty = false;
+    destroyedSlotCount = 0;
+}
+
+//Local matrices are computed in one batch straight into the world matrices, and then multiplied by their parent's.
+//Normal matrices are inverse transposes, which compose the same way as the model matrices do.
+void SceneGraph::updateRange(uint32_t first, uint32_t end) {
+    localTransforms.computeMatrices(first, end - first, &worldMatrices[first]);
+    for (uint32_t slot = first; slot < end; slot++) {
+        dirtyFlags[slot] = 0;
+        const uint32_t parentSlot = parentSlots[slot];
+        if (parentSlot == NO_SLOT) continue;
+        auto& matrices = worldMatrices[slot];
+        matrices.modelMat = worldMatrices[parentSlot].modelMat * matrices.modelMat;
+        matrices.normalMat = worldMatrices[parentSlot].normalMat * matrices.normalMat;
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "TransformBatch.h"
+#include "TransformComponent.h"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace rkrai {
+//Parent-child transforms whose world matrices are cached and only recomputed for nodes that were changed and
+//everything below them. Nodes are kept in breadth-first order, so every node's children, and every level of a subtree,
+//are contiguous and get updated in one pass through memory. A frame in which nothing moved does no transform work at all.
+//Node ids stay the same for the node's lifetime, while its slot in the breadth-first order changes when the order
+//is rebuilt. That only happens when nodes are parented or reparented, or once half the slots belong to destroyed nodes.
+//Creating a root node and destroying a leaf node take constant time.
+class SceneGraph {
+    public:
+    using NodeId = uint32_t;
+    static constexpr NodeId NO_NODE = UINT32_MAX;
+
+    //Slots [first, end) of the breadth-first order
+    struct SlotRange {
+        uint32_t first;
+        uint32_t end;
+    };
+
+    SceneGraph() = default;
+    SceneGraph(const SceneGraph&) = delete;
+    void operator=(const SceneGraph&) = delete;
+
+    NodeId createNode(const TransformComponent& localTransform = {}, NodeId parent = NO_NODE);
+    //Only nodes without children can be destroyed, the id is reused by a later node
+    void destroyNode(NodeId node);
+    //The node keeps its local transform, so it moves to stay relative to the new parent
+    void setParent(NodeId node, NodeId parent);
+    NodeId getParent(NodeId node) const { return nodeParents[node]; }
+    TransformComponent getLocalTransform(NodeId node) const { return localTransforms.get(nodeSlots[node]); }
+    void setLocalTransform(NodeId node, const TransformComponent& localTransform);
+
+    //Brings the world matrices of every node changed since the last update up to date, meant to be called once per frame
+    void update();
+
+    //World space as of the last update
+    const glm::mat4& getWorldMatrix(NodeId node) const { return worldMatrices[nodeSlots[node]].modelMat; }
+    glm::vec3 getWorldPosition(NodeId node) const { return getWorldMatrix(node)[3]; }
+
+    size_t size() const { return slotNodes.size(); }
+    uint32_t getSlot(NodeId node) const { return nodeSlots[node]; }
+    //NO_NODE for slots of destroyed nodes that haven't been compacted away yet
+    NodeId getNode(uint32_t slot) const { return slotNodes[slot]; }
+    //Indexed by slot and laid out like the shaders' transform buffer, so it can be copied into it as is
+    const TransformBatch::Matrices* getWorldMatrices() const { return worldMatrices.data(); }
+    //The slots whose world matrices the last update changed, all of them if it had to rebuild the breadth-first order.
+    //The same slot can be part of several ranges.
+    const std::vector<SlotRange>& getChangedRanges() const { return changedRanges; }
+    //Counts the updates that changed anything. Users that read the changed ranges once per frame and see it skip a
+    //value have missed an update and have to treat every slot as changed.
+    uint64_t getChangeCount() const { return changeCount; }
+
+    private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    void markDirty(uint32_t slot);
+    void rebuildLayout();
+    void updateRange(uint32_t first, uint32_t end);
+
+    //Indexed by node id, destroyed nodes have no slot
+    std::vector<NodeId> nodeParents;
+    std::vector<uint32_t> nodeSlots;
+    std::vector<uint32_t> nodeChildCounts;
+    std::vector<NodeId> freeNodes;
+
+    //Indexed by slot
+    std::vector<NodeId> slotNodes;
+    std::vector<uint32_t> parentSlots;
+    //The slot children would start at even for nodes without any, which keeps it increasing along the slots
+    std::vector<uint32_t> firstChildSlots;
+    std::vector<uint32_t> childCounts;
+    TransformBatch localTransforms;
+    std::vector<TransformBatch::Matrices> worldMatrices;
+    std::vector<uint8_t> dirtyFlags;
+
+    //Slots whose local transform changed, nodes below them aren't listed
+    std::vector<uint32_t> dirtySlots;
+    //Set by parenting and reparenting nodes, such nodes are appended out of order until the next update.
+    //New root nodes are appended for good, without children their place in the order doesn't matter.
+    bool layoutDirty = false;
+    uint32_t destroyedSlotCount = 0;
+    std::vector<SlotRange> changedRanges;
+    uint64_t changeCount = 0;
+};
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "SimulationLoop.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace rkrai {
+SimulationLoop::SimulationLoop(float tickRate, TickFunction tick)
+    : tick(std::move(tick)),
+    tickDuration(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate))) {
+    assert(tickRate > 0.0f && "Tick rate must be positive");
+    thread = std::thread(&SimulationLoop::run, this);
+}
+
+SimulationLoop::~SimulationLoop() {
+    {
+        std::lock_guard lock(stopMutex);
+        stopping = true;
+    }
+    stopCondition.notify_one();
+    thread.join();
+}
+
+//Ticks are scheduled on a fixed grid, a tick that ran long is made up for by sleeping less before the next one
+void SimulationLoop::run() {
+    const float dt = std::chrono::duration<float>(tickDuration).count();
+    Clock::time_point tickTime = Clock::now();
+    std::unique_lock lock(stopMutex);
+    while (!stopping) {
+        lock.unlock();
+        SimulationSnapshot& snapshot = snapshots[writeSlot];
+        snapshot.nodeTransforms.clear();
+        tick(dt, snapshot);
+        snapshot.tick = tickCount.load(std::memory_order_relaxed);
+        snapshot.time = tickTime + tickDuration;
+        //Whatever was in the shared slot, either stale or never taken, is written next
+        writeSlot = sharedSlot.exchange(writeSlot | FRESH_FLAG, std::memory_order_acq_rel) & ~FRESH_FLAG;
+        tickCount.fetch_add(1, std::memory_order_relaxed);
+
+        tickTime += tickDuration;
+        const Clock::time_point now = Clock::now();
+        if (now - tickTime > MAX_TICKS_BEHIND * tickDuration) tickTime = now;
+        lock.lock();
+        stopCondition.wait_until(lock, tickTime, [&] { return stopping; });
+    }
+}
+
+//The oldest snapshot the render thread holds goes back to the simulation thread in exchange for the newest one
+bool SimulationLoop::acquireSnapshot() {
+    if ((sharedSlot.load(std::memory_order_relaxed) & FRESH_FLAG) == 0) return false;
+    const uint32_t freshSlot = sharedSlot.exchange(previousSlot, std::memory_order_acq_rel) & ~FRESH_FLAG;
+    previousSlot = currentSlot;
+    currentSlot = freshSlot;
+    acquiredCount = std::min(acquiredCount + 1, 2u);
+    return true;
+}
+
+//Interpolates across several ticks when frames are slower than ticks, the ones in between were never acquired.
+//Nodes are only touched if their transform actually changes, so that the scene graph skips everything else.
+bool SimulationLoop::interpolate(SceneGraph& sceneGraph, TransformComponent& cameraTransform) {
+    acquireSnapshot();
+    if (acquiredCount == 0) return false;
+    const SimulationSnapshot& current = snapshots[currentSlot];
+    const SimulationSnapshot& previous = acquiredCount > 1 ? snapshots[previousSlot] : current;
+
+    float alpha = 1.0f;
+    if (current.time > previous.time) {
+        //Snapshots are stamped a tick after they were simulated, which already puts the present one tick in the past
+        const Clock::time_point renderTime = Clock::now();
+        alpha = std::chrono::duration<float>(renderTime - previous.time).count()
+            / std::chrono::duration<float>(current.time - previous.time).count();
+        alpha = std::clamp(alpha, 0.0f, 1.0f);
+    }
+
+    cameraTransform = TransformComponent::interpolate(previous.cameraTransform, current.cameraTransform, alpha);
+    for (size_t i = 0; i < current.nodeTransforms.size(); i++) {
+        const auto& [node, transform] = current.nodeTransforms[i];
+        TransformComponent localTransform = transform;
+        if (i < previous.nodeTransforms.size() && previous.nodeTransforms[i].first == node) {
+            localTransform = TransformComponent::interpolate(previous.nodeTransforms[i].second, transform, alpha);
+        }
+        if (sceneGraph.getLocalTransform(node) != localTransform) sceneGraph.setLocalTransform(node, localTransform);
+    }
+    return true;
+}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "SceneGraph.h"
+#include "TransformComponent.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rkrai {
+//Everything the render thread needs from one simulation tick
+struct SimulationSnapshot {
+    uint64_t tick = 0;
+    //When the simulated state is meant to be seen
+    std::chrono::steady_clock::time_point time{};
+    TransformComponent cameraTransform{};
+    //Local transforms of the scene graph nodes the simulation moves. Listing them in the same order every tick lets
+    //consecutive snapshots be interpolated pairwise, nodes that aren't listed keep whatever transform they have.
+    std::vector<std::pair<SceneGraph::NodeId, TransformComponent>> nodeTransforms;
+};
+
+//Runs the simulation at a fixed tick rate on its own thread, so gameplay neither speeds up nor stalls with the frame rate
+//and overlaps with rendering on another core. Every tick fills a snapshot, which is handed to the render thread through
+//a lock free buffer of four, so neither thread ever waits for the other. The render thread shows the state one tick in
+//the past, interpolated between the snapshots around that time, which keeps motion smooth at any frame rate.
+//The tick function must only touch state the simulation owns, the World and SceneGraph belong to the render thread.
+class SimulationLoop {
+    public:
+    using Clock = std::chrono::steady_clock;
+    //A simulation that falls further behind than this drops the ticks it missed instead of trying to catch up
+    static constexpr uint32_t MAX_TICKS_BEHIND = 5;
+
+    //Called on the simulation thread with the tick length in seconds and the snapshot to fill. The snapshot starts out
+    //without node transforms, everything else is left over from an earlier tick.
+    using TickFunction = std::function<void(float dt, SimulationSnapshot& snapshot)>;
+
+    //Starts ticking right away
+    SimulationLoop(float tickRate, TickFunction tick);
+    ~SimulationLoop();
+    SimulationLoop(const SimulationLoop&) = delete;
+    void operator=(const SimulationLoop&) = delete;
+
+    //Only callable from the render thread, once per frame and before the scene graph is updated. Writes the
+    //interpolated state to the scene graph and camera transform, returns false if nothing has been simulated yet.
+    //The listed nodes must not be destroyed while the snapshot holding them is still in use.
+    bool interpolate(SceneGraph& sceneGraph, TransformComponent& cameraTransform);
+
+    uint64_t getTickCount() const { return tickCount.load(std::memory_order_relaxed); }
+    Clock::duration getTickDuration() const { return tickDuration; }
+
+    private:
+    static constexpr uint32_t SNAPSHOT_COUNT = 4;
+    //Set on the shared slot while it holds a snapshot the render thread hasn't taken yet
+    static constexpr uint32_t FRESH_FLAG = 1u << 31;
+
+    void run();
+    bool acquireSnapshot();
+
+    TickFunction tick;
+    Clock::duration tickDuration;
+    std::atomic<uint64_t> tickCount{0};
+
+    //The simulation thread writes one snapshot and the render thread reads two, the remaining one is passed between them
+    std::array<SimulationSnapshot, SNAPSHOT_COUNT> snapshots;
+    uint32_t writeSlot = 0;
+    std::atomic<uint32_t> sharedSlot{1};
+    uint32_t currentSlot = 2;
+    uint32_t previousSlot = 3;
+    uint32_t acquiredCount = 0;
+
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopping = false;
+    std::thread thread;
+};
+}
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "SoftwareOcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RKRAI_SOFTWARE_OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace rkrai {
+SoftwareOcclusionCuller::SoftwareOcclusionCuller(std::shared_ptr<JobSystem> jobSystem, uint32_t width, uint32_t height)
+    : width((width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE), height((height + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE),
+    jobSystem(std::move(jobSystem)) {
+    tilesX = this->width / TILE_SIZE;
+    tilesY = this->height / TILE_SIZE;
+    depthBuffer.assign(this->width * this->height, 1.0f);
+    tileMaxDepth.assign(tilesX * tilesY, 1.0f);
+
+    triangles.resize(this->jobSystem->getWorkerCount());
+    tileBins.resize(this->jobSystem->getWorkerCount(), std::vector<std::vector<uint32_t>>(tilesX * tilesY));
+}
+
+void SoftwareOcclusionCuller::renderOccluders(const glm::mat4& projView, const std::vector<Occluder>& occluders) {
+    this->projView = projView;
+    for (uint32_t i = 0; i < triangles.size(); i++) {
+        triangles[i].clear();
+        for (auto& bin : tileBins[i]) bin.clear();
+    }
+
+    jobSystem->parallelFor(static_cast<uint32_t>(occluders.size()), [&](uint32_t index, uint32_t workerIndex) {
+        setupTriangles(workerIndex, occluders[index]);
+    }, 1, "SetupOccluders");
+    jobSystem->parallelFor(tilesX * tilesY, [&](uint32_t tileIndex, uint32_t) {
+        rasterizeTile(tileIndex);
+    }, 1, "RasterizeOcclusionTiles");
+}
+
+//Triangles are clipped against the near plane only, everything else is handled by clamping to the screen
+void SoftwareOcclusionCuller::setupTriangles(uint32_t workerIndex, const Occluder& occluder) {
+    const glm::mat4 mvp = projView * occluder.modelMatrix;
+    const auto& vertices = occluder.mesh->vertices;
+    const auto& indices = occluder.mesh->indices;
+
+    std::vector<glm::vec4> clipVertices;
+    clipVertices.reserve(vertices.size());
+    for (const auto& vertex : vertices) {
+        clipVertices.push_back(mvp * glm::vec4{vertex, 1.0f});
+    }
+
+    glm::vec4 input[4];
+    glm::vec4 output[4];
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        input[0] = clipVertices[indices[i]];
+        input[1] = clipVertices[indices[i + 1]];
+        input[2] = clipVertices[indices[i + 2]];
+
+        if (input[0].z >= 0.0f && input[1].z >= 0.0f && input[2].z >= 0.0f) {
+            addTriangle(workerIndex, input[0], input[1], input[2]);
+            continue;
+        }
+
+        //Sutherland-Hodgman against z >= 0, a triangle clipped by one plane has at most 4 vertices
+        uint32_t outputCount = 0;
+        for (uint32_t j = 0; j < 3; j++) {
+            const glm::vec4& current = input[j];
+            const glm::vec4& next = input[(j + 1) % 3];
+            if (current.z >= 0.0f) output[outputCount++] = current;
+            if ((current.z >= 0.0f) != (next.z >= 0.0f)) {
+                float t = current.z / (current.z - next.z);
+                output[outputCount++] = current + t * (next - current);
+            }
+        }
+        for (uint32_t j = 2; j < outputCount; j++) {
+            addTriangle(workerIndex, output[0], output[j - 1], output[j]);
+        }
+    }
+}
+
+void SoftwareOcclusionCuller::addTriangle(uint32_t workerIndex, const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2) {
+    const glm::vec4* clip[3] = {&v0, &v1, &v2};
+    glm::vec3 screen[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        if (clip[i]->w <= 0.0f) return;
+        glm::vec3 ndc = glm::vec3{*clip[i]} / clip[i]->w;
+        screen[i] = {(ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z};
+    }
+
+    ScreenTriangle triangle;
+    for (uint32_t i = 0; i < 3; i++) {
+        const glm::vec3& start = screen[(i + 1) % 3];
+        const glm::vec3& end = screen[(i + 2) % 3];
+        triangle.a[i] = start.y - end.y;
+        triangle.b[i] = end.x - start.x;
+        triangle.c[i] = start.x * end.y - start.y * end.x;
+    }
+    float area = triangle.a[0] * screen[0].x + triangle.b[0] * screen[0].y + triangle.c[0];
+    if (std::abs(area) < 1e-6f) return;
+    //Occluders are rendered double sided, so flip clockwise triangles to keep the inside positive
+    if (area < 0.0f) {
+        for (uint32_t i = 0; i < 3; i++) {
+            triangle.a[i] = -triangle.a[i];
+            triangle.b[i] = -triangle.b[i];
+            triangle.c[i] = -triangle.c[i];
+        }
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        triangle.ownsEdge[i] = triangle.a[i] > 0.0f || (triangle.a[i] == 0.0f && triangle.b[i] > 0.0f);
+    }
+    triangle.depth = std::max({screen[0].z, screen[1].z, screen[2].z});
+
+    glm::vec2 minPoint = glm::min(glm::min(glm::vec2{screen[0]}, glm::vec2{screen[1]}), glm::vec2{screen[2]});
+    glm::vec2 maxPoint = glm::max(glm::max(glm::vec2{screen[0]}, glm::vec2{screen[1]}), glm::vec2{screen[2]});
+    triangle.minX = std::max(0, static_cast<int>(std::floor(minPoint.x)));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(minPoint.y)));
+    triangle.maxX = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(maxPoint.x)));
+    triangle.maxY = std::min(static_cast<int>(height) - 1, static_cast<int>(std::ceil(maxPoint.y)));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+    auto& workerTriangles = triangles[workerIndex];
+    const uint32_t triangleIndex = static_cast<uint32_t>(workerTriangles.size());
+    workerTriangles.push_back(triangle);
+    for (int tileY = triangle.minY / static_cast<int>(TILE_SIZE); tileY <= triangle.maxY / static_cast<int>(TILE_SIZE); tileY++) {
+        for (int tileX = triangle.minX / static_cast<int>(TILE_SIZE); tileX <= triangle.maxX / static_cast<int>(TILE_SIZE); tileX++) {
+            tileBins[workerIndex][tileY * tilesX + tileX].push_back(triangleIndex);
+        }
+    }
+}
+
+//Pixels are covered when their center is inside, ties on an edge only go to the triangle that owns it
+void SoftwareOcclusionCuller::rasterizeTile(uint32_t tileIndex) {
+    const int tileMinX = static_cast<int>(tileIndex % tilesX * TILE_SIZE);
+    const int tileMinY = static_cast<int>(tileIndex / tilesX * TILE_SIZE);
+    const int tileMaxX = tileMinX + static_cast<int>(TILE_SIZE) - 1;
+    const int tileMaxY = tileMinY + static_cast<int>(TILE_SIZE) - 1;
+
+    for (int y = tileMinY; y <= tileMaxY; y++) {
+        std::fill_n(depthBuffer.data() + y * width + tileMinX, TILE_SIZE, 1.0f);
+    }
+
+    for (uint32_t workerIndex = 0; workerIndex < triangles.size(); workerIndex++) {
+        for (uint32_t triangleIndex : tileBins[workerIndex][tileIndex]) {
+            const ScreenTriangle& triangle = triangles[workerIndex][triangleIndex];
+            //Rows are walked in groups of 4, the tile size keeps those groups inside the tile
+            const int minX = std::max(triangle.minX, tileMinX) & ~3;
+            const int maxX = std::min(triangle.maxX, tileMaxX);
+            const int minY = std::max(triangle.minY, tileMinY);
+            const int maxY = std::min(triangle.maxY, tileMaxY);
+
+#ifdef RKRAI_SOFTWARE_OCCLUSION_SSE
+            const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 triangleDepth = _mm_set1_ps(triangle.depth);
+            __m128 a[3];
+            __m128 ownsEdge[3];
+            for (uint32_t i = 0; i < 3; i++) {
+                a[i] = _mm_set1_ps(triangle.a[i]);
+                ownsEdge[i] = _mm_castsi128_ps(_mm_set1_epi32(triangle.ownsEdge[i] ? -1 : 0));
+            }
+            auto insideEdge = [&](uint32_t i, __m128 pixelX, __m128 rowTerm) {
+                const __m128 edge = _mm_add_ps(_mm_mul_ps(a[i], pixelX), rowTerm);
+                return _mm_or_ps(_mm_cmpgt_ps(edge, _mm_setzero_ps()), _mm_and_ps(_mm_cmpeq_ps(edge, _mm_setzero_ps()), ownsEdge[i]));
+            };
+
+            for (int y = minY; y <= maxY; y++) {
+                float* row = depthBuffer.data() + y * width;
+                const float pixelY = y + 0.5f;
+                __m128 rowTerm[3];
+                for (uint32_t i = 0; i < 3; i++) rowTerm[i] = _mm_set1_ps(triangle.b[i] * pixelY + triangle.c[i]);
+
+                for (int x = minX; x <= maxX; x += 4) {
+                    const __m128 pixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+                    const __m128 inside = _mm_and_ps(
+                        _mm_and_ps(insideEdge(0, pixelX, rowTerm[0]), insideEdge(1, pixelX, rowTerm[1])),
+                        insideEdge(2, pixelX, rowTerm[2])
+                    );
+                    if (_mm_movemask_ps(inside) == 0) continue;
+
+                    const __m128 oldDepth = _mm_loadu_ps(row + x);
+                    const __m128 newDepth = _mm_min_ps(oldDepth, triangleDepth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, newDepth), _mm_andnot_ps(inside, oldDepth)));
+                }
+            }
+#else
+            for (int y = minY; y <= maxY; y++) {
+                float* row = depthBuffer.data() + y * width;
+                const float pixelY = y + 0.5f;
+                for (int x = minX; x <= maxX; x++) {
+                    const float pixelX = x + 0.5f;
+                    bool inside = true;
+                    for (uint32_t i = 0; i < 3; i++) {
+                        const float edge = triangle.a[i] * pixelX + triangle.b[i] * pixelY + triangle.c[i];
+                        inside = inside && (edge > 0.0f || (edge == 0.0f && triangle.ownsEdge[i]));
+                    }
+                    if (inside) row[x] = std::min(row[x], triangle.depth);
+                }
+            }
+#endif
+        }
+    }
+
+    float maxDepth = 0.0f;
+    for (int y = tileMinY; y <= tileMaxY; y++) {
+        const float* row = depthBuffer.data() + y * width + tileMinX;
+        maxDepth = std::max(maxDepth, *std::max_element(row, row + TILE_SIZE));
+    }
+    tileMaxDepth[tileIndex] = maxDepth;
+}
+
+bool SoftwareOcclusionCuller::isVisible(const AABB& bounds) const {
+    glm::vec2 minPoint{std::numeric_limits<float>::max()};
+    glm::vec2 maxPoint{std::numeric_limits<float>::lowest()};
+    float nearestDepth = 1.0f;
+    for (uint32_t i = 0; i < 8; i++) {
+        glm::vec3 corner{
+            i & 1 ? bounds.max.x : bounds.min.x,
+            i & 2 ? bounds.max.y : bounds.min.y,
+            i & 4 ? bounds.max.z : bounds.min.z
+        };
+        glm::vec4 clip = projView * glm::vec4{corner, 1.0f};
+        //Bounds crossing the near plane are too close to say anything about
+        if (clip.z < 0.0f || clip.w <= 0.0f) return true;
+
+        glm::vec3 ndc = glm::vec3{clip} / clip.w;
+        glm::vec2 screen{(ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height};
+        minPoint = glm::min(minPoint, screen);
+        maxPoint = glm::max(maxPoint, screen);
+        nearestDepth = std::min(nearestDepth, ndc.z);
+    }
+
+    const int minX = std::max(0, static_cast<int>(std::floor(minPoint.x)));
+    const int minY = std::max(0, static_cast<int>(std::floor(minPoint.y)));
+    const int maxX = std::min(static_cast<int>(width) - 1, static_cast<int>(std::floor(maxPoint.x)));
+    const int maxY = std::min(static_cast<int>(height) - 1, static_cast<int>(std::floor(maxPoint.y)));
+    if (minX > maxX || minY > maxY) return false;
+
+    for (int tileY = minY / static_cast<int>(TILE_SIZE); tileY <= maxY / static_cast<int>(TILE_SIZE); tileY++) {
+        for (int tileX = minX / static_cast<int>(TILE_SIZE); tileX <= maxX / static_cast<int>(TILE_SIZE); tileX++) {
+            const uint32_t tileIndex = tileY * tilesX + tileX;
+            //Everything in this tile is closer than the bounds
+            if (nearestDepth > tileMaxDepth[tileIndex]) continue;
+            if (testTile(tileIndex, minX, minY, maxX, maxY, nearestDepth)) return true;
+        }
+    }
+    return false;
+}
+
+//Testing a few extra pixels to the left only makes the result more conservative
+bool SoftwareOcclusionCuller::testTile(uint32_t tileIndex, int minX, int minY, int maxX, int maxY, float nearestDepth) const {
+    const int tileMinX = static_cast<int>(tileIndex % tilesX * TILE_SIZE);
+    const int tileMinY = static_cast<int>(tileIndex / tilesX * TILE_SIZE);
+    const int startX = std::max(minX, tileMinX) & ~3;
+    const int endX = std::min(maxX, tileMinX + static_cast<int>(TILE_SIZE) - 1);
+    const int startY = std::max(minY, tileMinY);
+    const int endY = std::min(maxY, tileMinY + static_cast<int>(TILE_SIZE) - 1);
+
+#ifdef RKRAI_SOFTWARE_OCCLUSION_SSE
+    const __m128 nearest = _mm_set1_ps(nearestDepth);
+    for (int y = startY; y <= endY; y++) {
+        const float* row = depthBuffer.data() + y * width;
+        for (int x = startX; x <= endX; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), nearest)) != 0) return true;
+        }
+    }
+#else
+    for (int y = startY; y <= endY; y++) {
+        const float* row = depthBuffer.data() + y * width;
+        for (int x = startX; x <= endX; x++) {
+            if (row[x] >= nearestDepth) return true;
+        }
+    }
+#endif
+    return false;
+}
+}
\ No newline at end of file
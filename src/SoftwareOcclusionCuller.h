@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Components.h"
+#include "JobSystem.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rkrai {
+//Rasterizes occluder meshes into a small depth buffer on the cpu and tests bounds against it.
+//The buffer is split into tiles: triangles are binned per tile while they are set up, then every
+//tile is rasterized independently (4 pixels at a time with SSE) and reduced to its farthest depth,
+//which lets most visibility tests finish without touching individual pixels.
+class SoftwareOcclusionCuller {
+    public:
+    static constexpr uint32_t TILE_SIZE = 32;
+
+    struct Occluder {
+        const OccluderComponent* mesh;
+        glm::mat4 modelMatrix;
+    };
+
+    SoftwareOcclusionCuller(std::shared_ptr<JobSystem> jobSystem, uint32_t width = 320, uint32_t height = 192);
+    SoftwareOcclusionCuller(const SoftwareOcclusionCuller&) = delete;
+    void operator=(const SoftwareOcclusionCuller&) = delete;
+
+    void renderOccluders(const glm::mat4& projView, const std::vector<Occluder>& occluders);
+    //Conservative, bounds are only reported as hidden if every pixel they cover is behind an occluder
+    bool isVisible(const AABB& bounds) const;
+
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    const std::vector<float>& getDepthBuffer() const { return depthBuffer; }
+
+    private:
+    //Edge functions are stored as a * x + b * y + c, positive inside the triangle
+    struct ScreenTriangle {
+        float a[3];
+        float b[3];
+        float c[3];
+        bool ownsEdge[3]; //Pixels exactly on a shared edge belong to one of the two triangles
+        float depth; //Farthest vertex depth, which keeps the occluder conservative
+        int minX, minY, maxX, maxY;
+    };
+
+    void setupTriangles(uint32_t workerIndex, const Occluder& occluder);
+    void addTriangle(uint32_t workerIndex, const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+    void rasterizeTile(uint32_t tileIndex);
+    bool testTile(uint32_t tileIndex, int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    glm::mat4 projView{1.0f};
+
+    std::vector<float> depthBuffer;
+    std::vector<float> tileMaxDepth;
+    //Indexed by worker, so that setup never needs to lock
+    std::vector<std::vector<ScreenTriangle>> triangles;
+    std::vector<std::vector<std::vector<uint32_t>>> tileBins;
+
+    std::shared_ptr<JobSystem> jobSystem;
+};
+}
\ No newline at end of file
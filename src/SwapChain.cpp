@@ -1,31 +1,32 @@
 #include "SwapChain.h"
-#include "Image.h"
-#include "ImageView.h"
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_structs.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cassert>
 
 namespace rkrai {
-SwapChain::SwapChain(GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent) 
-    :  graphicsDevice(graphicsDevice), windowExtent(windowExtent) {
+SwapChain::SwapChain(GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent, const PresentationSettings& settings) 
+    :  graphicsDevice(graphicsDevice), windowExtent(windowExtent), settings(settings) {
     init();
 }
 
-SwapChain::SwapChain(GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent, std::shared_ptr<SwapChain> previous) 
-    :  graphicsDevice(graphicsDevice), windowExtent(windowExtent), oldSwapChain(previous) {
+SwapChain::SwapChain(
+    GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent, const PresentationSettings& settings, std::shared_ptr<SwapChain> previous) 
+    :  graphicsDevice(graphicsDevice), windowExtent(windowExtent), settings(settings), oldSwapChain(previous) {
     init();
     oldSwapChain = nullptr; //Clean up old swap chain
 }
 
 void SwapChain::init() {
+    assert(settings.framesInFlight >= 1 && settings.framesInFlight <= static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) && "Unsupported number of frames in flight");
+    presentWaitEnabled = settings.maxQueuedPresents.has_value() && graphicsDevice.supportsPresentWait();
     createSwapChain();
     createImageViews();
-    createDepthResources();
-    createRenderPass();
-    createFramebuffers();
+    swapChainDepthFormat = findDepthFormat();
     createSyncObjects();
 }
 
@@ -40,7 +41,7 @@ vk::SurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<vk::Su
 
 vk::PresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == vk::PresentModeKHR::eMailbox) {
+        if (availablePresentMode == settings.presentMode) {
             return availablePresentMode;
         }
     }
@@ -62,16 +63,18 @@ vk::Format SwapChain::findDepthFormat() {
     return graphicsDevice.findSupportedFormat(
         {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint},
         vk::ImageTiling::eOptimal,
-        vk::FormatFeatureFlagBits::eDepthStencilAttachment
+        vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage
     );
 }
 
 void SwapChain::createSwapChain() {
     SwapChainSupportDetails swapChainSupport = graphicsDevice.getSwapChainSupportDetails();
     vk::SurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.surfaceFormats);
-    vk::PresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     vk::Extent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    uint32_t imageCount = settings.imageCount == 0
+        ? swapChainSupport.capabilities.minImageCount + 1
+        : std::max(settings.imageCount, swapChainSupport.capabilities.minImageCount);
 
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -84,7 +87,11 @@ void SwapChain::createSwapChain() {
     swapChainInfo.imageColorSpace = surfaceFormat.colorSpace;
     swapChainInfo.imageExtent = extent;
     swapChainInfo.imageArrayLayers = 1;
+    //Scaled renders are blitted into the images instead of drawn into them
     swapChainInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (swapChainSupport.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst) {
+        swapChainInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
 
     QueueFamilyIndices indices = graphicsDevice.getQueueFamilyIndices();
     std::array<u_int32_t, 2> queueFamilyIndices{indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -106,6 +113,7 @@ void SwapChain::createSwapChain() {
     swapChainImages = graphicsDevice.getDevice().getSwapchainImagesKHR(*swapChain);
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
+    imageUsage = swapChainInfo.imageUsage;
 }
 
 void SwapChain::createImageViews() {
@@ -119,101 +127,36 @@ void SwapChain::createImageViews() {
     }
 }
 
-void SwapChain::createDepthResources() {
-    swapChainDepthFormat = findDepthFormat();
-
-    for (int i = 0; i < getImageCount(); i++) {
-        depthImages.emplace_back(
-            graphicsDevice,
-            vk::ImageType::e2D,
-            vk::Extent3D{swapChainExtent.width, swapChainExtent.height, 1},
-            swapChainDepthFormat,
-            vk::ImageUsageFlagBits::eDepthStencilAttachment
-        );
-
-        depthImageViews.emplace_back(depthImages[i], vk::ImageAspectFlagBits::eDepth);
-    }
-}
-
-void SwapChain::createRenderPass() {
-    vk::AttachmentDescription depthAttachment{};
-    depthAttachment.format = swapChainDepthFormat;
-    depthAttachment.samples = vk::SampleCountFlagBits::e1;
-    depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
-    depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
-    depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-    depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-    depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
-    depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-    vk::AttachmentReference depthAttachmentRef{1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-
-    vk::AttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainImageFormat;
-    colorAttachment.samples = vk::SampleCountFlagBits::e1;
-    colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
-    colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-    colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-    colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-    colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-    colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
-
-    vk::AttachmentReference colorAttachmentRef{0, vk::ImageLayout::eColorAttachmentOptimal};
-
-    vk::SubpassDescription subpass{};
-    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-    subpass.setColorAttachments(colorAttachmentRef);
-    subpass.setPDepthStencilAttachment(&depthAttachmentRef);
-
-    vk::SubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
-    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
-    dependency.srcAccessMask = {};
-    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-
-    std::array<vk::AttachmentDescription, 2> attachments{colorAttachment, depthAttachment};
-
-    renderPass = graphicsDevice.getDevice().createRenderPassUnique({{}, attachments, subpass, dependency});
-}
-
-void SwapChain::createFramebuffers() {
-    swapChainFramebuffers.resize(swapChainImageViews.size());
-
-    for (int i = 0; i < swapChainImageViews.size(); i++) {
-        std::array<vk::ImageView, 2> attachments{ *swapChainImageViews[i], depthImageViews[i].getImageView() };
-        swapChainFramebuffers[i] = graphicsDevice.getDevice().createFramebufferUnique({
-            {}, *renderPass, attachments, swapChainExtent.width, swapChainExtent.height, 1
-        });
+std::vector<vk::ImageView> SwapChain::getImageViews() const {
+    std::vector<vk::ImageView> imageViews;
+    for (const auto& imageView : swapChainImageViews) {
+        imageViews.push_back(*imageView);
     }
+    return imageViews;
 }
 
 void SwapChain::createSyncObjects() {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFrameFences.resize(MAX_FRAMES_IN_FLIGHT);
     imagesInFlight.resize(swapChainImages.size(), {});
 
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         imageAvailableSemaphores[i] = graphicsDevice.getDevice().createSemaphoreUnique({});
         renderFinishedSemaphores[i] = graphicsDevice.getDevice().createSemaphoreUnique({});
-        inFlightFrameFences[i] = graphicsDevice.getDevice().createFenceUnique({vk::FenceCreateFlagBits::eSignaled});
     }
 }
 
-vk::ResultValue<uint32_t> SwapChain::acquireNextImage() {
-    graphicsDevice.getDevice().waitForFences(*inFlightFrameFences[currentFrame], VK_TRUE, UINT64_MAX);
+vk::ResultValue<uint32_t> SwapChain::acquireNextImage(int frameIndex) {
     try {
         vk::ResultValue<uint32_t> result = graphicsDevice.getDevice().acquireNextImageKHR(
-            *swapChain, UINT64_MAX, *imageAvailableSemaphores[currentFrame]
+            *swapChain, UINT64_MAX, *imageAvailableSemaphores[frameIndex]
         );
 
         uint32_t imageIndex = result.value;
         if (imagesInFlight[imageIndex]) {
             graphicsDevice.getDevice().waitForFences(imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
         }
-        imagesInFlight[imageIndex] = *inFlightFrameFences[currentFrame];
+        imagesInFlight[imageIndex] = graphicsDevice.getFrameFence(frameIndex);
 
         return result;
     } catch (const vk::OutOfDateKHRError& error) {
@@ -221,25 +164,38 @@ vk::ResultValue<uint32_t> SwapChain::acquireNextImage() {
     }
 }
 
-void SwapChain::submitDrawCommands(const vk::CommandBuffer& buffer) {
-    std::vector<vk::Semaphore> waitSemaphores = { *imageAvailableSemaphores[currentFrame] };
+void SwapChain::submitDrawCommands(const vk::CommandBuffer& buffer, int frameIndex) {
+    std::vector<vk::Semaphore> waitSemaphores = { *imageAvailableSemaphores[frameIndex] };
     std::vector<vk::PipelineStageFlags> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-    std::vector<vk::Semaphore> signalSemaphores = { *renderFinishedSemaphores[currentFrame] };
+    std::vector<vk::Semaphore> signalSemaphores = { *renderFinishedSemaphores[frameIndex] };
 
     vk::SubmitInfo submitInfo{waitSemaphores, waitStages, buffer, signalSemaphores};
 
-    graphicsDevice.getDevice().resetFences(*inFlightFrameFences[currentFrame]);
-    graphicsDevice.getGraphicsQueue().submit(submitInfo, *inFlightFrameFences[currentFrame]);
+    graphicsDevice.submitFrame(frameIndex, submitInfo);
 }
 
-vk::Result SwapChain::presentImage(uint32_t imageIndex) {
-    vk::PresentInfoKHR presentInfo{*renderFinishedSemaphores[currentFrame], *swapChain, imageIndex};
-    
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+vk::Result SwapChain::presentImage(uint32_t imageIndex, int frameIndex) {
+    vk::PresentInfoKHR presentInfo{*renderFinishedSemaphores[frameIndex], *swapChain, imageIndex};
+    const uint64_t presentId = ++presentCount;
+    vk::PresentIdKHR presentIdInfo{};
+    if (presentWaitEnabled) {
+        presentIdInfo.setPresentIds(presentId);
+        presentInfo.setPNext(&presentIdInfo);
+    }
+
     try {
         return graphicsDevice.getPresentQueue().presentKHR(presentInfo);
     } catch (const vk::OutOfDateKHRError& error) {
         return vk::Result::eErrorOutOfDateKHR;
     }
 }
+
+void SwapChain::waitForQueuedPresents() {
+    if (!presentWaitEnabled || presentCount <= *settings.maxQueuedPresents) return;
+    try {
+        graphicsDevice.getDevice().waitForPresentKHR(*swapChain, presentCount - *settings.maxQueuedPresents, PRESENT_WAIT_TIMEOUT);
+    } catch (const vk::OutOfDateKHRError& error) {
+        //The next acquire runs into it as well and has the swap chain recreated
+    }
+}
 }
\ No newline at end of file
@@ -1,62 +1,117 @@
 #pragma once
 
 #include "GraphicsDevice.h"
-#include "Image.h"
-#include "ImageView.h"
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace rkrai {
+//Deferred shading renders a G-buffer in the first subpass and shades every pixel once in the second.
+//The depth pre-pass path lays down depth in a depth only subpass first, so that the forward subpass
+//only shades the fragments that end up visible.
+enum class ShadingPath {
+    eForward,
+    eForwardDepthPrepass,
+    eDeferred
+};
+
+//Trades throughput for input latency. Present modes the surface doesn't support fall back to FIFO, which every surface has.
+struct PresentationSettings {
+    //eFifo waits for vblank, eFifoRelaxed tears instead of waiting for the next one when a frame is late,
+    //eMailbox replaces the queued image with a newer one without tearing and eImmediate never waits but tears
+    vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox;
+    //Frames the cpu may record ahead of the gpu, up to SwapChain::MAX_FRAMES_IN_FLIGHT. Fewer means less latency,
+    //more keep both busier.
+    uint32_t framesInFlight = 2;
+    //Swap chain images, clamped to what the surface allows. 0 asks for one more than the surface's minimum.
+    uint32_t imageCount = 0;
+    //Frames per second the frame limiter holds the renderer to, 0 doesn't limit it
+    float maxFrameRate = 0.0f;
+    //Only begins a frame once no more than this many presented frames are still waiting to be shown, 0 waits until
+    //the last one is on screen. Needs VK_KHR_present_wait and is ignored without it, left empty only frames in flight
+    //hold the cpu back.
+    std::optional<uint32_t> maxQueuedPresents;
+};
+
 class SwapChain {
     public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    //Per frame resources are allocated for this many frames, of which PresentationSettings::framesInFlight are used
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
+    //Subpasses the Renderer's render graph merges the deferred passes into
+    static constexpr uint32_t GBUFFER_SUBPASS = 0;
+    static constexpr uint32_t LIGHTING_SUBPASS = 1;
+    //Subpasses the depth pre-pass and the forward pass are merged into
+    static constexpr uint32_t DEPTH_PREPASS_SUBPASS = 0;
+    static constexpr uint32_t MAIN_SUBPASS = 1;
+    static constexpr vk::Format ALBEDO_FORMAT = vk::Format::eR8G8B8A8Unorm;
+    static constexpr vk::Format NORMAL_FORMAT = vk::Format::eA2B10G10R10UnormPack32;
 
-    SwapChain(GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent);
-    SwapChain(GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent, std::shared_ptr<SwapChain> previous);
+    SwapChain(GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent, const PresentationSettings& settings);
+    SwapChain(
+        GraphicsDevice& graphicsDevice, vk::Extent2D windowExtent, const PresentationSettings& settings, std::shared_ptr<SwapChain> previous);
     SwapChain(const SwapChain&) = delete;
     void operator=(const SwapChain&) = delete;
 
-    vk::ResultValue<uint32_t> acquireNextImage();
-    void submitDrawCommands(const vk::CommandBuffer& buffer);
-    vk::Result presentImage(uint32_t imageIndex);
+    //The subpass that unlit and other forward drawn pipelines (billboards, particles) have to be created for
+    static uint32_t getForwardSubpass(ShadingPath shadingPath) {
+        return shadingPath == ShadingPath::eForward ? 0 : (shadingPath == ShadingPath::eDeferred ? LIGHTING_SUBPASS : MAIN_SUBPASS);
+    }
+
+    //The frame index's fence has to have been waited for through the GraphicsDevice beforehand
+    vk::ResultValue<uint32_t> acquireNextImage(int frameIndex);
+    void submitDrawCommands(const vk::CommandBuffer& buffer, int frameIndex);
+    vk::Result presentImage(uint32_t imageIndex, int frameIndex);
+    //Blocks until the frame PresentationSettings::maxQueuedPresents presents ago is on screen, does nothing without
+    //present wait
+    void waitForQueuedPresents();
 
     bool compareSwapChainFormats(const SwapChain& swapChain) const {
         return swapChain.swapChainImageFormat == swapChainImageFormat && swapChain.swapChainDepthFormat == swapChainDepthFormat;
     }
     vk::Extent2D getExtent() { return swapChainExtent; }
     float getAspectRatio() { return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height); }
-    vk::RenderPass getRenderPass() { return *renderPass; }
+    vk::Format getImageFormat() const { return swapChainImageFormat; }
+    //Picked for the depth attachment, which the render graph owns
+    vk::Format getDepthFormat() const { return swapChainDepthFormat; }
+    const std::vector<vk::Image>& getImages() const { return swapChainImages; }
+    std::vector<vk::ImageView> getImageViews() const;
     size_t getImageCount() { return swapChainImages.size(); }
-    vk::Framebuffer getFrameBuffer(int index) { return *swapChainFramebuffers[index]; }
+    //The mode actually used, which differs from the requested one if the surface doesn't support that
+    vk::PresentModeKHR getPresentMode() const { return presentMode; }
+    bool usesPresentWait() const { return presentWaitEnabled; }
+    //Color attachment, plus transfer destination if the surface allows it
+    vk::ImageUsageFlags getImageUsage() const { return imageUsage; }
 
     private:
     std::vector<vk::Image> swapChainImages;
     std::vector<vk::UniqueImageView> swapChainImageViews;
-    std::vector<vk::UniqueFramebuffer> swapChainFramebuffers;
     
+    //Bounded, so that a window that isn't being shown (like a minimized one) can't hang a frame forever
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT = 100'000'000;
+
     GraphicsDevice& graphicsDevice;
     vk::Extent2D windowExtent;
+    PresentationSettings settings;
+    vk::PresentModeKHR presentMode;
+    bool presentWaitEnabled = false;
+    //Present ids of this swap chain count up from one
+    uint64_t presentCount = 0;
 
     vk::UniqueSwapchainKHR swapChain;
     std::shared_ptr<SwapChain> oldSwapChain;
     vk::Format swapChainImageFormat;
     vk::Format swapChainDepthFormat;
     vk::Extent2D swapChainExtent;
-
-    vk::UniqueRenderPass renderPass;
-
-    std::vector<Image> depthImages;
-    std::vector<ImageView> depthImageViews;
+    vk::ImageUsageFlags imageUsage;
 
     //Synchronization objects
     std::vector<vk::UniqueSemaphore> imageAvailableSemaphores;
     std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
-    std::vector<vk::UniqueFence> inFlightFrameFences;
+    //The frame fence of the frame each image was last acquired for
     std::vector<vk::Fence> imagesInFlight;
-    int currentFrame = 0;
 
     bool hasStencilComponent(vk::Format format) { return format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eD24UnormS8Uint; }
     
@@ -67,9 +122,6 @@ class SwapChain {
     void init();
     void createSwapChain();
     void createImageViews();
-    void createDepthResources();
-    void createRenderPass();
-    void createFramebuffers();
     void createSyncObjects();
 };
 }
\ No newline at end of file
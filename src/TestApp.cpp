@@ -1,12 +1,16 @@
 #include "TestApp.h"
 #include "Camera.h"
-#include "GameObject.h"
+#include "Components.h"
 #include "Model.h"
 #include "MovementController.h"
 #include "GraphicsBuffer.h"
+#include "OcclusionCuller.h"
 #include "RenderingSystems/BillboardRenderSystem.h"
 #include "RenderingSystems/DefaultRenderSystem.h"
+#include "RenderingSystems/ParticleRenderSystem.h"
 #include "Renderer.h"
+#include "SimulationLoop.h"
+#include "SoftwareOcclusionCuller.h"
 #include "SwapChain.h"
 #include "Texture.h"
 
@@ -14,6 +18,8 @@
 #include <glm/glm.hpp>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_enums.hpp>
 
@@ -21,71 +27,141 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 TestApp::TestApp() {
-    loadGameObjects();
+    //Scene nodes are owned by the entity they're attached to
+    world->observeRemoval<rkrai::SceneNodeComponent>([this](rkrai::Entity, rkrai::SceneNodeComponent& sceneNode) {
+        sceneGraph->destroyNode(sceneNode.node);
+    });
+    loadEntities();
 }
 
 void TestApp::run() {
+    //The render graph is rebuilt by these, so they're set before any pipeline is created against it
+    auto occlusionCuller = std::make_shared<rkrai::OcclusionCuller>(graphicsDevice);
+    if (renderer.getShadingPath() == rkrai::ShadingPath::eForward) {
+        renderer.setOcclusionCuller(occlusionCuller);
+    }
+    renderer.setJobSystem(jobSystem);
+    renderer.setDynamicResolutionSettings({.enabled = true, .targetGpuTime = TARGET_GPU_FRAME_TIME});
+    renderer.setPipelineCompiler(pipelineCompiler);
+
+    //Every pipeline is requested up front and compiled concurrently, frames are drawn without them until they're ready
     auto camera = std::make_shared<rkrai::Camera>();
-    auto defaultRenderSystem = std::make_shared<rkrai::DefaultRenderSystem>(graphicsDevice, renderer.getSwapChainRenderPass(), camera);
-    auto billboardRenderSystem = std::make_shared<rkrai::BillboardRenderSystem>(graphicsDevice, renderer.getSwapChainRenderPass(), camera);
-    rkrai::GameObject cameraObject{};
+    auto defaultRenderSystem = std::make_shared<rkrai::DefaultRenderSystem>(
+        graphicsDevice, *pipelineCompiler, renderer.getSwapChainRenderPass(), camera, world, sceneGraph, renderer.getShadingPath(), renderer.getGBufferSetLayout()
+    );
+    auto billboardRenderSystem = std::make_shared<rkrai::BillboardRenderSystem>(
+        graphicsDevice, *pipelineCompiler, renderer.getSwapChainRenderPass(), camera, world, sceneGraph, renderer.getShadingPath()
+    );
+    auto particleRenderSystem = std::make_shared<rkrai::ParticleRenderSystem>(
+        graphicsDevice, *pipelineCompiler, renderer.getSwapChainRenderPass(), camera, world, sceneGraph, renderer.getShadingPath()
+    );
+    if (renderer.getShadingPath() == rkrai::ShadingPath::eForward) {
+        defaultRenderSystem->setOcclusionCuller(occlusionCuller);
+    }
+    defaultRenderSystem->setSoftwareOcclusionCuller(std::make_shared<rkrai::SoftwareOcclusionCuller>(jobSystem));
+    rkrai::TransformComponent cameraTransform{};
     rkrai::MovementController cameraController{};
-    
-    for (const auto& gameObj : gameObjects) {
-        if (gameObj->model != nullptr || gameObj->pointLight != nullptr) {
-            defaultRenderSystem->addGameObject(gameObj);
-        }
-        if (gameObj->billboard != nullptr) {
-            billboardRenderSystem->addGameObject(gameObj);
+
+    //Input is read on the main thread and picked up by whichever tick comes next, the simulated camera is only ever
+    //touched by the simulation thread and reaches this one through its snapshots
+    std::mutex inputMutex;
+    rkrai::MovementController::Input input{};
+    rkrai::TransformComponent simulatedCameraTransform{};
+    rkrai::SimulationLoop simulationLoop(SIMULATION_TICK_RATE, [&](float dt, rkrai::SimulationSnapshot& snapshot) {
+        rkrai::MovementController::Input tickInput;
+        {
+            std::lock_guard lock(inputMutex);
+            tickInput = input;
         }
-    }
+        cameraController.moveInPlaneXZ(tickInput, dt, simulatedCameraTransform);
+        snapshot.cameraTransform = simulatedCameraTransform;
+    });
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+    float statsTimer = 0.0f;
     renderer.addRenderSystem(defaultRenderSystem);
     renderer.addRenderSystem(billboardRenderSystem);
+    renderer.addRenderSystem(particleRenderSystem);
     while(!window.shouldClose()) {
-        glfwPollEvents();
+        //Before input is read, so whatever the frame shows is as fresh as pacing allows
+        renderer.paceFrame();
+        //Nothing is drawn while minimized, so there's no point in spinning through frames until the window is restored
+        if (window.isMinimized()) {
+            glfwWaitEventsTimeout(MINIMIZED_EVENT_TIMEOUT);
+        } else {
+            glfwPollEvents();
+        }
+        jobSystem->runMainThreadJobs();
 
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
         currentTime = newTime;
 
-        cameraController.moveInPlaneXZ(window.getGLFWWindow(), frameTime, cameraObject);
+        {
+            std::lock_guard lock(inputMutex);
+            input = cameraController.readInput(window.getGLFWWindow());
+        }
+        simulationLoop.interpolate(*sceneGraph, cameraTransform);
         camera->setPerspectiveProjection(50.0f, renderer.getAspectRatio(), 0.1f, 1000.0f);
-        camera->setViewYXZ(cameraObject.transform.translation, cameraObject.transform.rotation);
+        camera->setViewYXZ(cameraTransform.translation, cameraTransform.rotation);
+
+        //After gameplay has moved things and before anything is drawn, a static scene skips this entirely
+        sceneGraph->update();
 
         renderer.drawFrame();
+
+        statsTimer += frameTime;
+        if (statsTimer >= 1.0f) {
+            statsTimer = 0.0f;
+            window.setTitle(
+                "Test App - occluded objects: " + std::to_string(occlusionCuller->getRejectedObjectCount())
+                + ", resolution scale: " + std::to_string(renderer.getResolutionScale())
+                + ", gpu frame time: " + std::to_string(renderer.getGpuFrameTime()) + " ms"
+            );
+        }
     }
 
+    pipelineCompiler->waitAll();
     vkDeviceWaitIdle(graphicsDevice.getDevice());
 }
 
-void TestApp::loadGameObjects() {
-    auto model = std::make_shared<rkrai::Model>(graphicsDevice, "models/viking_room.obj");
+void TestApp::loadEntities() {
+    //The obj is parsed on a worker while the texture loads, uploads stay on the main thread with the device's command pool
+    std::shared_ptr<rkrai::Model> model;
+    auto modelData = std::make_shared<rkrai::Model::Data>();
+    auto decodeModel = jobSystem->schedule([modelData] { modelData->loadModel("models/viking_room.obj"); }, {}, "DecodeModel");
+    auto uploadModel = jobSystem->scheduleOnMainThread([this, &model, modelData] {
+        model = std::make_shared<rkrai::Model>(graphicsDevice, *modelData);
+    }, {decodeModel}, "UploadModel");
     auto texture = std::make_shared<rkrai::Texture>(graphicsDevice, "textures/viking_room.png");
-    auto gameObj = std::make_shared<rkrai::GameObject>();
-    gameObj->model = model;
-    gameObj->texture = texture;
-    gameObj->transform.translation = {0.0f, 0.0f, 2.5f};
-    gameObj->transform.scale = {1.0f, 1.0f, 1.0f};
-    gameObj->transform.rotation = {glm::radians(90.0f), 0.0f, 0.0f};
-    gameObjects.push_back(gameObj);
-
-    auto light1 = std::make_shared<rkrai::GameObject>();
-    light1->billboard = std::make_shared<rkrai::BillboardComponent>();
-    light1->billboard->color = glm::vec4{1.0f, 0.0f, 0.0f, 1.0f};
-    light1->billboard->dimensions = glm::vec2{0.1f};
-    light1->pointLight = std::make_shared<rkrai::PointLightComponent>();
-    light1->pointLight->color = glm::vec4{1.0f, 0.0f, 0.0f, 1.0f};
-    light1->transform.translation = {0.0f, -1.0f, 1.0f};
-    gameObjects.push_back(light1);
-
-    auto light2 = std::make_shared<rkrai::GameObject>();
-    light2->billboard = std::make_shared<rkrai::BillboardComponent>();
-    light2->billboard->color = glm::vec4{0.0f, 1.0f, 0.0f, 1.0f};
-    light2->billboard->dimensions = glm::vec2{0.1f};
-    light2->pointLight = std::make_shared<rkrai::PointLightComponent>();
-    light2->pointLight->color = glm::vec4{0.0f, 1.0f, 0.0f, 1.0f};
-    light2->transform.translation = {0.0f, -1.0f, 4.0f};
-    gameObjects.push_back(light2);
+    jobSystem->wait(uploadModel);
+    world->createEntity(
+        rkrai::SceneNodeComponent{sceneGraph->createNode({
+            .translation = {0.0f, 0.0f, 2.5f},
+            .scale = {1.0f, 1.0f, 1.0f},
+            .rotation = {glm::radians(90.0f), 0.0f, 0.0f}
+        })},
+        rkrai::MeshComponent{model, texture}
+    );
+
+    world->createEntity(
+        rkrai::SceneNodeComponent{sceneGraph->createNode({.translation = {0.0f, -1.0f, 1.0f}})},
+        rkrai::BillboardComponent{.color = glm::vec4{1.0f, 0.0f, 0.0f, 1.0f}, .dimensions = glm::vec2{0.1f}},
+        rkrai::PointLightComponent{.color = glm::vec4{1.0f, 0.0f, 0.0f, 1.0f}}
+    );
+
+    world->createEntity(
+        rkrai::SceneNodeComponent{sceneGraph->createNode({.translation = {0.0f, -1.0f, 4.0f}})},
+        rkrai::BillboardComponent{.color = glm::vec4{0.0f, 1.0f, 0.0f, 1.0f}, .dimensions = glm::vec2{0.1f}},
+        rkrai::PointLightComponent{.color = glm::vec4{0.0f, 1.0f, 0.0f, 1.0f}}
+    );
+
+    world->createEntity(
+        rkrai::SceneNodeComponent{sceneGraph->createNode({.translation = {1.5f, 0.0f, 2.5f}})},
+        rkrai::ParticleEmitterComponent{
+            .color = glm::vec4{1.0f, 0.6f, 0.2f, 0.5f},
+            .velocity = {0.0f, -2.0f, 0.0f},
+            .emissionRate = 20000.0f
+        }
+    );
 }
\ No newline at end of file
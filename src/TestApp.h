@@ -3,8 +3,12 @@
 #include "Window.h"
 #include "GraphicsDevice.h"
 #include "SwapChain.h"
-#include "GameObject.h"
+#include "Components.h"
+#include "JobSystem.h"
+#include "PipelineCompiler.h"
 #include "Renderer.h"
+#include "SceneGraph.h"
+#include "World.h"
 
 #include <memory>
 #include <vector>
@@ -13,6 +17,12 @@ class TestApp {
 public:
     static constexpr int WIDTH = 800;
     static constexpr int HEIGHT = 600;
+    //Ticks per second of the simulation thread, independent of the frame rate
+    static constexpr float SIMULATION_TICK_RATE = 60.0f;
+    //Seconds to wait for events while minimized, so main thread jobs still get to run
+    static constexpr double MINIMIZED_EVENT_TIMEOUT = 0.1;
+    //Milliseconds of gpu time per frame that dynamic resolution scales the scene to fit into
+    static constexpr float TARGET_GPU_FRAME_TIME = 1000.0f / 60.0f;
 
     TestApp();
 
@@ -22,11 +32,14 @@ public:
     void run();
     
 private:
-    void loadGameObjects();
+    void loadEntities();
 
+    std::shared_ptr<rkrai::JobSystem> jobSystem = std::make_shared<rkrai::JobSystem>();
     rkrai::Window window{WIDTH, HEIGHT, "Test App"};
     rkrai::GraphicsDevice graphicsDevice{window};
     rkrai::Renderer renderer{window, graphicsDevice};
+    std::shared_ptr<rkrai::PipelineCompiler> pipelineCompiler = std::make_shared<rkrai::PipelineCompiler>(graphicsDevice, jobSystem);
     
-    std::vector<std::shared_ptr<rkrai::GameObject>> gameObjects;
+    std::shared_ptr<rkrai::SceneGraph> sceneGraph = std::make_shared<rkrai::SceneGraph>();
+    std::shared_ptr<rkrai::World> world = std::make_shared<rkrai::World>();
 };
\ No newline at end of file
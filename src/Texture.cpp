@@ -46,7 +46,7 @@ void Texture::createSampler() {
     sampler = graphicsDevice.getDevice().createSamplerUnique(vk::SamplerCreateInfo{
         {}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear,
         vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat,
-        0.0f, VK_TRUE, graphicsDevice.getDeviceProperties().limits.maxSamplerAnisotropy,
+        0.0f, graphicsDevice.supportsSamplerAnisotropy(), graphicsDevice.getDeviceProperties().limits.maxSamplerAnisotropy,
         VK_FALSE, vk::CompareOp::eAlways, 0.0f, 0.0f, vk::BorderColor::eIntOpaqueBlack, VK_FALSE
     });
 }
@@ -0,0 +1,284 @@
+#include "TransformBatch.h"
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define RKRAI_TRANSFORM_BATCH_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define RKRAI_TRANSFORM_BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace rkrai {
+namespace {
+//Cephes' single precision sine and cosine, which share one reduction of the angle to [-pi/4, pi/4]
+constexpr float FOUR_OVER_PI = 1.27323954473516f;
+constexpr float PI_OVER_FOUR_1 = 0.78515625f;
+constexpr float PI_OVER_FOUR_2 = 2.4187564849853515625e-4f;
+constexpr float PI_OVER_FOUR_3 = 3.77489497744594108e-8f;
+constexpr float COS_COEFFICIENT_0 = 2.443315711809948e-5f;
+constexpr float COS_COEFFICIENT_1 = -1.388731625493765e-3f;
+constexpr float COS_COEFFICIENT_2 = 4.166664568298827e-2f;
+constexpr float SIN_COEFFICIENT_0 = -1.9515295891e-4f;
+constexpr float SIN_COEFFICIENT_1 = 8.3321608736e-3f;
+constexpr float SIN_COEFFICIENT_2 = -1.6666654611e-1f;
+
+struct ScalarFloat {
+    static constexpr size_t WIDTH = 1;
+    float value;
+
+    static ScalarFloat load(const float* data) { return {*data}; }
+    static ScalarFloat broadcast(float x) { return {x}; }
+    friend ScalarFloat operator+(ScalarFloat a, ScalarFloat b) { return {a.value + b.value}; }
+    friend ScalarFloat operator-(ScalarFloat a, ScalarFloat b) { return {a.value - b.value}; }
+    friend ScalarFloat operator*(ScalarFloat a, ScalarFloat b) { return {a.value * b.value}; }
+    friend ScalarFloat operator/(ScalarFloat a, ScalarFloat b) { return {a.value / b.value}; }
+    friend ScalarFloat operator-(ScalarFloat a) { return {-a.value}; }
+
+    static void sinCos(ScalarFloat x, ScalarFloat& sine, ScalarFloat& cosine) {
+        sine = {std::sin(x.value)};
+        cosine = {std::cos(x.value)};
+    }
+    static void storeTransposed(const ScalarFloat* components, float* output, size_t stride) { *output = components->value; }
+};
+
+#if RKRAI_TRANSFORM_BATCH_AVX2
+struct SimdFloat {
+    static constexpr size_t WIDTH = 8;
+    __m256 value;
+
+    static SimdFloat load(const float* data) { return {_mm256_loadu_ps(data)}; }
+    static SimdFloat broadcast(float x) { return {_mm256_set1_ps(x)}; }
+    friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return {_mm256_add_ps(a.value, b.value)}; }
+    friend SimdFloat operator-(SimdFloat a, SimdFloat b) { return {_mm256_sub_ps(a.value, b.value)}; }
+    friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return {_mm256_mul_ps(a.value, b.value)}; }
+    friend SimdFloat operator/(SimdFloat a, SimdFloat b) { return {_mm256_div_ps(a.value, b.value)}; }
+    friend SimdFloat operator-(SimdFloat a) { return {_mm256_xor_ps(a.value, _mm256_set1_ps(-0.0f))}; }
+
+    static void sinCos(SimdFloat x, SimdFloat& sine, SimdFloat& cosine) {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        __m256 sineSign = _mm256_and_ps(x.value, signMask);
+        __m256 absX = _mm256_andnot_ps(signMask, x.value);
+
+        //Octant of the angle, rounded up to an even one
+        __m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(absX, _mm256_set1_ps(FOUR_OVER_PI)));
+        octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+        __m256 y = _mm256_cvtepi32_ps(octant);
+
+        sineSign = _mm256_xor_ps(sineSign, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29)));
+        __m256 cosineSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29
+        ));
+        //Where set the sine polynomial gives the sine, elsewhere the two polynomials swap roles
+        __m256 polynomialMask = _mm256_castsi256_ps(
+            _mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256())
+        );
+
+        absX = _mm256_fnmadd_ps(y, _mm256_set1_ps(PI_OVER_FOUR_1), absX);
+        absX = _mm256_fnmadd_ps(y, _mm256_set1_ps(PI_OVER_FOUR_2), absX);
+        absX = _mm256_fnmadd_ps(y, _mm256_set1_ps(PI_OVER_FOUR_3), absX);
+        const __m256 z = _mm256_mul_ps(absX, absX);
+
+        __m256 cosPolynomial = _mm256_fmadd_ps(_mm256_set1_ps(COS_COEFFICIENT_0), z, _mm256_set1_ps(COS_COEFFICIENT_1));
+        cosPolynomial = _mm256_fmadd_ps(cosPolynomial, z, _mm256_set1_ps(COS_COEFFICIENT_2));
+        cosPolynomial = _mm256_mul_ps(_mm256_mul_ps(cosPolynomial, z), z);
+        cosPolynomial = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, cosPolynomial);
+        cosPolynomial = _mm256_add_ps(cosPolynomial, _mm256_set1_ps(1.0f));
+
+        __m256 sinPolynomial = _mm256_fmadd_ps(_mm256_set1_ps(SIN_COEFFICIENT_0), z, _mm256_set1_ps(SIN_COEFFICIENT_1));
+        sinPolynomial = _mm256_fmadd_ps(sinPolynomial, z, _mm256_set1_ps(SIN_COEFFICIENT_2));
+        sinPolynomial = _mm256_fmadd_ps(_mm256_mul_ps(sinPolynomial, z), absX, absX);
+
+        sine = {_mm256_xor_ps(_mm256_blendv_ps(cosPolynomial, sinPolynomial, polynomialMask), sineSign)};
+        cosine = {_mm256_xor_ps(_mm256_blendv_ps(sinPolynomial, cosPolynomial, polynomialMask), cosineSign)};
+    }
+
+    //Writes eight consecutive components of eight objects, the components hold one value per object
+    static void storeTransposed(const SimdFloat* components, float* output, size_t stride) {
+        const __m256 t0 = _mm256_unpacklo_ps(components[0].value, components[1].value);
+        const __m256 t1 = _mm256_unpackhi_ps(components[0].value, components[1].value);
+        const __m256 t2 = _mm256_unpacklo_ps(components[2].value, components[3].value);
+        const __m256 t3 = _mm256_unpackhi_ps(components[2].value, components[3].value);
+        const __m256 t4 = _mm256_unpacklo_ps(components[4].value, components[5].value);
+        const __m256 t5 = _mm256_unpackhi_ps(components[4].value, components[5].value);
+        const __m256 t6 = _mm256_unpacklo_ps(components[6].value, components[7].value);
+        const __m256 t7 = _mm256_unpackhi_ps(components[6].value, components[7].value);
+        const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+        _mm256_storeu_ps(output, _mm256_permute2f128_ps(u0, u4, 0x20));
+        _mm256_storeu_ps(output + stride, _mm256_permute2f128_ps(u1, u5, 0x20));
+        _mm256_storeu_ps(output + stride * 2, _mm256_permute2f128_ps(u2, u6, 0x20));
+        _mm256_storeu_ps(output + stride * 3, _mm256_permute2f128_ps(u3, u7, 0x20));
+        _mm256_storeu_ps(output + stride * 4, _mm256_permute2f128_ps(u0, u4, 0x31));
+        _mm256_storeu_ps(output + stride * 5, _mm256_permute2f128_ps(u1, u5, 0x31));
+        _mm256_storeu_ps(output + stride * 6, _mm256_permute2f128_ps(u2, u6, 0x31));
+        _mm256_storeu_ps(output + stride * 7, _mm256_permute2f128_ps(u3, u7, 0x31));
+    }
+};
+#elif RKRAI_TRANSFORM_BATCH_SSE
+struct SimdFloat {
+    static constexpr size_t WIDTH = 4;
+    __m128 value;
+
+    static SimdFloat load(const float* data) { return {_mm_loadu_ps(data)}; }
+    static SimdFloat broadcast(float x) { return {_mm_set1_ps(x)}; }
+    friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return {_mm_add_ps(a.value, b.value)}; }
+    friend SimdFloat operator-(SimdFloat a, SimdFloat b) { return {_mm_sub_ps(a.value, b.value)}; }
+    friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return {_mm_mul_ps(a.value, b.value)}; }
+    friend SimdFloat operator/(SimdFloat a, SimdFloat b) { return {_mm_div_ps(a.value, b.value)}; }
+    friend SimdFloat operator-(SimdFloat a) { return {_mm_xor_ps(a.value, _mm_set1_ps(-0.0f))}; }
+
+    static void sinCos(SimdFloat x, SimdFloat& sine, SimdFloat& cosine) {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 sineSign = _mm_and_ps(x.value, signMask);
+        __m128 absX = _mm_andnot_ps(signMask, x.value);
+
+        //Octant of the angle, rounded up to an even one
+        __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(absX, _mm_set1_ps(FOUR_OVER_PI)));
+        octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(octant);
+
+        sineSign = _mm_xor_ps(sineSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+        __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(
+            _mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29
+        ));
+        //Where set the sine polynomial gives the sine, elsewhere the two polynomials swap roles
+        __m128 polynomialMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+        absX = _mm_sub_ps(absX, _mm_mul_ps(y, _mm_set1_ps(PI_OVER_FOUR_1)));
+        absX = _mm_sub_ps(absX, _mm_mul_ps(y, _mm_set1_ps(PI_OVER_FOUR_2)));
+        absX = _mm_sub_ps(absX, _mm_mul_ps(y, _mm_set1_ps(PI_OVER_FOUR_3)));
+        const __m128 z = _mm_mul_ps(absX, absX);
+
+        __m128 cosPolynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_COEFFICIENT_0), z), _mm_set1_ps(COS_COEFFICIENT_1));
+        cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, z), _mm_set1_ps(COS_COEFFICIENT_2));
+        cosPolynomial = _mm_mul_ps(_mm_mul_ps(cosPolynomial, z), z);
+        cosPolynomial = _mm_sub_ps(cosPolynomial, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+        cosPolynomial = _mm_add_ps(cosPolynomial, _mm_set1_ps(1.0f));
+
+        __m128 sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_COEFFICIENT_0), z), _mm_set1_ps(SIN_COEFFICIENT_1));
+        sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, z), _mm_set1_ps(SIN_COEFFICIENT_2));
+        sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPolynomial, z), absX), absX);
+
+        //SSE2 has no blend, select with and/andnot instead
+        const __m128 sinResult = _mm_or_ps(_mm_and_ps(polynomialMask, sinPolynomial), _mm_andnot_ps(polynomialMask, cosPolynomial));
+        const __m128 cosResult = _mm_or_ps(_mm_and_ps(polynomialMask, cosPolynomial), _mm_andnot_ps(polynomialMask, sinPolynomial));
+        sine = {_mm_xor_ps(sinResult, sineSign)};
+        cosine = {_mm_xor_ps(cosResult, cosineSign)};
+    }
+
+    //Writes four consecutive components of four objects, the components hold one value per object
+    static void storeTransposed(const SimdFloat* components, float* output, size_t stride) {
+        __m128 row0 = components[0].value;
+        __m128 row1 = components[1].value;
+        __m128 row2 = components[2].value;
+        __m128 row3 = components[3].value;
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+        _mm_storeu_ps(output, row0);
+        _mm_storeu_ps(output + stride, row1);
+        _mm_storeu_ps(output + stride * 2, row2);
+        _mm_storeu_ps(output + stride * 3, row3);
+    }
+};
+#else
+using SimdFloat = ScalarFloat;
+#endif
+}
+
+void TransformBatch::resize(size_t count) {
+    translationX.resize(count, 0.0f);
+    translationY.resize(count, 0.0f);
+    translationZ.resize(count, 0.0f);
+    scaleX.resize(count, 1.0f);
+    scaleY.resize(count, 1.0f);
+    scaleZ.resize(count, 1.0f);
+    rotationX.resize(count, 0.0f);
+    rotationY.resize(count, 0.0f);
+    rotationZ.resize(count, 0.0f);
+}
+
+TransformComponent TransformBatch::get(size_t index) const {
+    return {
+        .translation = {translationX[index], translationY[index], translationZ[index]},
+        .scale = {scaleX[index], scaleY[index], scaleZ[index]},
+        .rotation = {rotationX[index], rotationY[index], rotationZ[index]}
+    };
+}
+
+void TransformBatch::set(size_t index, const TransformComponent& transform) {
+    translationX[index] = transform.translation.x;
+    translationY[index] = transform.translation.y;
+    translationZ[index] = transform.translation.z;
+    scaleX[index] = transform.scale.x;
+    scaleY[index] = transform.scale.y;
+    scaleZ[index] = transform.scale.z;
+    rotationX[index] = transform.rotation.x;
+    rotationY[index] = transform.rotation.y;
+    rotationZ[index] = transform.rotation.z;
+}
+
+void TransformBatch::computeMatrices(size_t first, size_t count, Matrices* output) const {
+    assert(first + count <= size() && "Computing matrices past the end of the batch");
+    size_t index = 0;
+    for (; index + SimdFloat::WIDTH <= count; index += SimdFloat::WIDTH) {
+        computeBlock<SimdFloat>(first + index, output + index);
+    }
+    for (; index < count; index++) {
+        computeBlock<ScalarFloat>(first + index, output + index);
+    }
+}
+
+//Same math as TransformComponent::modelMatrix and normalMatrix, Translate * Ry * Rx * Rz * Scale with the normal
+//matrix using the inverse scale. The rotation is shared by both matrices.
+template <typename Float>
+void TransformBatch::computeBlock(size_t first, Matrices* output) const {
+    Float s1, c1, s2, c2, s3, c3;
+    Float::sinCos(Float::load(&rotationY[first]), s1, c1);
+    Float::sinCos(Float::load(&rotationX[first]), s2, c2);
+    Float::sinCos(Float::load(&rotationZ[first]), s3, c3);
+
+    const Float rotation[3][3] = {
+        {c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1},
+        {c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3},
+        {c2 * s1, -s2, c1 * c2}
+    };
+    const Float scale[3] = {Float::load(&scaleX[first]), Float::load(&scaleY[first]), Float::load(&scaleZ[first])};
+    const Float zero = Float::broadcast(0.0f);
+    const Float one = Float::broadcast(1.0f);
+
+    //Every float of the matrices computed for all lanes at once, in the order they're laid out in memory
+    constexpr size_t COMPONENT_COUNT = sizeof(Matrices) / sizeof(float);
+    Float components[COMPONENT_COUNT];
+    for (int column = 0; column < 3; column++) {
+        const Float inverseScale = one / scale[column];
+        for (int row = 0; row < 3; row++) {
+            components[column * 4 + row] = scale[column] * rotation[column][row];
+            components[16 + column * 4 + row] = inverseScale * rotation[column][row];
+        }
+        components[column * 4 + 3] = zero;
+        components[16 + column * 4 + 3] = zero;
+    }
+    components[12] = Float::load(&translationX[first]);
+    components[13] = Float::load(&translationY[first]);
+    components[14] = Float::load(&translationZ[first]);
+    components[15] = one;
+    components[28] = zero;
+    components[29] = zero;
+    components[30] = zero;
+    components[31] = one;
+
+    //Transposed a register's width of components at a time, so every object's matrices are written with full stores
+    float* destination = reinterpret_cast<float*>(output);
+    for (size_t component = 0; component < COMPONENT_COUNT; component += Float::WIDTH) {
+        Float::storeTransposed(&components[component], destination + component, COMPONENT_COUNT);
+    }
+}
+}
\ No newline at end of file
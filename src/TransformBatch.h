@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TransformComponent.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace rkrai {
+//Transforms of many objects kept as one array per component, so that their model and normal matrices are computed
+//a whole SIMD register of objects at a time. Each angle's sine and cosine is computed once and shared by both matrices.
+//AVX2 is used when the compiler targets it, SSE2 otherwise on x86, and plain scalar code everywhere else.
+class TransformBatch {
+    public:
+    //Matches the std430 layout shaders read transforms with
+    struct Matrices {
+        glm::mat4 modelMat;
+        //Only the upper 3x3 is used, padded like a mat3 converted to a mat4
+        glm::mat4 normalMat;
+    };
+
+    void resize(size_t count);
+    size_t size() const { return translationX.size(); }
+    TransformComponent get(size_t index) const;
+    void set(size_t index, const TransformComponent& transform);
+    //Writes the matrices of count transforms starting at first to output[0] onwards, which may point straight into
+    //mapped gpu memory
+    void computeMatrices(size_t first, size_t count, Matrices* output) const;
+
+    private:
+    template <typename Float>
+    void computeBlock(size_t first, Matrices* output) const;
+
+    std::vector<float> translationX;
+    std::vector<float> translationY;
+    std::vector<float> translationZ;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+};
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
-#include "GameObject.h"
+#include "TransformComponent.h"
 
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace rkrai {
@@ -73,4 +74,15 @@ glm::mat3 TransformComponent::normalMatrix() const {
         }
     };
 }
+
+// Euler angles that wrapped around, like a yaw kept in [0, 2pi), would otherwise spin almost a full turn
+TransformComponent TransformComponent::interpolate(const TransformComponent& from, const TransformComponent& to, float alpha) {
+    glm::vec3 rotationDelta = to.rotation - from.rotation;
+    rotationDelta -= glm::two_pi<float>() * glm::round(rotationDelta / glm::two_pi<float>());
+    return {
+        .translation = glm::mix(from.translation, to.translation, alpha),
+        .scale = glm::mix(from.scale, to.scale, alpha),
+        .rotation = from.rotation + rotationDelta * alpha
+    };
+}
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace rkrai {
+//Translation, scale and rotation, relative to the parent node for transforms kept in a SceneGraph
+struct TransformComponent {
+    glm::vec3 translation{};
+    glm::vec3 scale{1.0f, 1.0f, 1.0f};
+    glm::vec3 rotation{};
+
+    glm::mat4 modelMatrix() const;
+    glm::mat3 normalMatrix() const;
+
+    //Linear in translation and scale, rotations take the shorter way around on each axis
+    static TransformComponent interpolate(const TransformComponent& from, const TransformComponent& to, float alpha);
+
+    bool operator==(const TransformComponent& other) const = default;
+};
+}
\ No newline at end of file
@@ -18,7 +18,10 @@ public:
     GLFWwindow* getGLFWWindow() const { return glfwWindow; }
     int getWidth() const { return width; }
     int getHeight() const { return height; }
+    //A minimized window's framebuffer has no size, there's nothing to draw into
+    bool isMinimized() const { return width == 0 || height == 0; }
     
+    void setTitle(const std::string& title) { glfwSetWindowTitle(glfwWindow, title.c_str()); }
     void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
 private:
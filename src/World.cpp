@@ -0,0 +1,189 @@
+#include "World.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace rkrai {
+namespace {
+std::mutex componentTypeMutex;
+uint32_t componentTypeCount = 0;
+}
+
+//Fixed size, so that infos never move while other threads read them
+std::array<World::ComponentInfo, World::MAX_COMPONENT_TYPES>& World::getComponentInfos() {
+    static std::array<ComponentInfo, MAX_COMPONENT_TYPES> componentInfos;
+    return componentInfos;
+}
+
+World::ComponentTypeId World::registerComponentType(const ComponentInfo& info) {
+    std::lock_guard lock(componentTypeMutex);
+    if (componentTypeCount == MAX_COMPONENT_TYPES) throw std::runtime_error("Too many component types");
+    assert(info.alignment <= CHUNK_ALIGNMENT && "Component is aligned more strictly than chunks are");
+    getComponentInfos()[componentTypeCount] = info;
+    return componentTypeCount++;
+}
+
+const World::ComponentInfo& World::getComponentInfo(ComponentTypeId typeId) {
+    return getComponentInfos()[typeId];
+}
+
+World::~World() {
+    for (const auto& archetype : archetypes) {
+        for (const auto& chunk : archetype->chunks) {
+            for (ComponentTypeId typeId : archetype->typeIds) {
+                const ComponentInfo& info = getComponentInfo(typeId);
+                std::byte* column = chunk.memory.get() + archetype->columnOffsets[typeId];
+                for (uint32_t row = 0; row < chunk.count; row++) {
+                    info.destroy(column + row * info.size);
+                }
+            }
+        }
+    }
+}
+
+//Bumping the generation is what invalidates every handle to the entity, its index goes back onto the free list
+void World::destroyEntity(Entity entity) {
+    assert(isAlive(entity) && "Entity doesn't exist");
+    const EntityLocation location = locations[entity.index];
+    for (ComponentTypeId typeId : location.archetype->typeIds) {
+        destroyComponent(entity, typeId, getComponentPointer(entity, typeId));
+    }
+    freeRow(location);
+    locations[entity.index] = {};
+    generations[entity.index]++;
+    freeIndices.push_back(entity.index);
+}
+
+void World::removeObserver(ObserverId observerId) {
+    std::erase_if(removalObservers, [&](const RemovalObserver& observer) { return observer.id == observerId; });
+    observedMask = 0;
+    for (const auto& observer : removalObservers) {
+        observedMask |= ComponentMask{1} << observer.typeId;
+    }
+}
+
+//Fits as many entities into a chunk as its size allows, chunks of archetypes with huge components grow to hold one
+World::Archetype& World::getArchetype(ComponentMask mask) {
+    auto found = archetypesByMask.find(mask);
+    if (found != archetypesByMask.end()) return *found->second;
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->mask = mask;
+    for (ComponentMask remaining = mask; remaining != 0; remaining &= remaining - 1) {
+        archetype->typeIds.push_back(static_cast<ComponentTypeId>(std::countr_zero(remaining)));
+    }
+
+    size_t bytesPerEntity = sizeof(Entity);
+    for (ComponentTypeId typeId : archetype->typeIds) {
+        bytesPerEntity += getComponentInfo(typeId).size;
+    }
+    auto layOut = [&](uint32_t capacity) {
+        size_t offset = capacity * sizeof(Entity);
+        for (ComponentTypeId typeId : archetype->typeIds) {
+            const ComponentInfo& info = getComponentInfo(typeId);
+            offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+            archetype->columnOffsets[typeId] = offset;
+            offset += capacity * info.size;
+        }
+        return offset;
+    };
+    uint32_t capacity = static_cast<uint32_t>(std::max<size_t>(CHUNK_SIZE / bytesPerEntity, 1));
+    while (capacity > 1 && layOut(capacity) > CHUNK_SIZE) {
+        capacity--;
+    }
+    archetype->chunkCapacity = capacity;
+    archetype->chunkSize = std::max(layOut(capacity), CHUNK_SIZE);
+
+    Archetype* result = archetype.get();
+    archetypes.push_back(std::move(archetype));
+    archetypesByMask.emplace(mask, result);
+    return *result;
+}
+
+Entity World::allocateEntity(ComponentMask mask) {
+    Entity entity;
+    if (freeIndices.empty()) {
+        assert(locations.size() < UINT32_MAX && "Ran out of entity indices");
+        entity = {static_cast<uint32_t>(locations.size()), 0};
+        locations.emplace_back();
+        generations.push_back(0);
+    } else {
+        entity = {freeIndices.back(), generations[freeIndices.back()]};
+        freeIndices.pop_back();
+    }
+    locations[entity.index] = allocateRow(getArchetype(mask), entity);
+    return entity;
+}
+
+World::EntityLocation World::allocateRow(Archetype& archetype, Entity entity) {
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.chunkCapacity) {
+        archetype.chunks.push_back({
+            .memory = std::unique_ptr<std::byte[], ChunkDeleter>(new (std::align_val_t{CHUNK_ALIGNMENT}) std::byte[archetype.chunkSize])
+        });
+    }
+    Chunk& chunk = archetype.chunks.back();
+    const uint32_t row = chunk.count++;
+    chunk.getEntities()[row] = entity;
+    return {&archetype, static_cast<uint32_t>(archetype.chunks.size() - 1), row};
+}
+
+void World::freeRow(const EntityLocation& location) {
+    Archetype& archetype = *location.archetype;
+    Chunk& lastChunk = archetype.chunks.back();
+    const uint32_t lastRow = lastChunk.count - 1;
+    const bool isLast = location.chunk == archetype.chunks.size() - 1 && location.row == lastRow;
+    if (!isLast) {
+        Chunk& chunk = archetype.chunks[location.chunk];
+        for (ComponentTypeId typeId : archetype.typeIds) {
+            const ComponentInfo& info = getComponentInfo(typeId);
+            const size_t offset = archetype.columnOffsets[typeId];
+            info.relocate(
+                chunk.memory.get() + offset + location.row * info.size,
+                lastChunk.memory.get() + offset + lastRow * info.size
+            );
+        }
+        const Entity movedEntity = lastChunk.getEntities()[lastRow];
+        chunk.getEntities()[location.row] = movedEntity;
+        locations[movedEntity.index] = location;
+    }
+    if (--lastChunk.count == 0) archetype.chunks.pop_back();
+}
+
+//Components both archetypes have are relocated, the ones the new archetype lacks are destroyed
+void World::moveEntity(Entity entity, ComponentMask mask) {
+    const EntityLocation oldLocation = locations[entity.index];
+    const EntityLocation newLocation = allocateRow(getArchetype(mask), entity);
+    for (ComponentTypeId typeId : oldLocation.archetype->typeIds) {
+        const ComponentInfo& info = getComponentInfo(typeId);
+        void* component = getComponentPointer(entity, typeId);
+        if (mask & (ComponentMask{1} << typeId)) {
+            Chunk& chunk = newLocation.archetype->chunks[newLocation.chunk];
+            info.relocate(chunk.memory.get() + newLocation.archetype->columnOffsets[typeId] + newLocation.row * info.size, component);
+        } else {
+            destroyComponent(entity, typeId, component);
+        }
+    }
+    freeRow(oldLocation);
+    locations[entity.index] = newLocation;
+}
+
+void World::notifyRemoval(Entity entity, ComponentTypeId typeId, void* component) {
+    if (observedMask & (ComponentMask{1} << typeId)) {
+        for (const auto& observer : removalObservers) {
+            if (observer.typeId == typeId) observer.notify(entity, component);
+        }
+    }
+}
+
+void World::destroyComponent(Entity entity, ComponentTypeId typeId, void* component) {
+    notifyRemoval(entity, typeId, component);
+    getComponentInfo(typeId).destroy(component);
+}
+
+void* World::getComponentPointer(Entity entity, ComponentTypeId typeId) const {
+    const EntityLocation& location = locations[entity.index];
+    const Chunk& chunk = location.archetype->chunks[location.chunk];
+    return chunk.memory.get() + location.archetype->columnOffsets[typeId] + location.row * getComponentInfo(typeId).size;
+}
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rkrai {
+//Indices of destroyed entities are reused, the generation tells a reused index apart from handles to the entity
+//that had it before, which then simply stop being alive
+struct Entity {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity& other) const = default;
+};
+inline constexpr Entity NO_ENTITY{};
+
+//Entities are handles whose components are stored by archetype, the set of component types an entity has. Every archetype
+//keeps its entities in fixed size chunks holding one contiguous array per component type, so queries walk plain arrays
+//instead of chasing pointers. Adding or removing a component moves the entity's components to another archetype.
+//Components can be of any movable type, with at most MAX_COMPONENT_TYPES different ones in the whole program.
+//Entities can't be created or destroyed and components can't be added or removed while a query is iterating.
+//Creating, destroying and adding or removing components all take constant time.
+class World {
+    public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+    using ComponentMask = uint64_t;
+    using ObserverId = uint32_t;
+
+    template <typename... Components>
+    class Query;
+
+    World() = default;
+    ~World();
+    World(const World&) = delete;
+    void operator=(const World&) = delete;
+
+    template <typename... Components>
+    Entity createEntity(Components... components) {
+        const ComponentMask mask = getMask<Components...>();
+        assert(std::popcount(mask) == sizeof...(Components) && "An entity can only have one component of each type");
+        const Entity entity = allocateEntity(mask);
+        (new (getComponentPointer(entity, getComponentTypeId<Components>())) Components(std::move(components)), ...);
+        return entity;
+    }
+    void destroyEntity(Entity entity);
+    bool isAlive(Entity entity) const {
+        return entity.index < locations.size() && locations[entity.index].archetype != nullptr
+            && generations[entity.index] == entity.generation;
+    }
+    //The entity currently using the index, or NO_ENTITY
+    Entity getEntity(uint32_t index) const {
+        if (index >= locations.size() || locations[index].archetype == nullptr) return NO_ENTITY;
+        return {index, generations[index]};
+    }
+    //One past the highest entity index in use so far, for arrays indexed by entity index
+    uint32_t getEntityCapacity() const { return static_cast<uint32_t>(locations.size()); }
+
+    //Calls the observer with the component right before it's destroyed, whether it's removed on its own or along with
+    //its entity. Observers must not create or destroy entities or add or remove components, and aren't called when
+    //the world itself is destroyed.
+    template <typename Component>
+    ObserverId observeRemoval(std::function<void(Entity entity, Component& component)> observer) {
+        const ComponentTypeId typeId = getComponentTypeId<Component>();
+        observedMask |= getMask<Component>();
+        removalObservers.push_back({
+            .id = nextObserverId,
+            .typeId = typeId,
+            .notify = [observer = std::move(observer)](Entity entity, void* component) { observer(entity, *static_cast<Component*>(component)); }
+        });
+        return nextObserverId++;
+    }
+    void removeObserver(ObserverId observerId);
+
+    //Replaces the component if the entity already has one, removal observers see the replaced one first
+    template <typename Component>
+    void addComponent(Entity entity, Component component) {
+        if (Component* existing = getComponent<Component>(entity)) {
+            notifyRemoval(entity, getComponentTypeId<Component>(), existing);
+            *existing = std::move(component);
+            return;
+        }
+        const ComponentTypeId typeId = getComponentTypeId<Component>();
+        moveEntity(entity, locations[entity.index].archetype->mask | getMask<Component>());
+        new (getComponentPointer(entity, typeId)) Component(std::move(component));
+    }
+    template <typename Component>
+    void removeComponent(Entity entity) {
+        if (!hasComponent<Component>(entity)) return;
+        moveEntity(entity, locations[entity.index].archetype->mask & ~getMask<Component>());
+    }
+    template <typename Component>
+    bool hasComponent(Entity entity) const {
+        assert(isAlive(entity) && "Entity doesn't exist");
+        return (locations[entity.index].archetype->mask & getMask<Component>()) != 0;
+    }
+    //Returns nullptr if the entity doesn't have the component. The pointer is invalidated by any change to the entities
+    //of the same archetype, like the entity gaining or losing a component, or another one being destroyed.
+    template <typename Component>
+    Component* getComponent(Entity entity) {
+        if (!hasComponent<Component>(entity)) return nullptr;
+        return static_cast<Component*>(getComponentPointer(entity, getComponentTypeId<Component>()));
+    }
+    template <typename Component>
+    const Component* getComponent(Entity entity) const { return const_cast<World*>(this)->getComponent<Component>(entity); }
+
+    //Matches every entity that has all of the components, which may be const qualified to only read them
+    template <typename... Components>
+    Query<Components...> query() { return Query<Components...>(*this); }
+
+    private:
+    using ComponentTypeId = uint32_t;
+
+    //Type erased operations on a component, relocating move constructs it in place and destroys the source
+    struct ComponentInfo {
+        size_t size;
+        size_t alignment;
+        void (*relocate)(void* destination, void* source);
+        void (*destroy)(void* component);
+    };
+
+    static constexpr size_t CHUNK_ALIGNMENT = 64;
+
+    struct ChunkDeleter {
+        void operator()(std::byte* memory) const { ::operator delete[](memory, std::align_val_t{CHUNK_ALIGNMENT}); }
+    };
+
+    //The entities array comes first, followed by the array of every component type
+    struct Chunk {
+        std::unique_ptr<std::byte[], ChunkDeleter> memory;
+        uint32_t count = 0;
+
+        Entity* getEntities() const { return reinterpret_cast<Entity*>(memory.get()); }
+    };
+
+    //Every chunk but the last one is full, removing an entity moves the last one into its place
+    struct Archetype {
+        ComponentMask mask = 0;
+        std::vector<ComponentTypeId> typeIds;
+        //Indexed by component type id, where each type's array starts within a chunk
+        std::array<size_t, MAX_COMPONENT_TYPES> columnOffsets{};
+        uint32_t chunkCapacity = 0;
+        size_t chunkSize = 0;
+        std::vector<Chunk> chunks;
+    };
+
+    struct EntityLocation {
+        Archetype* archetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+    };
+
+    struct RemovalObserver {
+        ObserverId id;
+        ComponentTypeId typeId;
+        std::function<void(Entity entity, void* component)> notify;
+    };
+
+    template <typename Component>
+    static ComponentTypeId getComponentTypeId() { return getUnqualifiedComponentTypeId<std::remove_cv_t<Component>>(); }
+    template <typename Component>
+    static ComponentTypeId getUnqualifiedComponentTypeId() {
+        static const ComponentTypeId typeId = registerComponentType({
+            .size = sizeof(Component),
+            .alignment = alignof(Component),
+            .relocate = [](void* destination, void* source) {
+                new (destination) Component(std::move(*static_cast<Component*>(source)));
+                static_cast<Component*>(source)->~Component();
+            },
+            .destroy = [](void* component) { static_cast<Component*>(component)->~Component(); }
+        });
+        return typeId;
+    }
+    template <typename... Components>
+    static ComponentMask getMask() { return (ComponentMask{0} | ... | (ComponentMask{1} << getComponentTypeId<Components>())); }
+    static std::array<ComponentInfo, MAX_COMPONENT_TYPES>& getComponentInfos();
+    static ComponentTypeId registerComponentType(const ComponentInfo& info);
+    static const ComponentInfo& getComponentInfo(ComponentTypeId typeId);
+
+    Archetype& getArchetype(ComponentMask mask);
+    Entity allocateEntity(ComponentMask mask);
+    EntityLocation allocateRow(Archetype& archetype, Entity entity);
+    //Expects the row's components to already be destroyed or relocated
+    void freeRow(const EntityLocation& location);
+    void moveEntity(Entity entity, ComponentMask mask);
+    void notifyRemoval(Entity entity, ComponentTypeId typeId, void* component);
+    void destroyComponent(Entity entity, ComponentTypeId typeId, void* component);
+    void* getComponentPointer(Entity entity, ComponentTypeId typeId) const;
+
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> archetypesByMask;
+    //Indexed by entity index, free indices have no archetype
+    std::vector<EntityLocation> locations;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> freeIndices;
+
+    std::vector<RemovalObserver> removalObservers;
+    ComponentMask observedMask = 0;
+    ObserverId nextObserverId = 0;
+};
+
+template <typename... Components>
+class World::Query {
+    public:
+    //Skips entities that also have any of these components
+    template <typename... Excluded>
+    Query& without() {
+        excludedMask |= getMask<Excluded...>();
+        return *this;
+    }
+
+    //Calls function(uint32_t count, const Entity* entities, Components*... components) with the arrays of every chunk
+    template <typename Function>
+    void eachChunk(Function&& function) const {
+        for (const auto& archetype : world.archetypes) {
+            if ((archetype->mask & includedMask) != includedMask || (archetype->mask & excludedMask) != 0) continue;
+            for (const auto& chunk : archetype->chunks) {
+                function(
+                    chunk.count,
+                    static_cast<const Entity*>(chunk.getEntities()),
+                    reinterpret_cast<Components*>(chunk.memory.get() + archetype->columnOffsets[getComponentTypeId<Components>()])...
+                );
+            }
+        }
+    }
+    //Calls function(Entity entity, Components&... components) for every matching entity
+    template <typename Function>
+    void each(Function&& function) const {
+        eachChunk([&](uint32_t count, const Entity* entities, Components*... components) {
+            for (uint32_t i = 0; i < count; i++) {
+                function(entities[i], components[i]...);
+            }
+        });
+    }
+    size_t count() const {
+        size_t total = 0;
+        eachChunk([&](uint32_t count, const Entity*, Components*...) { total += count; });
+        return total;
+    }
+
+    private:
+    friend class World;
+
+    Query(World& world) : world(world), includedMask(getMask<Components...>()) {}
+
+    World& world;
+    ComponentMask includedMask;
+    ComponentMask excludedMask = 0;
+};
+}
\ No newline at end of file
@@ -1,6 +1,16 @@
+#include "HeadlessApp.h"
 #include "TestApp.h"
 
-int main() {
+#include <string>
+
+//With --headless [output path] the scene is drawn without a window and the last frame written to a PPM file
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string{argv[1]} == "--headless") {
+        HeadlessApp app{argc > 2 ? argv[2] : "headless.ppm"};
+        app.run();
+        return 0;
+    }
+
     TestApp app;
 
     app.run();